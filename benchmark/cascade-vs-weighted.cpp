@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+// Benchmark of SolverHQuadProgCascade against SolverHQuadProgFast solving the
+// same random problem, with three priority levels of tasks above the
+// constraints, the priorities being approximated by weights for the latter.
+// The targets of the tasks change at every tick. It prints, for each solver,
+// the mean and the largest number of iterations per tick, the number of ticks
+// without an optimal solution and the mean solve time.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <tsid/math/constraint-equality.hpp>
+#include <tsid/math/constraint-inequality.hpp>
+#include <tsid/solvers/solver-HQP-factory.hxx>
+
+using namespace tsid;
+using namespace tsid::math;
+using namespace tsid::solvers;
+
+namespace {
+
+const unsigned int N_TICKS = 2000;
+const unsigned int N = 30;    // variables
+const unsigned int NEQ = 6;   // equalities
+const unsigned int NIN = 10;  // inequalities
+const unsigned int M[3] = {10, 10, 20};  // rows of the tasks of each level
+// weight ratio between two consecutive levels of the weighted problem
+const double WEIGHT_RATIO = 1e4;
+
+/// Iterations and solve times of a solver over the ticks.
+struct SolverStatistics {
+  std::string name;
+  std::shared_ptr<SolverHQPBase> solver;
+  unsigned long iterations;
+  int maxIterations;
+  unsigned int failures;
+  double time;
+
+  SolverStatistics(const std::string& name, SolverHQPBase* solver)
+      : name(name),
+        solver(solver),
+        iterations(0),
+        maxIterations(0),
+        failures(0),
+        time(0.0) {}
+
+  void solve(const HQPData& data) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    const HQPOutput& output = solver->solve(data);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    time += elapsed.count();
+    iterations += output.iterations;
+    maxIterations = std::max(maxIterations, output.iterations);
+    if (output.status != HQP_STATUS_OPTIMAL) failures++;
+  }
+
+  void print() const {
+    std::cout << "  " << name << ": " << double(iterations) / N_TICKS
+              << " iterations per tick (max " << maxIterations << "), "
+              << failures << " failures, " << 1e6 * time / N_TICKS
+              << " us per tick\n";
+  }
+};
+
+void addConstraint(HQPData& data, unsigned int level, double weight,
+                   std::shared_ptr<ConstraintBase> constraint) {
+  data[level].push_back(
+      make_pair<double, std::shared_ptr<ConstraintBase> >(weight, constraint));
+}
+
+}  // namespace
+
+int main() {
+  HQPData hqpData(4), weightedData(2);
+  addConstraint(hqpData, 0, 1.0,
+                std::make_shared<ConstraintEquality>(
+                    "eq", Matrix::Random(NEQ, N), Vector::Random(NEQ)));
+  addConstraint(hqpData, 0, 1.0,
+                std::make_shared<ConstraintInequality>(
+                    "in", Matrix::Random(NIN, N), -Vector::Ones(NIN),
+                    Vector::Ones(NIN)));
+  weightedData[0] = hqpData[0];
+  std::shared_ptr<ConstraintEquality> tasks[3];
+  double weight = WEIGHT_RATIO * WEIGHT_RATIO;
+  for (unsigned int i = 0; i < 3; i++) {
+    tasks[i] = std::make_shared<ConstraintEquality>(
+        "task" + std::to_string(i + 1), Matrix::Random(M[i], N),
+        Vector::Random(M[i]));
+    addConstraint(hqpData, i + 1, 1.0, tasks[i]);
+    addConstraint(weightedData, 1, weight, tasks[i]);
+    weight /= WEIGHT_RATIO;
+  }
+
+  SolverStatistics cascade(
+      "eiquadprog-cascade",
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_EIQUADPROG_CASCADE,
+                                        "eiquadprog_cascade"));
+  SolverStatistics weighted(
+      "eiquadprog-fast weighted",
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_EIQUADPROG_FAST,
+                                        "eiquadprog_fast_weighted"));
+  for (unsigned int k = 0; k < N_TICKS; k++) {
+    for (unsigned int i = 0; i < 3; i++) tasks[i]->vector().setRandom();
+    cascade.solve(hqpData);
+    weighted.solve(weightedData);
+  }
+
+  std::cout << N << " variables, " << NEQ << " equalities, " << NIN
+            << " inequalities, 3 levels of tasks, " << N_TICKS << " ticks\n";
+  cascade.print();
+  weighted.print();
+  return 0;
+}
@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+// Micro-benchmark of the accumulation of the least-squares cost of the tasks,
+// H += w * A^T * A and g -= w * A^T * b, for the task sets of the romeo and
+// quadruped tests. It prints the number of ticks per second of:
+//   - a general matrix product computing the full Hessian,
+//   - addLeastSquaresCost, which only computes its lower triangle on the
+//     columns supported by each task,
+//   - the assembly of the stacked problem data followed by addLeastSquaresCost.
+
+#include <chrono>
+#include <iostream>
+
+#include <tsid/math/utils.hpp>
+#include <tsid/solvers/utils.hpp>
+
+#include "scenarios.hpp"
+
+using namespace tsid;
+using namespace tsid::benchmark;
+using namespace tsid::math;
+using namespace tsid::solvers;
+
+namespace {
+
+const unsigned int N_TICKS = 20000;
+
+/// Call f N_TICKS times and return the number of calls per second.
+template <typename F>
+double ticksPerSecond(F f) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (unsigned int i = 0; i < N_TICKS; i++) f();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return N_TICKS / elapsed.count();
+}
+
+void run(Scenario& s) {
+  const HQPStackedData& data =
+      s.formulation->computeStackedProblemData(0.0, s.q, s.v);
+  const HQPStackedLevel& level = data[1];
+  const Eigen::Index n = level.CE.cols();
+  Matrix H(n, n), H_ref(n, n);
+  Vector g(n), g_ref(n);
+
+  const double gemm = ticksPerSecond([&]() {
+    H_ref.setZero();
+    g_ref.setZero();
+    for (const HQPStackedBlock& b : level.blocks) {
+      const auto A = level.CE.middleRows(b.row, b.rows);
+      H_ref.noalias() += b.weight * A.transpose() * A;
+      g_ref.noalias() -=
+          b.weight * A.transpose() * level.ce.segment(b.row, b.rows);
+    }
+  });
+
+  const double kernel = ticksPerSecond([&]() {
+    H.setZero();
+    g.setZero();
+    addLeastSquaresCost(level, H, g);
+  });
+  const double error = (H - H_ref).norm() + (g - g_ref).norm();
+
+  double t = 0.0;
+  const double assembly = ticksPerSecond([&]() {
+    s.formulation->computeStackedProblemData(t, s.q, s.v);
+    H.setZero();
+    g.setZero();
+    addLeastSquaresCost(level, H, g);
+    t += 1e-3;
+  });
+
+  std::cout << s.name << ": " << n << " variables, " << level.CE.rows()
+            << " task rows in " << level.blocks.size() << " tasks\n"
+            << "  general matrix product:          " << gemm << " ticks/s\n"
+            << "  addLeastSquaresCost:             " << kernel << " ticks/s\n"
+            << "  assembly + addLeastSquaresCost:  " << assembly
+            << " ticks/s\n"
+            << "  difference with the general product: " << error
+            << std::endl;
+}
+
+}  // namespace
+
+int main() {
+  Scenario romeo = createRomeo();
+  run(romeo);
+  Scenario quadruped = createQuadruped();
+  run(quadruped);
+  return 0;
+}
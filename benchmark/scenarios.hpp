@@ -0,0 +1,167 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+// Robots and task sets shared by the benchmarks, those of the romeo and
+// quadruped tests.
+
+#ifndef __tsid_benchmark_scenarios_hpp__
+#define __tsid_benchmark_scenarios_hpp__
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tsid/contacts/contact-6d.hpp>
+#include <tsid/contacts/contact-point.hpp>
+#include <tsid/formulations/inverse-dynamics-formulation-acc-force.hpp>
+#include <tsid/robots/robot-wrapper.hpp>
+#include <tsid/tasks/task-com-equality.hpp>
+#include <tsid/tasks/task-joint-posture.hpp>
+#include <tsid/tasks/task-se3-equality.hpp>
+
+#include <pinocchio/algorithm/joint-configuration.hpp>
+
+namespace tsid {
+namespace benchmark {
+
+using namespace tsid::contacts;
+using namespace tsid::math;
+using namespace tsid::robots;
+using namespace tsid::tasks;
+
+const std::string romeo_model_path = TSID_SOURCE_DIR "/models/romeo";
+const std::string quadruped_model_path = TSID_SOURCE_DIR "/models/quadruped";
+
+/// Robot, formulation and tasks of a benchmark, the formulation keeping
+/// references to the tasks.
+struct Scenario {
+  std::string name;
+  std::shared_ptr<RobotWrapper> robot;
+  std::shared_ptr<InverseDynamicsFormulationAccForce> formulation;
+  std::vector<std::shared_ptr<ContactBase> > contacts;
+  std::vector<std::shared_ptr<TaskMotion> > tasks;
+  Vector q;
+  Vector v;
+};
+
+/// Two feet in contact, com, posture and right-hand tasks.
+inline Scenario createRomeo() {
+  Scenario s;
+  s.name = "romeo";
+  std::vector<std::string> package_dirs(1, romeo_model_path);
+  s.robot = std::make_shared<RobotWrapper>(
+      romeo_model_path + "/urdf/romeo.urdf", package_dirs,
+      pinocchio::JointModelFreeFlyer());
+  s.q = pinocchio::neutral(s.robot->model());
+  s.q(2) += 0.84;
+  s.v = Vector::Zero(s.robot->nv());
+  s.formulation =
+      std::make_shared<InverseDynamicsFormulationAccForce>("tsid", *s.robot);
+  s.formulation->computeProblemData(0.0, s.q, s.v);
+  pinocchio::Data& data = s.formulation->data();
+
+  Matrix3x contactPoints(3, 4);
+  contactPoints << -0.077, -0.077, 0.14, 0.14, -0.069, 0.069, -0.069, 0.069,
+      0.105, 0.105, 0.105, 0.105;
+  const std::string feet[] = {"RAnkleRoll", "LAnkleRoll"};
+  for (const std::string& frame : feet) {
+    auto contact = std::make_shared<Contact6d>(
+        "contact_" + frame, *s.robot, frame, contactPoints, Vector3::UnitZ(),
+        0.3, 5.0, 1000.0);
+    contact->Kp(100.0 * Vector::Ones(6));
+    contact->Kd(20.0 * Vector::Ones(6));
+    contact->setReference(s.robot->framePosition(
+        data, s.robot->model().getFrameId(frame)));
+    s.formulation->addRigidContact(*contact, 1e-5);
+    s.contacts.push_back(contact);
+  }
+
+  auto com = std::make_shared<TaskComEquality>("task-com", *s.robot);
+  com->Kp(30.0 * Vector::Ones(3));
+  com->Kd(2.0 * com->Kp().cwiseSqrt());
+  s.formulation->addMotionTask(*com, 1.0, 1);
+  s.tasks.push_back(com);
+
+  auto posture = std::make_shared<TaskJointPosture>("task-posture", *s.robot);
+  posture->Kp(30.0 * Vector::Ones(s.robot->na()));
+  posture->Kd(2.0 * posture->Kp().cwiseSqrt());
+  s.formulation->addMotionTask(*posture, 1e-2, 1);
+  s.tasks.push_back(posture);
+
+  auto hand =
+      std::make_shared<TaskSE3Equality>("task-rhand", *s.robot, "RWristPitch");
+  hand->Kp(50.0 * Vector::Ones(6));
+  hand->Kd(2.0 * hand->Kp().cwiseSqrt());
+  s.formulation->addMotionTask(*hand, 1e-1, 1);
+  s.tasks.push_back(hand);
+  return s;
+}
+
+/// Four point contacts, com and posture tasks.
+inline Scenario createQuadruped() {
+  Scenario s;
+  s.name = "quadruped";
+  std::vector<std::string> package_dirs(1, quadruped_model_path);
+  s.robot = std::make_shared<RobotWrapper>(
+      quadruped_model_path + "/urdf/quadruped.urdf", package_dirs,
+      pinocchio::JointModelFreeFlyer());
+  s.q = pinocchio::neutral(s.robot->model());
+  s.q(2) = 0.5;
+  for (int i = 0; i < 4; i++) {
+    s.q(7 + 2 * i) = -0.4;
+    s.q(8 + 2 * i) = 0.8;
+  }
+  s.v = Vector::Zero(s.robot->nv());
+  s.formulation =
+      std::make_shared<InverseDynamicsFormulationAccForce>("tsid", *s.robot);
+  s.formulation->computeProblemData(0.0, s.q, s.v);
+  pinocchio::Data& data = s.formulation->data();
+
+  const std::string feet[] = {"BL_contact", "BR_contact", "FL_contact",
+                              "FR_contact"};
+  for (const std::string& frame : feet) {
+    auto contact = std::make_shared<ContactPoint>(
+        "contact_" + frame, *s.robot, frame, Vector3::UnitZ(), 0.3, 0.0,
+        1000.0);
+    contact->Kp(10.0 * Vector::Ones(3));
+    contact->Kd(2.0 * std::sqrt(10.0) * Vector::Ones(3));
+    contact->setReference(s.robot->framePosition(
+        data, s.robot->model().getFrameId(frame)));
+    contact->useLocalFrame(false);
+    s.formulation->addRigidContact(*contact, 1e-5, 1.0, 1);
+    s.contacts.push_back(contact);
+  }
+
+  auto com = std::make_shared<TaskComEquality>("task-com", *s.robot);
+  com->Kp(10.0 * Vector::Ones(3));
+  com->Kd(2.0 * com->Kp().cwiseSqrt());
+  s.formulation->addMotionTask(*com, 1.0, 1);
+  s.tasks.push_back(com);
+
+  auto posture = std::make_shared<TaskJointPosture>("task-posture", *s.robot);
+  posture->Kp(10.0 * Vector::Ones(s.robot->na()));
+  posture->Kd(2.0 * posture->Kp().cwiseSqrt());
+  s.formulation->addMotionTask(*posture, 1e-3, 1);
+  s.tasks.push_back(posture);
+  return s;
+}
+
+}  // namespace benchmark
+}  // namespace tsid
+
+#endif  // ifndef __tsid_benchmark_scenarios_hpp__
@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+// Benchmark of the Ruiz equilibration of SolverHQPScaling. The romeo and
+// quadruped tests are simulated while the com tracks a sinusoid, and at every
+// tick the same problem is solved by each backend with and without the
+// scaling. It prints, for each backend, the mean and the largest number of
+// iterations per tick, the number of ticks without an optimal solution and the
+// mean solve time.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <tsid/solvers/solver-HQP-factory.hxx>
+#include <tsid/solvers/solver-HQP-scaling.hpp>
+#include <tsid/solvers/utils.hpp>
+#include <tsid/trajectories/trajectory-base.hpp>
+
+#include "scenarios.hpp"
+
+using namespace tsid;
+using namespace tsid::benchmark;
+using namespace tsid::math;
+using namespace tsid::solvers;
+using namespace tsid::trajectories;
+
+namespace {
+
+const unsigned int N_TICKS = 2000;
+const double DT = 1e-3;
+const double PI = 3.14159265358979323846;
+
+/// Iterations and solve times of a solver over the simulation.
+struct SolverStatistics {
+  std::string name;
+  std::shared_ptr<SolverHQPBase> solver;
+  unsigned long iterations;
+  int maxIterations;
+  unsigned int failures;
+  double time;
+
+  SolverStatistics(const std::string& name, SolverHQPBase* solver)
+      : name(name),
+        solver(solver),
+        iterations(0),
+        maxIterations(0),
+        failures(0),
+        time(0.0) {}
+
+  const HQPOutput& solve(const HQPStackedData& data) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    const HQPOutput& output = solver->solve(data);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    time += elapsed.count();
+    iterations += output.iterations;
+    maxIterations = std::max(maxIterations, output.iterations);
+    if (output.status != HQP_STATUS_OPTIMAL) failures++;
+    return output;
+  }
+
+  void print() const {
+    std::cout << "  " << name << ": " << double(iterations) / N_TICKS
+              << " iterations per tick (max " << maxIterations << "), "
+              << failures << " failures, " << 1e6 * time / N_TICKS
+              << " us per tick\n";
+  }
+};
+
+void run(Scenario& s) {
+  std::vector<std::pair<SolverHQP, std::string> > backends;
+  backends.push_back(
+      std::make_pair(SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog-fast"));
+  backends.push_back(std::make_pair(SOLVER_HQP_EIQUADPROG_STRUCTURED,
+                                    "eiquadprog-structured"));
+#ifdef TSID_WITH_PROXSUITE
+  backends.push_back(std::make_pair(SOLVER_HQP_PROXQP, "proxqp"));
+#endif
+#ifdef TSID_WITH_OSQP
+  backends.push_back(std::make_pair(SOLVER_HQP_OSQP, "osqp"));
+#endif
+
+  std::vector<SolverStatistics> plain, scaled;
+  for (const std::pair<SolverHQP, std::string>& b : backends) {
+    plain.push_back(SolverStatistics(
+        b.second, SolverHQPFactory::createNewSolver(b.first, b.second)));
+    scaled.push_back(SolverStatistics(
+        b.second + " + scaling",
+        new SolverHQPScaling("scaling", SolverHQPFactory::createNewSolver(
+                                            b.first, b.second))));
+  }
+
+  // The com oscillates sideways, so that the contact forces and the active
+  // set change along the simulation
+  TaskComEquality& com = dynamic_cast<TaskComEquality&>(*s.tasks[0]);
+  const Vector3 com0 = s.robot->com(s.formulation->data());
+  TrajectorySample sample(3);
+  const double amplitude = 0.05, omega = 2.0 * PI;
+
+  double t = 0.0;
+  for (unsigned int i = 0; i < N_TICKS; i++) {
+    sample.pos = com0;
+    sample.pos(1) += amplitude * std::sin(omega * t);
+    sample.vel.setZero();
+    sample.vel(1) = amplitude * omega * std::cos(omega * t);
+    sample.acc.setZero();
+    sample.acc(1) = -amplitude * omega * omega * std::sin(omega * t);
+    com.setReference(sample);
+
+    const HQPStackedData& data =
+        s.formulation->computeStackedProblemData(t, s.q, s.v);
+    for (SolverStatistics& stats : scaled) stats.solve(data);
+    for (std::size_t k = 1; k < plain.size(); k++) plain[k].solve(data);
+
+    // the first backend drives the simulation
+    const HQPOutput& output = plain[0].solve(data);
+    if (output.status == HQP_STATUS_OPTIMAL) {
+      s.v += DT * s.formulation->getAccelerations(output);
+      s.q = pinocchio::integrate(s.robot->model(), s.q, DT * s.v);
+    }
+    t += DT;
+  }
+
+  const HQPStackedLevel& level0 =
+      s.formulation->computeStackedProblemData(t, s.q, s.v)[0];
+  std::cout << s.name << ": " << level0.CE.cols() << " variables, "
+            << level0.CE.rows() << " equalities, " << level0.CI.rows()
+            << " inequalities, " << N_TICKS << " ticks\n";
+  for (std::size_t k = 0; k < plain.size(); k++) {
+    plain[k].print();
+    scaled[k].print();
+  }
+}
+
+}  // namespace
+
+int main() {
+  Scenario romeo = createRomeo();
+  run(romeo);
+  Scenario quadruped = createQuadruped();
+  run(quadruped);
+  return 0;
+}
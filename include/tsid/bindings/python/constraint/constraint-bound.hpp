@@ -44,6 +44,7 @@ struct ConstraintPythonVisitor
 
         .add_property("rows", &ConstraintBound::rows)
         .add_property("cols", &ConstraintBound::cols)
+        .add_property("colOffset", &ConstraintBound::colOffset)
         .def("resize", &ConstraintBound::resize, (bp::arg("r"), bp::arg("c")),
              "Resize constraint size.")
 
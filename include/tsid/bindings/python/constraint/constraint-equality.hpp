@@ -44,6 +44,7 @@ struct ConstraintEqPythonVisitor
 
         .add_property("rows", &ConstraintEquality::rows)
         .add_property("cols", &ConstraintEquality::cols)
+        .add_property("colOffset", &ConstraintEquality::colOffset)
         .def("resize", &ConstraintEquality::resize,
              (bp::arg("r"), bp::arg("c")), "Resize constraint size.")
 
@@ -44,6 +44,7 @@ struct ConstraintIneqPythonVisitor
 
         .add_property("rows", &ConstraintInequality::rows)
         .add_property("cols", &ConstraintInequality::cols)
+        .add_property("colOffset", &ConstraintInequality::colOffset)
         .def("resize", &ConstraintInequality::resize,
              (bp::arg("r"), bp::arg("c")), "Resize constraint size.")
 
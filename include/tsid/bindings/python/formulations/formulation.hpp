@@ -53,6 +53,8 @@ struct InvDynPythonVisitor
         .add_property("nVar", &T::nVar)
         .add_property("nEq", &T::nEq)
         .add_property("nIn", &T::nIn)
+        .add_property("useBoundConstraints", &T::getUseBoundConstraints,
+                      &T::setUseBoundConstraints)
 
         .def("addMotionTask", &InvDynPythonVisitor::addMotionTask_SE3,
              bp::args("task", "weight", "priorityLevel", "transition duration"))
@@ -76,6 +78,16 @@ struct InvDynPythonVisitor
              bp::args("task", "weight", "priorityLevel", "transition duration"))
         .def("updateTaskWeight", &InvDynPythonVisitor::updateTaskWeight,
              bp::args("task_name", "weight"))
+        .def("getTaskHandle", &InvDynPythonVisitor::getTaskHandle,
+             bp::args("task_name"))
+        .def("updateTaskWeight", &InvDynPythonVisitor::updateTaskWeightHandle,
+             bp::args("task_handle", "weight"))
+        .def("getContactHandle", &InvDynPythonVisitor::getContactHandle,
+             bp::args("contact_name"))
+        .def("updateRigidContactWeights",
+             &InvDynPythonVisitor::updateRigidContactWeightsHandle,
+             bp::args("contact_handle", "force_regularization_weight",
+                      "motion_weight"))
         .def("updateRigidContactWeights",
              &InvDynPythonVisitor::updateRigidContactWeights,
              bp::args("contact_name", "force_regularization_weight"))
@@ -113,6 +125,11 @@ struct InvDynPythonVisitor
              bp::args("task_name", "duration"))
         .def("removeRigidContact", &InvDynPythonVisitor::removeRigidContact,
              bp::args("contact_name", "duration"))
+        .def("removeTask", &InvDynPythonVisitor::removeTaskHandle,
+             bp::args("task_handle", "duration"))
+        .def("removeRigidContact",
+             &InvDynPythonVisitor::removeRigidContactHandle,
+             bp::args("contact_handle", "duration"))
         .def("removeFromHqpData", &InvDynPythonVisitor::removeFromHqpData,
              bp::args("constraint_name"))
         .def("computeProblemData", &InvDynPythonVisitor::computeProblemData,
@@ -127,7 +144,9 @@ struct InvDynPythonVisitor
         .def("checkContact", &InvDynPythonVisitor::checkContact,
              bp::args("name", "HQPOutput"))
         .def("getContactForce", &InvDynPythonVisitor::getContactForce,
-             bp::args("name", "HQPOutput"));
+             bp::args("name", "HQPOutput"))
+        .def("getContactForce", &InvDynPythonVisitor::getContactForceHandle,
+             bp::args("contact_handle", "HQPOutput"));
   }
   static pinocchio::Data data(T& self) {
     pinocchio::Data data = self.data();
@@ -184,6 +203,21 @@ struct InvDynPythonVisitor
                                double weight) {
     return self.updateTaskWeight(task_name, weight);
   }
+  static int getTaskHandle(T& self, const std::string& task_name) {
+    return self.getTaskHandle(task_name);
+  }
+  static bool updateTaskWeightHandle(T& self, int task_handle, double weight) {
+    return self.updateTaskWeight(task_handle, weight);
+  }
+  static int getContactHandle(T& self, const std::string& contact_name) {
+    return self.getContactHandle(contact_name);
+  }
+  static bool updateRigidContactWeightsHandle(
+      T& self, int contact_handle, double force_regularization_weight,
+      double motion_weight) {
+    return self.updateRigidContactWeights(
+        contact_handle, force_regularization_weight, motion_weight);
+  }
   static bool updateRigidContactWeights(T& self,
                                         const std::string& contact_name,
                                         double force_regularization_weight) {
@@ -241,6 +275,14 @@ struct InvDynPythonVisitor
                                  double transition_duration) {
     return self.removeRigidContact(contactName, transition_duration);
   }
+  static bool removeTaskHandle(T& self, int task_handle,
+                               double transition_duration) {
+    return self.removeTask(task_handle, transition_duration);
+  }
+  static bool removeRigidContactHandle(T& self, int contact_handle,
+                                       double transition_duration) {
+    return self.removeRigidContact(contact_handle, transition_duration);
+  }
   static bool removeFromHqpData(T& self, const std::string& constraintName) {
     return self.removeFromHqpData(constraintName);
   }
@@ -273,6 +315,10 @@ struct InvDynPythonVisitor
                                          const solvers::HQPOutput& sol) {
     return self.getContactForces(name, sol);
   }
+  static Eigen::VectorXd getContactForceHandle(T& self, int contact_handle,
+                                               const solvers::HQPOutput& sol) {
+    return self.getContactForces(contact_handle, sol);
+  }
 
   static void expose(const std::string& class_name) {
     std::string doc = "InvDyn info.";
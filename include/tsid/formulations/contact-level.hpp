@@ -21,6 +21,8 @@
 #include "tsid/math/fwd.hpp"
 #include "tsid/contacts/contact-base.hpp"
 
+#include <cstdint>
+
 namespace tsid {
 
 /** Data structure collecting information regarding a single contact.
@@ -39,6 +41,21 @@ struct ContactLevel {
   std::shared_ptr<math::ConstraintEquality> forceRegTask;
   unsigned int index;  /// index of 1st element of associated force variable in
                        /// the force vector
+  unsigned int motionPriority;  /// priority level of the motion constraint
+  unsigned int motionRow;    /// index of the first row of the motion constraint
+                             /// in the stacked data
+  unsigned int forceRow;     /// index of the first row of the force constraint
+                             /// in the stacked data
+  unsigned int forceRegRow;  /// index of the first row of the force
+                             /// regularization task in the stacked data
+  unsigned int motionIndex;    /// position of the motion constraint in its
+                               /// priority level of the HQP data
+  unsigned int forceRegIndex;  /// position of the force regularization task
+                               /// in its priority level of the HQP data
+  std::uint64_t forceMatrixVersion;     /// version of the force constraint
+                                        /// matrix copied, 0 if none
+  std::uint64_t forceRegMatrixVersion;  /// version of the force
+                                        /// regularization matrix copied
 
   ContactLevel(contacts::ContactBase& contact);
 };
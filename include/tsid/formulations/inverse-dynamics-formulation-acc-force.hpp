@@ -52,6 +52,8 @@ class InverseDynamicsFormulationAccForce
   typedef tasks::TaskActuation TaskActuation;
   typedef contacts::MeasuredForceBase MeasuredForceBase;
   typedef solvers::HQPOutput HQPOutput;
+  typedef solvers::HQPStackedLevel HQPStackedLevel;
+  typedef solvers::HQPStackedBlock HQPStackedBlock;
 
   InverseDynamicsFormulationAccForce(const std::string& name,
                                      RobotWrapper& robot, bool verbose = false);
@@ -64,6 +66,14 @@ class InverseDynamicsFormulationAccForce
   unsigned int nEq() const;
   unsigned int nIn() const;
 
+  /** If true, the motion and force tasks with bounds that are added
+   * afterwards are passed to the solvers as a ConstraintBound over all the
+   * variables (infinite for the variables not bounded by the task), which
+   * solvers like qpmad and ProxQP handle as a box. Otherwise, and by default,
+   * they are passed as a ConstraintInequality with one row per bound. */
+  void setUseBoundConstraints(bool useBoundConstraints);
+  bool getUseBoundConstraints() const;
+
   bool addMotionTask(TaskMotion& task, double weight,
                      unsigned int priorityLevel,
                      double transition_duration = 0.0);
@@ -78,6 +88,10 @@ class InverseDynamicsFormulationAccForce
 
   bool updateTaskWeight(const std::string& task_name, double weight);
 
+  int getTaskHandle(const std::string& task_name) const;
+
+  bool updateTaskWeight(int task_handle, double weight);
+
   bool addRigidContact(ContactBase& contact, double force_regularization_weight,
                        double motion_weight = 1.0,
                        unsigned int motion_priority_level = 0);
@@ -88,25 +102,41 @@ class InverseDynamicsFormulationAccForce
                                  double force_regularization_weight,
                                  double motion_weight = -1.0);
 
+  int getContactHandle(const std::string& contact_name) const;
+
+  bool updateRigidContactWeights(int contact_handle,
+                                 double force_regularization_weight,
+                                 double motion_weight = -1.0);
+
   bool addMeasuredForce(MeasuredForceBase& measuredForce);
 
   bool removeTask(const std::string& taskName,
                   double transition_duration = 0.0);
 
+  bool removeTask(int taskHandle, double transition_duration = 0.0);
+
   bool removeRigidContact(const std::string& contactName,
                           double transition_duration = 0.0);
 
+  bool removeRigidContact(int contactHandle, double transition_duration = 0.0);
+
   bool removeMeasuredForce(const std::string& measuredForceName);
 
   const HQPData& computeProblemData(double time, ConstRefVector q,
                                     ConstRefVector v);
 
+  const HQPStackedData& computeStackedProblemData(double time,
+                                                  ConstRefVector q,
+                                                  ConstRefVector v);
+
   const Vector& getActuatorForces(const HQPOutput& sol);
   const Vector& getAccelerations(const HQPOutput& sol);
   const Vector& getContactForces(const HQPOutput& sol);
   Vector getContactForces(const std::string& name, const HQPOutput& sol);
   bool getContactForces(const std::string& name, const HQPOutput& sol,
                         RefVector f);
+  Vector getContactForces(int contactHandle, const HQPOutput& sol);
+  bool getContactForces(int contactHandle, const HQPOutput& sol, RefVector f);
 
  public:
   template <class TaskLevelPointer>
@@ -119,13 +149,81 @@ class InverseDynamicsFormulationAccForce
 
   bool decodeSolution(const HQPOutput& sol);
 
+  /// Rows of the problem data a constraint is written to: either the
+  /// matrices of the constraint itself or its rows in the stacked data.
+  struct ConstraintRows {
+    ConstraintRows(math::ConstraintBase& constraint, math::RefMatrix A,
+                   math::RefVector b, math::RefVector lb, math::RefVector ub)
+        : b(b), lb(lb), ub(ub), m_constraint(constraint), m_A(A) {}
+
+    /// Rows of the matrix, whose version is changed because they are about
+    /// to be written.
+    math::RefMatrix A() {
+      m_constraint.markMatrixChanged();
+      return m_A;
+    }
+
+    math::RefVector b;   /// only for equalities
+    math::RefVector lb;  /// only for inequalities
+    math::RefVector ub;  /// only for inequalities
+
+   private:
+    math::ConstraintBase& m_constraint;
+    math::RefMatrix m_A;
+  };
+
+  ConstraintRows constraintRows(math::ConstraintBase& constraint,
+                                unsigned int priorityLevel,
+                                unsigned int stackedRow);
+
+  void assembleProblemData(double time, ConstRefVector q, ConstRefVector v);
+
+  void updateStackedLayout();
+
+  /// Forget the versions of the matrices copied into the problem data, so
+  /// that they are all copied again by the next call to assembleProblemData.
+  void resetMatrixVersions();
+
+  unsigned int findStackedRow(unsigned int priorityLevel,
+                              const math::ConstraintBase* constraint) const;
+
+  /// Entry of the task handle table.
+  struct TaskHandleEntry {
+    std::string name;
+    std::shared_ptr<math::ConstraintBase> constraint;  /// null once removed
+    unsigned int priority;
+    unsigned int hqpIndex;  /// position of the constraint in its level
+  };
+
+  /// Refresh the positions of the constraints referenced by the handles,
+  /// to be called whenever constraints are added to or removed from
+  /// m_hqpData.
+  void updateHqpIndices();
+
+  unsigned int findHqpIndex(unsigned int priorityLevel,
+                            const math::ConstraintBase* constraint) const;
+
+  /// Resolve the contact associated to each force task.
+  void updateAssociatedContacts();
+
+  /// Set the columns spanned by the contact and force task constraints, so
+  /// that they only store the force variables they depend on.
+  void updateColumnSpans();
+
   Data m_data;
   HQPData m_hqpData;
+  HQPStackedData m_stackedData;
+  bool m_stackedLayoutDirty;  /// constraints added/removed since last layout
+  bool m_assembleStacked;     /// write the problem data into m_stackedData
+  bool m_useBoundConstraints;  /// pass the bound tasks as ConstraintBound
   std::vector<std::shared_ptr<TaskLevel>> m_taskMotions;
   std::vector<std::shared_ptr<TaskLevelForce>> m_taskContactForces;
   std::vector<std::shared_ptr<TaskLevel>> m_taskActuations;
   std::vector<std::shared_ptr<ContactLevel>> m_contacts;
   std::vector<std::shared_ptr<MeasuredForceLevel>> m_measuredForces;
+  std::vector<TaskHandleEntry> m_taskHandles;
+  std::vector<std::shared_ptr<ContactLevel>>
+      m_contactHandles;  /// null once the contact has been removed
   double m_t;         /// time
   unsigned int m_k;   /// number of contact-force variables
   unsigned int m_v;   /// number of acceleration variables
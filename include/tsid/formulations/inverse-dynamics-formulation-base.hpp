@@ -28,16 +28,23 @@
 #include "tsid/contacts/measured-force-base.hpp"
 #include "tsid/solvers/solver-HQP-base.hpp"
 
+#include <cstdint>
 #include <string>
 
 namespace tsid {
 
+struct ContactLevel;
+
 struct TaskLevel {
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   tasks::TaskBase& task;
   std::shared_ptr<math::ConstraintBase> constraint;
   unsigned int priority;
+  unsigned int stackedRow;  /// index of the first row of the constraint in
+                            /// the stacked data of its priority level
+  std::uint64_t matrixVersion;  /// version of the task matrix copied into
+                                /// the problem data, 0 if none
 
   TaskLevel(tasks::TaskBase& task, unsigned int priority);
 };
@@ -48,6 +55,14 @@ struct TaskLevelForce {
   tasks::TaskContactForce& task;
   std::shared_ptr<math::ConstraintBase> constraint;
   unsigned int priority;
+  unsigned int stackedRow;  /// index of the first row of the constraint in
+                            /// the stacked data of its priority level
+  std::shared_ptr<ContactLevel> contact;  /// associated contact, null if the
+                                          /// task acts on all contact forces
+  std::uint64_t associationVersion;  /// association version of the task when
+                                    /// the contact was resolved
+  std::uint64_t matrixVersion;  /// version of the task matrix copied into
+                                /// the problem data, 0 if none
 
   TaskLevelForce(tasks::TaskContactForce& task, unsigned int priority);
 };
@@ -78,6 +93,7 @@ class InverseDynamicsFormulationBase {
   typedef contacts::MeasuredForceBase MeasuredForceBase;
   typedef contacts::ContactBase ContactBase;
   typedef solvers::HQPData HQPData;
+  typedef solvers::HQPStackedData HQPStackedData;
   typedef solvers::HQPOutput HQPOutput;
   typedef robots::RobotWrapper RobotWrapper;
 
@@ -107,6 +123,19 @@ class InverseDynamicsFormulationBase {
   virtual bool updateTaskWeight(const std::string& task_name,
                                 double weight) = 0;
 
+  /**
+   * @brief Get the handle of a task, which can be used in place of its name
+   * to update, remove or query the task without any string comparison.
+   * Handles are never reused, even after the task has been removed. The
+   * formulations that do not support handles always return -1, and the
+   * functions taking a handle return false.
+   * @param task_name Name of the task
+   * @return The handle of the task, or -1 if the task has not been found
+   */
+  virtual int getTaskHandle(const std::string& task_name) const;
+
+  virtual bool updateTaskWeight(int task_handle, double weight);
+
   /**
    * @brief Add a rigid contact constraint to the model, introducing the
    * associated reaction forces as problem variables.
@@ -138,29 +167,65 @@ class InverseDynamicsFormulationBase {
                                          double force_regularization_weight,
                                          double motion_weight = -1.0) = 0;
 
+  /**
+   * @brief Get the handle of a rigid contact, which can be used in place of
+   * its name to update, remove or query the contact without any string
+   * comparison. Handles are never reused, even after the contact has been
+   * removed. The formulations that do not support handles always return -1,
+   * and the functions taking a handle return false.
+   * @param contact_name Name of the contact
+   * @return The handle of the contact, or -1 if the contact has not been found
+   */
+  virtual int getContactHandle(const std::string& contact_name) const;
+
+  virtual bool updateRigidContactWeights(int contact_handle,
+                                         double force_regularization_weight,
+                                         double motion_weight = -1.0);
+
   virtual bool addMeasuredForce(MeasuredForceBase& measuredForce) = 0;
 
   virtual bool removeTask(const std::string& taskName,
                           double transition_duration = 0.0) = 0;
 
+  virtual bool removeTask(int taskHandle, double transition_duration = 0.0);
+
   virtual bool removeRigidContact(const std::string& contactName,
                                   double transition_duration = 0.0) = 0;
 
+  virtual bool removeRigidContact(int contactHandle,
+                                  double transition_duration = 0.0);
+
   virtual bool removeMeasuredForce(const std::string& measuredForceName) = 0;
 
   virtual const HQPData& computeProblemData(double time, ConstRefVector q,
                                             ConstRefVector v) = 0;
 
+  /**
+   * @brief Same as computeProblemData, but the constraints of each priority
+   * level are written directly into contiguous matrices owned by the
+   * formulation, so that the problem data do not need to be copied again
+   * before being passed to a solver. By default the data returned by
+   * computeProblemData are stacked.
+   * @return The stacked problem data, one element per priority level
+   */
+  virtual const HQPStackedData& computeStackedProblemData(double time,
+                                                          ConstRefVector q,
+                                                          ConstRefVector v);
+
   virtual const Vector& getActuatorForces(const HQPOutput& sol) = 0;
   virtual const Vector& getAccelerations(const HQPOutput& sol) = 0;
   virtual const Vector& getContactForces(const HQPOutput& sol) = 0;
   virtual bool getContactForces(const std::string& name, const HQPOutput& sol,
                                 RefVector f) = 0;
+  virtual bool getContactForces(int contactHandle, const HQPOutput& sol,
+                                RefVector f);
 
  protected:
   std::string m_name;
   RobotWrapper m_robot;
   bool m_verbose;
+  HQPStackedData m_stackedProblemData;  /// stacked data of the default
+                                        /// computeStackedProblemData
 };
 
 }  // namespace tsid
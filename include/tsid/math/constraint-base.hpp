@@ -19,18 +19,44 @@
 #define __invdyn_math_constraint_base_hpp__
 
 #include "tsid/math/fwd.hpp"
+#include <cstdint>
 #include <string>
 #include <pinocchio/macros.hpp>
 
 namespace tsid {
 namespace math {
 
+/** Structure of the matrix of a constraint. Besides a dense matrix, each row
+ * of the matrix may contain a single nonzero weight w_i in the column c_i,
+ * so that multiplying by the matrix reduces to gathering and scaling rows. */
+enum ConstraintMatrixStructure {
+  CONSTRAINT_MATRIX_DENSE = 0,       /// any matrix
+  CONSTRAINT_MATRIX_SELECTION,       /// A(i, c_i) = w_i, the rest is zero
+  CONSTRAINT_MATRIX_DIAGONAL,        /// square matrix with A = diag(w)
+  CONSTRAINT_MATRIX_SCALED_IDENTITY  /// square matrix with A = w_0 * I
+};
+
 /**
  * @brief Abstract class representing a linear equality/inequality constraint.
  * Equality constraints are represented by a matrix A and a vector b: A*x = b
  * Inequality constraints are represented by a matrix A and two vectors
  * lb and ub: lb <= A*x <= ub
  * Bounds are represented by two vectors lb and ub: lb <= x <= ub
+ *
+ * The matrix may only span a range of the variables: the constraint then
+ * applies to x.segment(colOffset(), cols()), so that the columns that are
+ * always zero are not stored. Inside this range, the columns that can be
+ * nonzero may be further restricted by a column support, e.g. the joints
+ * supporting the frame of a task, so that the products with the matrix skip
+ * the other columns.
+ *
+ * The matrix may declare a selection structure (see setSelectionMatrix), so
+ * that its users can replace the products with the matrix by row gathers and
+ * scalings.
+ *
+ * The matrix carries a version number, which changes every time the matrix may
+ * have been modified, so that the users of the constraint can skip copying a
+ * matrix that did not change since they last read it.
  */
 class ConstraintBase {
  public:
@@ -58,6 +84,8 @@ class ConstraintBase {
   virtual const Vector& lowerBound() const = 0;
   virtual const Vector& upperBound() const = 0;
 
+  /** Same as matrixForWrite: the matrix is assumed to be modified. Read it
+   * through the const overload, which has no side effect. */
   virtual Matrix& matrix();
   virtual Vector& vector() = 0;
   virtual Vector& lowerBound() = 0;
@@ -70,9 +98,74 @@ class ConstraintBase {
 
   virtual bool checkConstraint(ConstRefVector x, double tol = 1e-6) const = 0;
 
+  /** Access the matrix to modify it: the version of the matrix changes and
+   * its structure is reset to dense. */
+  Matrix& matrixForWrite();
+
+  /** Version of the matrix. It is unique among all the constraints and it is
+   * changed by setMatrix, resize, the non-const access to the matrix and
+   * markMatrixChanged. */
+  std::uint64_t matrixVersion() const { return m_matrixVersion; }
+
+  /** Give a new version to the matrix. Call it after modifying the matrix
+   * through a reference kept from an earlier non-const access. */
+  void markMatrixChanged();
+
+  /** Index of the variable corresponding to the first column of the matrix
+   * (0 by default). */
+  unsigned int colOffset() const { return m_colOffset; }
+
+  /** Set the index of the variable corresponding to the first column of the
+   * matrix. The version of the matrix changes if the offset changes. */
+  void setColOffset(const unsigned int offset);
+
+  /** Columns of the matrix that can be nonzero, relative to its first column.
+   * Empty if any column can be nonzero, which is the default. The support is
+   * cleared by resize. */
+  const ColumnSupport& columnSupport() const { return m_columnSupport; }
+
+  /** Set the columns of the matrix that can be nonzero. The version of the
+   * matrix changes if the support changes. */
+  void setColumnSupport(const ColumnSupport& support);
+
+  /** Structure of the matrix, CONSTRAINT_MATRIX_DENSE by default. The
+   * structure is reset to dense by setMatrix, resize and the non-const access
+   * to the matrix. */
+  ConstraintMatrixStructure matrixStructure() const {
+    return m_matrixStructure;
+  }
+
+  /** Column c_i of the nonzero entry of each row, if the matrix is not dense.
+   */
+  const VectorXi& selectedColumns() const { return m_selectedColumns; }
+
+  /** Weight w_i of the nonzero entry of each row, if the matrix is not dense.
+   */
+  const Vector& selectionWeights() const { return m_selectionWeights; }
+
+  /** Set the matrix to A(i, cols(i)) = weights(i), the other entries being
+   * zero, without changing its size. The structure of the matrix is set to
+   * diagonal or scaled identity if possible, to selection otherwise. */
+  void setSelectionMatrix(const VectorXi& cols, ConstRefVector weights);
+
+  /** Declare the structure of the matrix of other for this matrix, which must
+   * have been, or is about to be, set equal to the matrix of other. The
+   * version of the matrix changes if the structure changes. */
+  void copyMatrixStructure(const ConstraintBase& other);
+
  protected:
+  /** Return the variables the constraint applies to, x being either all the
+   * variables or only the ones spanned by the matrix. */
+  ConstRefVector spannedVariables(ConstRefVector x) const;
+
   std::string m_name;
   Matrix m_A;
+  std::uint64_t m_matrixVersion;
+  unsigned int m_colOffset;
+  ColumnSupport m_columnSupport;
+  ConstraintMatrixStructure m_matrixStructure;
+  VectorXi m_selectedColumns;
+  Vector m_selectionWeights;
 };
 
 }  // namespace math
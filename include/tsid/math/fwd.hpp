@@ -19,6 +19,7 @@
 #define __invdyn_math_fwd_hpp__
 
 #include <Eigen/Core>
+#include <vector>
 
 #ifdef EIGEN_RUNTIME_NO_MALLOC
 #define EIGEN_MALLOC_ALLOWED Eigen::internal::set_is_malloc_allowed(true);
@@ -52,6 +53,23 @@ typedef const Eigen::Ref<const Matrix> ConstRefMatrix;
 
 typedef std::size_t Index;
 
+/** Range [col, col + cols) of the columns of a matrix. */
+struct ColumnRange {
+  ColumnRange(unsigned int col = 0, unsigned int cols = 0)
+      : col(col), cols(cols) {}
+  bool operator==(const ColumnRange& other) const {
+    return col == other.col && cols == other.cols;
+  }
+  bool operator!=(const ColumnRange& other) const { return !(*this == other); }
+
+  unsigned int col;
+  unsigned int cols;
+};
+
+/** Sorted and disjoint ranges of the columns of a matrix that can be nonzero,
+ * empty if any column can be nonzero. */
+typedef std::vector<ColumnRange> ColumnSupport;
+
 // Forward declaration of constraints
 class ConstraintBase;
 class ConstraintEquality;
@@ -134,6 +134,13 @@ void nullSpaceBasisFromDecomposition(
     const Eigen::JacobiSVD<Eigen::MatrixXd>& svdDecomposition, int rank,
     double* nullSpaceBasisMatrix, int& rows, int& cols);
 
+/**
+ * Add the columns [col, col + cols) to a column support, keeping its ranges
+ * sorted and merging the ones that overlap or touch.
+ */
+void addColumnRange(ColumnSupport& support, unsigned int col,
+                    unsigned int cols);
+
 template <typename Derived>
 inline bool isFinite(const Eigen::MatrixBase<Derived>& x) {
   return ((x - x).array() == (x - x).array()).all();
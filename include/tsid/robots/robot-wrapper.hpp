@@ -160,6 +160,11 @@ class RobotWrapper {
   void frameJacobianLocal(Data& data, const Model::FrameIndex index,
                           Data::Matrix6x& J) const;
 
+  /** Columns of the frame Jacobian that can be nonzero, i.e. the velocities
+   * of the joints supporting the frame in the kinematic tree. */
+  math::ColumnSupport frameJacobianSupport(
+      const Model::FrameIndex index) const;
+
   const Data::Matrix6x& momentumJacobian(const Data& data) const;
 
   Vector3 angularMomentumTimeVariation(const Data& data) const;
@@ -23,6 +23,7 @@
 #include "tsid/config.hh"
 #include "tsid/math/fwd.hpp"
 #include "tsid/solvers/solver-qpData.hpp"
+#include "tsid/solvers/solver-HQP-stacked-data.hpp"
 #include <pinocchio/container/aligned-vector.hpp>
 
 #define DEFAULT_HESSIAN_REGULARIZATION 1e-8
@@ -53,6 +54,10 @@ enum TSID_DLLAPI SolverHQP {
   ,
   SOLVER_HQP_OASES
 #endif
+  ,
+  SOLVER_HQP_EIQUADPROG_CASCADE,
+  SOLVER_HQP_EIQUADPROG_STRUCTURED,
+  SOLVER_HQP_AUTOTUNER
 };
 
 /**
@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_autotuner_hpp__
+#define __invdyn_solvers_hqp_autotuner_hpp__
+
+#include "tsid/solvers/solver-HQP-base.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace tsid {
+namespace solvers {
+/**
+ * @brief Solver selecting the fastest of several HQP solvers on the problems
+ * it actually solves.
+ *
+ * During a warm-up window (see setWarmupLength), every problem is solved by
+ * all the candidate solvers, measuring the time taken by each of them, and
+ * the output of the first candidate, which is the reference, is returned.
+ * A candidate is disqualified if its solution differs from the one of the
+ * reference by more than the tolerance (see setTolerance), or if its status
+ * differs. At the end of the window, the qualified candidate with the
+ * smallest percentile of its solve times (see setPercentile) is selected, and
+ * the following problems are only solved by it. The first problem of the
+ * window is not timed, as the candidates allocate their workspace.
+ *
+ * A new warm-up window starts when the size of the problem changes (e.g. when
+ * a contact is added or removed), or when restart is called.
+ * SolverHQPFactory::createNewSolver(SOLVER_HQP_AUTOTUNER, name) creates an
+ * autotuner with all the solvers compiled in TSID as candidates,
+ * SolverHQuadProgFast being the reference, except SolverHQuadProgCascade
+ * which solves a different problem when there are more than two levels (it
+ * can be added with addSolver for problems with at most two levels). As the
+ * solvers lay out their multipliers differently, getSelectedSolver tells
+ * which candidate computed the output.
+ */
+class TSID_DLLAPI SolverHQPAutotuner : public SolverHQPBase {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef math::Vector Vector;
+
+  SolverHQPAutotuner(const std::string& name);
+
+  /** Add solver at the end of the candidates, the first one being the
+   * reference. The solver is deleted with this object. */
+  void addSolver(SolverHQPBase* solver);
+
+  /** Get the number of candidate solvers. */
+  unsigned int getNumberOfSolvers() const {
+    return static_cast<unsigned int>(m_solvers.size());
+  }
+
+  /** Get the i-th candidate solver. */
+  SolverHQPBase& solver(unsigned int i);
+
+  void resize(unsigned int n, unsigned int neq, unsigned int nin);
+
+  using SolverHQPBase::solve;
+
+  /** Solve the given Hierarchical Quadratic Program
+   */
+  const HQPOutput& solve(const HQPStackedData& problemData);
+
+  /** Stack the problem data. The QP data are retrieved by the candidate
+   * solvers. */
+  void retrieveQPData(const HQPData& problemData,
+                      const bool hessianRegularization = true);
+
+  /** Get the objective value of the solver whose output was returned by the
+   * last call to solve. */
+  double getObjectiveValue();
+
+  void setUseWarmStart(bool useWarmStart);
+  bool setMaximumIterations(unsigned int maxIter);
+  bool setMaximumTime(double seconds);
+
+  /** Get the number of problems of the warm-up window. */
+  unsigned int getWarmupLength() const { return m_warmupLength; }
+  /** Set the number of problems of the warm-up window (100 by default). */
+  bool setWarmupLength(unsigned int length);
+
+  /** Get the tolerance on the distance to the solution of the reference. */
+  double getTolerance() const { return m_tolerance; }
+  /** Set the tolerance on the distance to the solution of the reference,
+   * relative to 1 + the norm of this solution (1e-3 by default). */
+  bool setTolerance(double tolerance);
+
+  /** Get the percentile of the solve times used to compare the candidates. */
+  double getPercentile() const { return m_percentile; }
+  /** Set the percentile of the solve times used to compare the candidates,
+   * between 0 and 1 (0.9 by default). */
+  bool setPercentile(double percentile);
+
+  /** Start a new warm-up window. */
+  void restart();
+
+  /** Get the index of the selected solver, -1 during the warm-up window. */
+  int getSelectedSolver() const { return m_selected; }
+
+  /** Return true if the i-th candidate has not been disqualified in the
+   * current (or last) warm-up window. */
+  bool isQualified(unsigned int i) const;
+
+  /** Get the given percentile of the solve times of the i-th candidate in
+   * the current (or last) warm-up window [s], 0 if none was measured. */
+  double getSolveTime(unsigned int i, double percentile) const;
+
+ protected:
+  void sendMsg(const std::string& s);
+
+  /** Solve the problem with all the candidates and return the output of the
+   * reference. */
+  const HQPOutput& solveAll(const HQPStackedData& problemData);
+
+  /** Select the fastest qualified candidate. */
+  void select();
+
+  std::vector<std::unique_ptr<SolverHQPBase> > m_solvers;
+  std::vector<std::vector<double> > m_solveTimes;  /// times of each candidate
+  std::vector<bool> m_qualified;
+  unsigned int m_warmupLength;
+  unsigned int m_warmupCount;  /// problems solved in the warm-up window
+  double m_tolerance;
+  double m_percentile;
+  int m_selected;
+  int m_outputSolver;  /// index of the solver of the last output
+
+  unsigned int m_neq;  /// number of equality constraints
+  unsigned int m_nin;  /// number of inequality constraints
+  unsigned int m_n;    /// number of variables
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_autotuner_hpp__
@@ -20,6 +20,7 @@
 
 #include "tsid/solvers/fwd.hpp"
 #include "tsid/solvers/solver-HQP-output.hpp"
+#include "tsid/solvers/utils.hpp"
 #include "tsid/math/constraint-base.hpp"
 
 #include <vector>
@@ -49,8 +50,16 @@ class TSID_DLLAPI SolverHQPBase {
   virtual void resize(unsigned int n, unsigned int neq, unsigned int nin) = 0;
 
   /** Solve the specified Hierarchical Quadratic Program.
+   * The constraints are first stacked into contiguous matrices, then the
+   * problem is solved as with solve(const HQPStackedData&).
    */
-  virtual const HQPOutput& solve(const HQPData& problemData) = 0;
+  virtual const HQPOutput& solve(const HQPData& problemData);
+
+  /** Solve the Hierarchical Quadratic Program described by the stacked
+   * problem data, e.g. as computed by
+   * InverseDynamicsFormulationBase::computeStackedProblemData.
+   */
+  virtual const HQPOutput& solve(const HQPStackedData& problemData) = 0;
 
   /** Retrieve the matrices describing a QP problem from the problem data. */
   virtual void retrieveQPData(const HQPData& problemData,
@@ -82,6 +91,8 @@ class TSID_DLLAPI SolverHQPBase {
   unsigned int m_maxIter;  // max number of iterations
   double m_maxTime;        // max time to solve the HQP [s]
   HQPOutput m_output;
+  HQPStackedData m_stackedData;  // problem data stacked by solve(HQPData)
+  LeastSquaresCostCache m_costCache;  // Hessian contributions of level 1
 };
 
 }  // namespace solvers
@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_eiquadprog_cascade_hpp__
+#define __invdyn_solvers_hqp_eiquadprog_cascade_hpp__
+
+#include "tsid/solvers/solver-HQP-base.hpp"
+#include "eiquadprog/eiquadprog-fast.hpp"
+
+#include <Eigen/Cholesky>
+#include <Eigen/QR>
+
+namespace tsid {
+namespace solvers {
+/**
+ * @brief Lexicographic solver for an arbitrary number of priority levels.
+ *
+ * Level 0 contains the hard constraints, the other levels contain weighted
+ * least-squares costs, each level being strictly more important than the
+ * following ones. The levels are solved in cascade: the equalities of level 0
+ * and the optimal task values of each solved level are eliminated through an
+ * orthonormal basis Z of their null space, so that level k is solved with
+ * eiquadprog in the reduced variables u, where x = x_{k-1} + Z u. The
+ * inequalities of level 0 are kept at every level.
+ *
+ * Each level only computes a correction u of the solution of the previous
+ * levels. There is no warm start: eiquadprog solves every level from scratch,
+ * no active set or factorization is passed between levels or between calls.
+ * Only the memory is reused: the matrices, the decompositions and the
+ * eiquadprog workspace of each level are kept between calls, so they are not
+ * reallocated as long as the ranks of the levels do not change.
+ */
+class TSID_DLLAPI SolverHQuadProgCascade : public SolverHQPBase {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef math::Matrix Matrix;
+  typedef math::Vector Vector;
+  typedef math::RefVector RefVector;
+  typedef math::ConstRefVector ConstRefVector;
+  typedef math::ConstRefMatrix ConstRefMatrix;
+
+  SolverHQuadProgCascade(const std::string& name);
+
+  void resize(unsigned int n, unsigned int neq, unsigned int nin);
+
+  using SolverHQPBase::solve;
+
+  /** Solve the given Hierarchical Quadratic Program
+   */
+  const HQPOutput& solve(const HQPStackedData& problemData);
+
+  /** Stack the problem data. There is no single QP to retrieve because each
+   * priority level is solved in its own reduced space. */
+  void retrieveQPData(const HQPData& problemData,
+                      const bool hessianRegularization = true);
+
+  /** Get the objective value of the QP solved for the last priority level. */
+  double getObjectiveValue();
+
+  /** Set the current maximum number of iterations performed by the solver. */
+  bool setMaximumIterations(unsigned int maxIter);
+
+  /** Get the threshold used to detect the rank of each priority level. */
+  double getRankThreshold() const { return m_rankThreshold; }
+  /** Set the threshold used to detect the rank of each priority level. */
+  void setRankThreshold(double threshold) { m_rankThreshold = threshold; }
+
+ protected:
+  /** Workspace of a priority level, expressed in the reduced variables. */
+  struct LevelWorkspace {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    Matrix AZ;  /// weighted task matrix projected in the null space
+    Vector r;   /// weighted residual of the tasks at the current solution
+    Matrix H;
+    Vector g;
+    Matrix CE;  /// always empty, the equalities have been eliminated
+    Vector ce0;
+    Matrix CI;  /// interleaved one-sided inequalities of level 0
+    Vector ci0;
+    Vector u;
+    Eigen::ColPivHouseholderQR<Matrix> qr;
+    Eigen::LLT<Matrix> llt;
+    eiquadprog::solvers::EiquadprogFast solver;
+    unsigned int nz;   /// size of the null space at this level
+    unsigned int nin;  /// number of inequalities of the QP
+    bool useSolver;    /// true if eiquadprog has been used for this level
+
+    LevelWorkspace() : nz(0), nin(0), useSolver(false) {}
+  };
+
+  void sendMsg(const std::string& s);
+
+  /** Solve the priority level in the null space of the previous ones and
+   * update the current solution. Return false if the QP failed. */
+  bool solveLevel(const HQPStackedLevel& level0, const HQPStackedLevel* level,
+                  LevelWorkspace& ws);
+
+  /** Restrict the null space basis to the null space of ws.AZ. */
+  void updateNullSpace(LevelWorkspace& ws);
+
+  pinocchio::container::aligned_vector<LevelWorkspace> m_levels;
+  Matrix m_Z;         /// orthonormal basis of the current null space
+  Matrix m_Znext;     /// buffer used to update the null space basis
+  Vector m_CIx;       /// level-0 inequalities at the current solution
+  Matrix m_CIZ;       /// level-0 inequalities in the reduced variables
+  Vector m_y;         /// buffer for the level-0 particular solution
+  double m_hessian_regularization;
+  double m_rankThreshold;
+  double m_objValue;
+  int m_lastLevel;    /// index of the last level solved with eiquadprog
+
+  unsigned int m_neq;  /// number of equality constraints
+  unsigned int m_nin;  /// number of inequality constraints
+  unsigned int m_n;    /// number of variables
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_eiquadprog_cascade_hpp__
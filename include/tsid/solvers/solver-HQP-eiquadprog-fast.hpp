@@ -22,10 +22,32 @@
 #include "tsid/solvers/solver-HQP-base.hpp"
 #include "eiquadprog/eiquadprog-fast.hpp"
 
+#include <Eigen/Cholesky>
+
 namespace tsid {
 namespace solvers {
 /**
- * @brief
+ * @brief Solver for a 2-level HQP based on EiquadprogFast.
+ *
+ * Each inequality lb <= CI*x <= ub is passed to eiquadprog as one-sided rows,
+ * skipping the sides whose bound is infinite (see INFINITE_BOUND). The active
+ * set of the output refers to the layout with both sides of every inequality.
+ *
+ * When the warm start is enabled (see setUseWarmStart), the solver exploits
+ * the similarity of the problems solved at consecutive control cycles:
+ * - the inverse Cholesky factor of the Hessian is computed by this class and
+ *   provided to eiquadprog, and it is only recomputed when the cost cache
+ *   reports a new Hessian (a matrix version or a weight of a task changed,
+ *   see LeastSquaresCostCache) or when the regularization changed;
+ * - the active set of the last solution is tried first, by solving the QP
+ *   with the active inequalities taken as equalities. The solution is kept if
+ *   it satisfies the optimality conditions of the whole QP, otherwise
+ *   eiquadprog is called from a cold start.
+ *
+ * A problem without inequalities, e.g. a fixed-base manipulator with only
+ * equality tasks, is solved in closed form from the KKT conditions, without
+ * eiquadprog. The factorizations of the Hessian and of the equalities
+ * projected by its inverse are kept while H and CE do not change.
  */
 class TSID_DLLAPI SolverHQuadProgFast : public SolverHQPBase {
  public:
@@ -41,15 +63,24 @@ class TSID_DLLAPI SolverHQuadProgFast : public SolverHQPBase {
 
   void resize(unsigned int n, unsigned int neq, unsigned int nin);
 
+  using SolverHQPBase::solve;
+
   /** Solve the given Hierarchical Quadratic Program
    */
-  const HQPOutput& solve(const HQPData& problemData);
+  const HQPOutput& solve(const HQPStackedData& problemData);
 
   /** Retrieve the matrices describing a QP problem from the problem data. */
   void retrieveQPData(const HQPData& problemData,
                       const bool hessianRegularization = true);
 
-  /** Return the QP data object. */
+  /** Retrieve the matrices describing a QP problem from the stacked problem
+   * data. The equality constraints are used in place, so CE is not copied
+   * into the QP data object. */
+  void retrieveStackedQPData(const HQPStackedData& problemData,
+                             const bool hessianRegularization = true);
+
+  /** Return the QP data object. Its inequalities only contain the finite
+   * sides of the inequalities of the problem. */
   const QPDataQuadProg getQPData() const { return m_qpData; }
 
   /** Get the objective value of the last solved problem. */
@@ -61,6 +92,26 @@ class TSID_DLLAPI SolverHQuadProgFast : public SolverHQPBase {
  protected:
   void sendMsg(const std::string& s);
 
+  /** Update m_Jinv if the Hessian changed since its last factorization.
+   * Return false if the Hessian is not positive definite. */
+  virtual bool updateHessianFactor();
+
+  /** Solve the QP assuming that the active inequalities are those of the last
+   * solution. Return true if the solution satisfies the optimality conditions
+   * of the whole QP, in which case it is stored in m_output. */
+  bool solveWithLastActiveSet(ConstRefMatrix CE);
+
+  /** Solve the QP without inequalities from its KKT conditions. Return false
+   * if H is not positive definite or CE is not full rank, in which case the
+   * problem is left to eiquadprog. */
+  bool solveEqualityConstrained(const HQPStackedLevel& level0);
+
+  /** Resize the one-sided inequalities passed to eiquadprog. */
+  void resizeOneSidedInequalities(unsigned int nin);
+
+  /** Set the output active set from the active set of eiquadprog. */
+  void updateOutputActiveSet();
+
   // <nVars, nEqCon, 2*nIneqCon>
   eiquadprog::solvers::EiquadprogFast m_solver;
 
@@ -73,16 +124,46 @@ class TSID_DLLAPI SolverHQuadProgFast : public SolverHQPBase {
   TSID_DEPRECATED Vector m_ci0;
   double m_objValue;
   double m_hessian_regularization;
+  double m_appliedRegularization;  /// regularization added to H at the last
+                                   /// call
 
   Eigen::VectorXi
-      m_activeSet;  /// vector containing the indexes of the active inequalities
+      m_activeSet;  /// indexes of the active one-sided inequalities
   int m_activeSetSize;
 
   unsigned int m_neq;  /// number of equality constraints
   unsigned int m_nin;  /// number of inequality constraints
   unsigned int m_n;    /// number of variables
+  unsigned int m_ninOneSided;  /// number of one-sided inequalities
+  Eigen::VectorXi m_inequalityRows;  /// index of each one-sided inequality in
+                                     /// the layout with both sides of every
+                                     /// inequality
 
   QPDataQuadProgTpl<double> m_qpData;
+
+  // Warm start
+  bool m_provideHessianFactor;  /// true if the Hessian factor is provided to
+                                /// eiquadprog even without warm start
+  bool m_activeSetValid;  /// true if m_activeSet can seed the next QP
+  bool m_hessianFactorValid;  /// true if m_Jinv is the factor of H, reset
+                              /// when the cost cache reports a new Hessian
+  Matrix m_Jinv;  /// J such that J J^T = H^-1, as expected by eiquadprog,
+                  /// e.g. J = L^-T
+  Eigen::LLT<Matrix> m_llt;
+  Matrix m_M;          /// active constraints multiplied by m_Jinv
+  Matrix m_MMt;        /// active constraints multiplied by H^-1 and their
+                       /// transpose
+  Vector m_Jtg;        /// m_Jinv^T * g
+
+  // Problems without inequalities
+  bool m_kktFactorValid;  /// true if m_kktLLT factorizes CE H^-1 CE^T for the
+                          /// current H and CE
+  Matrix m_kktM;          /// CE * m_Jinv
+  Eigen::LLT<Matrix> m_kktLLT;
+  std::vector<std::uint64_t>
+      m_matrixVersions;  /// versions of the level-0 constraint matrices
+  Vector m_lambdaWs;   /// multipliers of the active constraints
+  Vector m_CIx;        /// one-sided inequalities at the warm-start solution
 };
 }  // namespace solvers
 }  // namespace tsid
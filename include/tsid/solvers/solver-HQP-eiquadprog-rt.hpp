@@ -44,9 +44,11 @@ class TSID_DLLAPI SolverHQuadProgRT : public SolverHQPBase {
 
   void resize(unsigned int n, unsigned int neq, unsigned int nin);
 
+  using SolverHQPBase::solve;
+
   /** Solve the given Hierarchical Quadratic Program
    */
-  const HQPOutput& solve(const HQPData& problemData);
+  const HQPOutput& solve(const HQPStackedData& problemData);
 
   // TODO: change eiquadprog-rt to new API
   /** Retrieve the matrices describing a QP problem from the problem data. */
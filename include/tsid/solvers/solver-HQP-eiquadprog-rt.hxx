@@ -19,6 +19,7 @@
 #define __invdyn_solvers_hqp_eiquadprog_rt_hxx__
 
 #include "tsid/solvers/solver-HQP-eiquadprog-rt.hpp"
+#include "tsid/solvers/utils.hpp"
 #include "eiquadprog/eiquadprog-rt.hxx"
 #include "tsid/utils/stop-watch.hpp"
 #include "tsid/math/utils.hpp"
@@ -55,14 +56,17 @@ void SolverHQuadProgRT<nVars, nEqCon, nIneqCon>::resize(unsigned int n,
   assert(neq == nEqCon);
   assert(nin == nIneqCon);
   if ((n != nVars) || (neq != nEqCon) || (nin != nIneqCon))
-    std::cerr
-        << "[SolverHQuadProgRT] (n!=nVars) || (neq!=nEqCon) || (nin!=nIneqCon)"
-        << std::endl;
+    std::cerr << "[SolverHQuadProgRT] The problem has size (" << n << ", "
+              << neq << ", " << nin << ") instead of (" << nVars << ", "
+              << nEqCon << ", " << nIneqCon
+              << "), see tsid_generate_rt_solver to generate the solver of a "
+                 "robot configuration"
+              << std::endl;
 }
 
 template <int nVars, int nEqCon, int nIneqCon>
 const HQPOutput& SolverHQuadProgRT<nVars, nEqCon, nIneqCon>::solve(
-    const HQPData& problemData) {
+    const HQPStackedData& problemData) {
   using namespace tsid::math;
 
   // #ifndef EIGEN_RUNTIME_NO_MALLOC
@@ -76,67 +80,20 @@ const HQPOutput& SolverHQuadProgRT<nVars, nEqCon, nIneqCon>::solve(
         false, "Solver not implemented for more than 2 hierarchical levels.");
   }
 
-  // Compute the constraint matrix sizes
-  unsigned int neq = 0, nin = 0;
-  const ConstraintLevel& cl0 = problemData[0];
-  if (cl0.size() > 0) {
-    const unsigned int n = cl0[0].second->cols();
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      assert(n == constr->cols());
-      if (constr->isEquality())
-        neq += constr->rows();
-      else
-        nin += constr->rows();
-    }
-    // If necessary, resize the constraint matrices
-    resize(n, neq, nin);
-
-    int i_eq = 0, i_in = 0;
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      if (constr->isEquality()) {
-        m_CE.middleRows(i_eq, constr->rows()) = constr->matrix();
-        m_ce0.segment(i_eq, constr->rows()) = -constr->vector();
-        i_eq += constr->rows();
-      } else if (constr->isInequality()) {
-        m_CI.middleRows(i_in, constr->rows()) = constr->matrix();
-        m_ci0.segment(i_in, constr->rows()) = -constr->lowerBound();
-        i_in += constr->rows();
-        m_CI.middleRows(i_in, constr->rows()) = -constr->matrix();
-        m_ci0.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      } else if (constr->isBound()) {
-        m_CI.middleRows(i_in, constr->rows()).setIdentity();
-        m_ci0.segment(i_in, constr->rows()) = -constr->lowerBound();
-        i_in += constr->rows();
-        m_CI.middleRows(i_in, constr->rows()) = -Matrix::Identity(m_n, m_n);
-        m_ci0.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      }
-    }
-  } else
-    resize(m_n, neq, nin);
+  // Check the constraint matrix sizes
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  m_CE = level0.CE;
+  m_ce0 = -level0.ce;
+  oneSidedInequalities(level0, m_CI, m_ci0);
 
   if (problemData.size() > 1) {
-    const ConstraintLevel& cl1 = problemData[1];
     m_H.setZero();
     m_g.setZero();
-    for (ConstraintLevel::const_iterator it = cl1.begin(); it != cl1.end();
-         it++) {
-      const double& w = it->first;
-      auto constr = it->second;
-      if (!constr->isEquality())
-        PINOCCHIO_CHECK_INPUT_ARGUMENT(
-            false, "Inequalities in the cost function are not implemented yet");
-
-      EIGEN_MALLOC_ALLOWED
-      m_H.noalias() += w * constr->matrix().transpose() * constr->matrix();
-      EIGEN_MALLOC_NOT_ALLOWED
-      m_g.noalias() -= w * (constr->matrix().transpose() * constr->vector());
-    }
+    addLeastSquaresCost(problemData[1], m_costCache, m_H, m_g);
     m_H.diagonal().noalias() += m_hessian_regularization * Vector::Ones(m_n);
   }
 
@@ -179,32 +136,9 @@ const HQPOutput& SolverHQuadProgRT<nVars, nEqCon, nIneqCon>::solve(
     m_output.iterations = m_solver.getIteratios();
 
 #ifndef NDEBUG
-    const Vector& x = m_output.x;
-
-    if (cl0.size() > 0) {
-      for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-           it++) {
-        auto constr = it->second;
-        if (constr->checkConstraint(x) == false) {
-          if (constr->isEquality()) {
-            sendMsg("Equality " + constr->name() + " violated: " +
-                    toString((constr->matrix() * x - constr->vector()).norm()));
-          } else if (constr->isInequality()) {
-            sendMsg(
-                "Inequality " + constr->name() + " violated: " +
-                toString(
-                    (constr->matrix() * x - constr->lowerBound()).minCoeff()) +
-                "\n" +
-                toString(
-                    (constr->upperBound() - constr->matrix() * x).minCoeff()));
-          } else if (constr->isBound()) {
-            sendMsg("Bound " + constr->name() + " violated: " +
-                    toString((x - constr->lowerBound()).minCoeff()) + "\n" +
-                    toString((constr->upperBound() - x).minCoeff()));
-          }
-        }
-      }
-    }
+    const std::string violations =
+        constraintViolationsToString(level0, m_output.x);
+    if (!violations.empty()) sendMsg(violations);
 #endif
   } else if (status == eisol::RT_EIQUADPROG_UNBOUNDED)
     m_output.status = HQP_STATUS_INFEASIBLE;
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_eiquadprog_structured_hpp__
+#define __invdyn_solvers_hqp_eiquadprog_structured_hpp__
+
+#include "tsid/solvers/solver-HQP-eiquadprog-fast.hpp"
+
+#include <vector>
+
+namespace tsid {
+namespace solvers {
+/**
+ * @brief SolverHQuadProgFast factorizing the Hessian with its block structure.
+ *
+ * In the problems of InverseDynamicsFormulationAccForce the cost of the
+ * accelerations and the cost of the forces of each contact are separate
+ * blocks of the Hessian, which is then an arrow matrix:
+ *   H = [ A    C_1  ...  C_p ]
+ *       [ C_1^T D_1          ]
+ *       [ ...       ...      ]
+ *       [ C_p^T           D_p]
+ * where the border A gathers the leading variables (the accelerations) and
+ * each diagonal block D_i a group of trailing variables (the forces of a
+ * contact) that no task couples with the other groups. The structure is read
+ * from the columns spanned by the tasks of level 1.
+ *
+ * The Hessian is factorized with the Cholesky decompositions of the blocks
+ * D_i and of the Schur complement S = A - sum_i C_i D_i^-1 C_i^T, instead of
+ * a dense decomposition, and the resulting factor J, with J J^T = H^-1, is
+ * always provided to eiquadprog. If a task spans all the variables, e.g. a
+ * torque task, the border covers the whole Hessian and the factorization is
+ * dense.
+ */
+class TSID_DLLAPI SolverHQuadProgStructured : public SolverHQuadProgFast {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  SolverHQuadProgStructured(const std::string& name);
+
+  using SolverHQuadProgFast::solve;
+
+  /** Solve the given Hierarchical Quadratic Program
+   */
+  const HQPOutput& solve(const HQPStackedData& problemData);
+
+  /** Number of leading variables forming the border of the Hessian. */
+  unsigned int getBorderSize() const { return m_border; }
+
+  /** Number of diagonal blocks of the Hessian after its border. */
+  unsigned int getNumberOfBlocks() const {
+    return static_cast<unsigned int>(m_blocks.size());
+  }
+
+ protected:
+  /** Update the border and the diagonal blocks of the Hessian from the
+   * columns spanned by the tasks of level 1. */
+  void updateStructure(const HQPStackedData& problemData);
+
+  /** Update m_Jinv with the block factorization of the Hessian. */
+  bool updateHessianFactor();
+
+  unsigned int m_border;  /// number of leading variables in the border
+  std::vector<math::ColumnRange> m_blocks;  /// variables of each diagonal
+                                            /// block, after the border
+  std::vector<math::ColumnRange> m_spans;      /// buffers used to update the
+  std::vector<math::ColumnRange> m_newBlocks;  /// structure
+  pinocchio::container::aligned_vector<Eigen::LLT<Matrix> > m_blockLLT;
+  Eigen::LLT<Matrix> m_schurLLT;  /// factorization of the Schur complement
+  Matrix m_W;  /// C_i L_i^-T for all the blocks, where D_i = L_i L_i^T
+  Matrix m_S;  /// Schur complement of the diagonal blocks
+  Matrix m_T;  /// W^T L_S^-T, where S = L_S L_S^T
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_eiquadprog_structured_hpp__
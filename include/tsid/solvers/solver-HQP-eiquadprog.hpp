@@ -40,14 +40,22 @@ class TSID_DLLAPI SolverHQuadProg : public SolverHQPBase {
 
   void resize(unsigned int n, unsigned int neq, unsigned int nin);
 
+  using SolverHQPBase::solve;
+
   /** Solve the given Hierarchical Quadratic Program
    */
-  const HQPOutput& solve(const HQPData& problemData);
+  const HQPOutput& solve(const HQPStackedData& problemData);
 
   /** Retrieve the matrices describing a QP problem from the problem data. */
   void retrieveQPData(const HQPData& problemData,
                       const bool hessianRegularization = true);
 
+  /** Retrieve the matrices describing a QP problem from the stacked problem
+   * data. The equality constraints are used in place, so CE is not copied
+   * into the QP data object. */
+  void retrieveStackedQPData(const HQPStackedData& problemData,
+                             const bool hessianRegularization = true);
+
   /** Return the QP data object. */
   const QPDataQuadProg getQPData() const { return m_qpData; }
 
@@ -0,0 +1,215 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_portfolio_hpp__
+#define __invdyn_solvers_hqp_portfolio_hpp__
+
+#include "tsid/solvers/solver-HQP-base.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tsid {
+namespace solvers {
+
+/**
+ * Ways of running the solvers of a SolverHQPPortfolio.
+ */
+enum TSID_DLLAPI SolverPortfolioMode {
+  /// the solvers are run one after the other until one of them succeeds
+  PORTFOLIO_MODE_FALLBACK = 0,
+  /// the solvers are run in parallel and the first to succeed is used
+  PORTFOLIO_MODE_RACE = 1
+};
+
+/**
+ * @brief Portfolio of HQP solvers solving the problem within a wall-clock
+ * deadline.
+ *
+ * The deadline is the maximum time of the portfolio (see setMaximumTime),
+ * counted from the call to solve. Each solver of the portfolio runs in its
+ * own worker thread on a copy of the problem, so that solve returns at the
+ * deadline even if a solver is still running:
+ * - in PORTFOLIO_MODE_FALLBACK the solvers are run one after the other, in
+ *   the order in which they were added, until one of them finds an optimal
+ *   solution, e.g. SolverHQuadProgFast followed by SolverProxQP;
+ * - in PORTFOLIO_MODE_RACE all the solvers are run in parallel, and the
+ *   output of the first one finding an optimal solution is returned.
+ * Each solver is given the remaining time as its maximum time when it is
+ * started, and keeps its own warm start from its previous solution.
+ *
+ * A solver throwing an exception fails with the status HQP_STATUS_ERROR. If
+ * no solver finds an optimal solution before the deadline, the output of the
+ * first solver that stopped at a point satisfying the constraints of level 0
+ * is returned, with its status. Otherwise the solution is linearly
+ * extrapolated from the two previous solutions returned by the portfolio,
+ * with the status HQP_STATUS_MAX_ITER_REACHED.
+ *
+ * A solver still running at the deadline finishes in its worker thread, its
+ * output being discarded, and it is skipped until it is done. The copy of
+ * the problem solved by a worker does not reference the constraints of the
+ * problem, but copies of their description (type, column support and matrix
+ * structure), so the constraints can be modified while it runs. As the
+ * solvers lay out their
+ * multipliers differently, getSolverIndex tells which solver computed the
+ * output. Note that the allocation checks of EIGEN_RUNTIME_NO_MALLOC are
+ * global, so they are not reliable when several solvers run in parallel.
+ */
+class TSID_DLLAPI SolverHQPPortfolio : public SolverHQPBase {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef math::Vector Vector;
+
+  SolverHQPPortfolio(const std::string& name,
+                     SolverPortfolioMode mode = PORTFOLIO_MODE_FALLBACK);
+
+  /** Wait for the running solvers and stop the worker threads. */
+  ~SolverHQPPortfolio();
+
+  /** Add solver at the end of the portfolio. The solver is deleted with this
+   * object. */
+  void addSolver(SolverHQPBase* solver);
+
+  /** Get the number of solvers of the portfolio. */
+  unsigned int getNumberOfSolvers() const {
+    return static_cast<unsigned int>(m_members.size());
+  }
+
+  /** Get the i-th solver of the portfolio. It must not be modified while it
+   * is running (see isSolverRunning). */
+  SolverHQPBase& solver(unsigned int i);
+
+  /** Return true if the i-th solver is still running a previous problem. */
+  bool isSolverRunning(unsigned int i);
+
+  void resize(unsigned int n, unsigned int neq, unsigned int nin);
+
+  using SolverHQPBase::solve;
+
+  /** Solve the given Hierarchical Quadratic Program
+   */
+  const HQPOutput& solve(const HQPStackedData& problemData);
+
+  /** Stack the problem data. The QP data are retrieved by the solvers of the
+   * portfolio. */
+  void retrieveQPData(const HQPData& problemData,
+                      const bool hessianRegularization = true);
+
+  /** Get the objective value of the solver whose output was returned by the
+   * last call to solve, 0 if the solution was extrapolated. */
+  double getObjectiveValue();
+
+  /** Set the warm start of all the solvers. */
+  void setUseWarmStart(bool useWarmStart);
+  /** Set the maximum number of iterations of all the solvers. */
+  bool setMaximumIterations(unsigned int maxIter);
+
+  /** Get the way the solvers are run. */
+  SolverPortfolioMode getMode() const { return m_mode; }
+  /** Set the way the solvers are run. */
+  void setMode(SolverPortfolioMode mode) { m_mode = mode; }
+
+  /** Get the index of the solver whose output was returned by the last call
+   * to solve, -1 if the solution was extrapolated. */
+  int getSolverIndex() const { return m_solverIndex; }
+
+  /** Return true if the last call to solve reached the deadline. */
+  bool getDeadlineReached() const { return m_deadlineReached; }
+
+ protected:
+  typedef std::chrono::steady_clock Clock;
+
+  /** Solver of the portfolio and its worker thread. */
+  struct Member {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    enum State { IDLE, REQUESTED, RUNNING, DONE };
+
+    std::unique_ptr<SolverHQPBase> solver;
+    std::thread thread;
+    HQPStackedData data;  /// copy of the problem solved by the worker
+    std::vector<std::vector<HQPStackedBlock> >
+        layout;  /// blocks of the problem data was copied from
+    HQPOutput output;     /// copy of the output of the solver
+    double objValue;
+    State state;
+    unsigned long request;     /// index of the call to solve of the problem
+    unsigned long settings;    /// version of the settings applied to solver
+
+    Member() : objValue(0.0), state(IDLE), request(0), settings(0) {}
+  };
+
+  void sendMsg(const std::string& s);
+
+  /** Loop of the worker thread of member. */
+  void work(Member& member);
+
+  /** Copy problemData to the data of member. The description of a
+   * constraint is copied again when its matrix changed. Must be called when
+   * the worker of member is not running. */
+  void copyProblemData(Member& member, const HQPStackedData& problemData);
+
+  /** Start solving problemData with member if it is not running, and return
+   * true if it was started. Must be called with the lock held. */
+  bool start(Member& member, const HQPStackedData& problemData,
+             Clock::time_point deadline);
+
+  /** Wait until member is done or the deadline is reached, and return true
+   * if it is done. Must be called with the lock held. */
+  bool waitFor(std::unique_lock<std::mutex>& lock, const Member& member,
+               Clock::time_point deadline);
+
+  /** Return true if member solved the current problem and its output can be
+   * returned, i.e. it is optimal, or it did not fail and satisfies the
+   * constraints of level 0 if optimalOnly is false. */
+  bool isUsable(const Member& member, const HQPStackedLevel& level0,
+                bool optimalOnly) const;
+
+  /** Copy the output of the i-th solver to m_output. */
+  void useOutput(unsigned int i);
+
+  /** Extrapolate the solution from the previous ones. */
+  void extrapolate();
+
+  std::vector<std::unique_ptr<Member> > m_members;
+  std::mutex m_mutex;
+  std::condition_variable m_requestCondition;  /// signaled to the workers
+  std::condition_variable m_doneCondition;     /// signaled by the workers
+  bool m_stop;               /// true when the workers must return
+  unsigned long m_request;   /// index of the current call to solve
+  unsigned long m_settings;  /// version of the settings of the solvers
+
+  SolverPortfolioMode m_mode;
+  int m_solverIndex;
+  bool m_deadlineReached;
+  double m_objValue;
+  Vector m_xPrevious;  /// solution returned by the previous call
+  unsigned int m_previousSolutions;  /// number of solutions returned (max 2)
+
+  unsigned int m_neq;  /// number of equality constraints
+  unsigned int m_nin;  /// number of inequality constraints
+  unsigned int m_n;    /// number of variables
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_portfolio_hpp__
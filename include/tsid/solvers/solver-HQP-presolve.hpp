@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_presolve_hpp__
+#define __invdyn_solvers_hqp_presolve_hpp__
+
+#include "tsid/solvers/solver-HQP-stage.hpp"
+#include "tsid/solvers/utils.hpp"
+
+#include <Eigen/QR>
+
+#include <cstdint>
+#include <vector>
+
+namespace tsid {
+namespace solvers {
+/**
+ * @brief Presolve stage simplifying the problem before it is passed to
+ * another HQP solver.
+ *
+ * The redundant rows of level 0 are removed first: the equality rows that
+ * are linearly dependent on the other ones, as detected by a rank-revealing
+ * QR decomposition, and the inequality rows that are positive multiples of
+ * another row, whose bounds are merged into the bounds of that row. Such rows
+ * appear when contacts overlap, e.g. a 6d contact and point contacts on the
+ * same sole, or when the same bounds are given by two tasks. The rows to
+ * remove are only selected again when the constraints of level 0 change
+ * (e.g. when a contact is added or removed). If the rows removed with this
+ * cached selection are no longer implied by the other ones, the selection is
+ * updated and the problem is solved again.
+ *
+ * The remaining equalities of level 0 are then eliminated (see
+ * setEliminateEqualities). The solutions of CE x = ce are parameterized as
+ * x = x0 + Z u, where Z is an orthonormal basis of the null space of CE
+ * computed with a rank-revealing QR decomposition, and x0 is the particular
+ * solution of minimum norm. The other rows of every level are expressed in
+ * the reduced variables u:
+ *   A x = b              becomes  (A Z) u = b - A x0
+ *   lb <= CI x <= ub     becomes  lb - CI x0 <= (CI Z) u <= ub - CI x0
+ * and the reduced problem, without equalities at level 0, is solved by the
+ * wrapped solver.
+ *
+ * The decomposition of CE and the reduced matrices are only recomputed when
+ * the level-0 equality matrices change (see ConstraintBase::matrixVersion).
+ * Nothing of the previous decomposition is reused then, neither the pivoting
+ * nor the rank, so with the dynamics of a formulation, which change at every
+ * call, CE is decomposed at every call. The n x n matrix Q of the
+ * decomposition is never formed: Z and x0 are computed by applying its
+ * Householder reflections, in O(n neq (n - rank)) operations for neq
+ * equalities. The reduced problem keeps its size as long as the rank of CE
+ * does not change, so the wrapped solver is not resized between calls.
+ *
+ * The active set of the output refers to the layout with both sides of every
+ * inequality of the original problem, and the multipliers are laid out as
+ * those of SolverHQuadProgCascade: the equalities of level 0 first, then both
+ * sides of every inequality. They are recovered from the stationarity of the
+ * cost of level 1, given the active set of the wrapped solver, and they are
+ * zero for the removed rows.
+ */
+class TSID_DLLAPI SolverHQPPresolve : public SolverHQPStage {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef math::Matrix Matrix;
+  typedef math::Vector Vector;
+  typedef math::VectorXi VectorXi;
+
+  SolverHQPPresolve(const std::string& name, SolverHQPBase* solver);
+
+  using SolverHQPStage::solve;
+
+  /** Solve the given Hierarchical Quadratic Program
+   */
+  const HQPOutput& solve(const HQPStackedData& problemData);
+
+  /** Return true if the equalities of level 0 are eliminated, false if the
+   * presolve only removes the redundant rows. */
+  bool getEliminateEqualities() const { return m_eliminateEqualities; }
+  /** Specify whether the equalities of level 0 are eliminated (true by
+   * default). */
+  void setEliminateEqualities(bool eliminate);
+
+  /** Get the number of equality rows of level 0 kept by the presolve. */
+  unsigned int getNumberOfEqualities() const {
+    return static_cast<unsigned int>(m_equalityRows.size());
+  }
+  /** Get the number of inequality rows of level 0 kept by the presolve. */
+  unsigned int getNumberOfInequalities() const {
+    return static_cast<unsigned int>(m_inequalityRows.size());
+  }
+
+  /** Get the reduced problem solved by the last call to solve. */
+  const HQPStackedData& getReducedData() const { return m_reducedData; }
+
+  /** Get the number of variables of the reduced problem. */
+  unsigned int getReducedSize() const {
+    return static_cast<unsigned int>(m_Z.cols());
+  }
+
+  /** Get the threshold used to detect the rank of the level-0 equalities and
+   * the duplicate inequalities. */
+  double getRankThreshold() const { return m_rankThreshold; }
+  /** Set the threshold used to detect the rank of the level-0 equalities and
+   * the duplicate inequalities. */
+  void setRankThreshold(double threshold) {
+    m_rankThreshold = threshold;
+    m_nullSpaceValid = false;
+    m_selectionBlocks.clear();
+  }
+
+ protected:
+  /** Block of the original problem from which a block of the reduced problem
+   * is computed. */
+  struct BlockSource {
+    const math::ConstraintBase* constraint;
+    std::uint64_t matrixVersion;  /// version of the rows projected in the
+                                  /// reduced block, 0 if not projected yet
+  };
+
+  /** Inequality row of level 0 merged into another one. */
+  struct Duplicate {
+    unsigned int row;   /// index of the row in CI
+    unsigned int kept;  /// index in m_inequalityRows of the row it is merged in
+    double scale;       /// CI.row(row) = scale * CI.row(m_inequalityRows(kept))
+  };
+
+  void resizeStage(unsigned int n, unsigned int neq, unsigned int nin);
+
+  /** Select the rows of level 0 to keep if the constraints of level 0 changed,
+   * if a duplicate inequality is no longer parallel to the row it is merged
+   * in, or if force is true. Return true if the selection was updated. */
+  bool updateRowSelection(const HQPStackedLevel& level0, bool force);
+
+  /** Copy the rows of level 0 kept by the presolve to m_level0. */
+  void updateLevel0(const HQPStackedLevel& level0);
+
+  /** Solve the problem made of m_level0 and the other levels of problemData,
+   * and set the output. */
+  void solveReduced(const HQPStackedData& problemData);
+
+  /** Return true if the level-0 equalities are satisfied by the output. */
+  bool equalitiesSatisfied(const HQPStackedLevel& level0) const;
+
+  /** Decompose the level-0 equalities and update the null space basis. */
+  void updateNullSpace(const HQPStackedLevel& level0);
+
+  /** Compute the particular solution x0 of the level-0 equalities. */
+  void updateParticularSolution(const HQPStackedLevel& level0);
+
+  /** Express the rows of the problem in the reduced variables. The matrices
+   * are only projected again if they changed, or if Z changed. */
+  void updateReducedData(const HQPStackedData& problemData,
+                         bool nullSpaceChanged);
+
+  /** Set the output active set from the active set of the wrapped solver. */
+  void updateOutputActiveSet(const VectorXi& activeSet);
+
+  /** Compute the multipliers of the output from the solution x and the active
+   * set. */
+  void updateMultipliers(const HQPStackedData& problemData);
+
+  bool m_eliminateEqualities;
+  HQPStackedData m_reducedData;
+  std::vector<std::vector<BlockSource> >
+      m_blockSources;  /// source of each block of m_reducedData
+  std::vector<std::uint64_t>
+      m_matrixVersions;  /// versions of the m_level0 constraint matrices
+
+  // Redundant rows
+  std::vector<HQPStackedBlock>
+      m_selectionBlocks;  /// level-0 blocks when the rows were selected
+  VectorXi m_equalityRows;    /// rows of CE kept, in increasing order
+  VectorXi m_inequalityRows;  /// rows of CI kept, in increasing order
+  VectorXi m_lowerSides;  /// index of the lower side of each kept inequality
+                          /// in the layout with both sides of every
+                          /// inequality
+  VectorXi m_upperSides;  /// same for the upper side
+  std::vector<Duplicate> m_duplicates;
+  HQPStackedLevel m_level0;  /// level 0 without the redundant rows
+  std::vector<std::size_t>
+      m_level0Blocks;  /// block of level 0 copied in each block of m_level0
+  std::vector<std::uint64_t>
+      m_level0Versions;  /// version of the rows copied in each block of
+                         /// m_level0, 0 if not copied yet
+
+  Eigen::ColPivHouseholderQR<Matrix> m_qr;  /// CE^T P = Q R
+  Matrix m_Z;         /// orthonormal basis of the null space of CE
+  Vector m_x0;        /// particular solution of the level-0 equalities
+  Vector m_y;         /// buffer for the particular solution
+  bool m_nullSpaceValid;
+  double m_rankThreshold;
+  double m_objOffset;  /// cost of level 1 at x0, minus its value at 0
+
+  StationarityMultipliers m_stationarity;  /// workspace of the multipliers
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_presolve_hpp__
@@ -43,14 +43,21 @@ class TSID_DLLAPI SolverHQpmad : public SolverHQPBase {
 
   void resize(unsigned int n, unsigned int neq, unsigned int nin);
 
+  using SolverHQPBase::solve;
+
   /** Solve the given Hierarchical Quadratic Program
    */
-  const HQPOutput& solve(const HQPData& problemData);
+  const HQPOutput& solve(const HQPStackedData& problemData);
 
   /** Retrieve the matrices describing a QP problem from the problem data. */
   void retrieveQPData(const HQPData& problemData,
                       const bool hessianRegularization = true);
 
+  /** Retrieve the matrices describing a QP problem from the stacked problem
+   * data. */
+  void retrieveStackedQPData(const HQPStackedData& problemData,
+                             const bool hessianRegularization = true);
+
   /** Get the objective value of the last solved problem. */
   double getObjectiveValue();
 
@@ -66,8 +73,8 @@ class TSID_DLLAPI SolverHQpmad : public SolverHQPBase {
 
   Matrix m_H;   // hessian matrix
   Vector m_g;   // gradient vector
-  Vector m_lb;  // gradient vector
-  Vector m_ub;  // gradient vector
+  Vector m_lb;  // lower bounds of the variables
+  Vector m_ub;  // upper bounds of the variables
   Matrix m_C;   // constraint matrix
   Vector m_cl;  // constraints lower bound
   Vector m_cu;  // constraints upper bound
@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_scaling_hpp__
+#define __invdyn_solvers_hqp_scaling_hpp__
+
+#include "tsid/solvers/solver-HQP-stage.hpp"
+#include "tsid/solvers/utils.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace tsid {
+namespace solvers {
+/**
+ * @brief Scaling stage equilibrating the problem before it is passed to
+ * another HQP solver.
+ *
+ * The variables are scaled as x = D y, the rows of level 0 are scaled by E and
+ * the costs of the other levels by c, D and E being diagonal:
+ *   CE x = ce            becomes  (E CE D) y = E ce
+ *   lb <= CI x <= ub     becomes  E lb <= (E CI D) y <= E ub
+ *   w |A x - b|^2        becomes  c w |(A D) y - b|^2
+ * The factors are computed with the Ruiz equilibration of the matrix stacking
+ * the rows of level 0 and the weighted rows of the costs: the infinity norm
+ * of every column and of every row of level 0 is iteratively brought close to
+ * 1, the rows of the costs sharing the factor sqrt(c). The rows of the bounds
+ * keep an identity matrix, so that the wrapped solver can still handle them
+ * as bounds on the variables. This improves the conditioning of the QP when
+ * the columns have different units, e.g. the accelerations and the contact
+ * forces, or when the rows of level 0 have different magnitudes, e.g. the
+ * dynamics and the contact constraints.
+ *
+ * The factors are kept between calls and are only computed again when the
+ * layout of the problem changes (e.g. when a contact is added or removed), or
+ * periodically (see setUpdatePeriod). The scaled matrices of the constraints
+ * that did not change since the previous call are therefore unchanged, and
+ * the wrapped solver can keep its factorizations.
+ *
+ * The solution and the objective value are expressed in the original
+ * variables. As the solvers lay out their multipliers differently, the
+ * multipliers of the output are recovered, as in SolverHQPPresolve, from the
+ * stationarity of the cost of level 1 given the active set of the wrapped
+ * solver, and laid out as those of SolverHQuadProgCascade: the equalities of
+ * level 0 first, then both sides of every inequality.
+ */
+class TSID_DLLAPI SolverHQPScaling : public SolverHQPStage {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef math::Matrix Matrix;
+  typedef math::Vector Vector;
+  typedef math::VectorXi VectorXi;
+
+  SolverHQPScaling(const std::string& name, SolverHQPBase* solver);
+
+  using SolverHQPStage::solve;
+
+  /** Solve the given Hierarchical Quadratic Program
+   */
+  const HQPOutput& solve(const HQPStackedData& problemData);
+
+  /** Return true if the problem is scaled, false if it is passed unchanged
+   * to the wrapped solver. */
+  bool getUseScaling() const { return m_useScaling; }
+  /** Specify whether the problem is scaled (true by default). */
+  void setUseScaling(bool useScaling);
+
+  /** Get the maximum number of iterations of the Ruiz equilibration. */
+  unsigned int getScalingIterations() const { return m_scalingIterations; }
+  /** Set the maximum number of iterations of the Ruiz equilibration (10 by
+   * default). The factors are computed again at the next call. */
+  void setScalingIterations(unsigned int iterations);
+
+  /** Get the number of calls after which the factors are computed again. */
+  unsigned int getUpdatePeriod() const { return m_updatePeriod; }
+  /** Set the number of calls after which the factors are computed again, 0
+   * (the default) to only compute them when the layout of the problem
+   * changes. */
+  void setUpdatePeriod(unsigned int period) { m_updatePeriod = period; }
+
+  /** Compute the factors again at the next call. */
+  void resetScaling() { m_scalingValid = false; }
+
+  /** Get the factors D of the variables. */
+  const Vector& getVariableScaling() const { return m_D; }
+  /** Get the factors E of the equality rows of level 0. */
+  const Vector& getEqualityScaling() const { return m_Eeq; }
+  /** Get the factors E of the inequality rows of level 0. */
+  const Vector& getInequalityScaling() const { return m_Ein; }
+  /** Get the factor c of the costs. */
+  double getCostScaling() const { return m_costScaling; }
+
+  /** Get the scaled problem solved by the last call to solve. */
+  const HQPStackedData& getScaledData() const { return m_scaledData; }
+
+ protected:
+  /** Block of the original problem from which a block of the scaled problem
+   * is computed. */
+  struct BlockSource {
+    const math::ConstraintBase* constraint;
+    std::uint64_t matrixVersion;  /// version of the rows scaled in the block,
+                                  /// 0 if not scaled yet
+  };
+
+  void resizeStage(unsigned int n, unsigned int neq, unsigned int nin);
+
+  /** Return true if the blocks of problemData are those of the scaled
+   * problem. */
+  bool sameLayout(const HQPStackedData& problemData) const;
+
+  /** Create the blocks of the scaled problem from those of problemData. */
+  void updateLayout(const HQPStackedData& problemData);
+
+  /** Compute the factors with the Ruiz equilibration of problemData. */
+  void updateScaling(const HQPStackedData& problemData);
+
+  /** Scale the rows of problemData. The matrices are only scaled again if
+   * they changed, or if the factors changed. */
+  void updateScaledData(const HQPStackedData& problemData,
+                        bool scalingChanged);
+
+  /** Set the solution, the status and the active set of the output from the
+   * output of the wrapped solver. */
+  void unscaleOutput(const HQPOutput& output);
+
+  /** Compute the multipliers of the output from the solution x and the active
+   * set. */
+  void updateMultipliers(const HQPStackedData& problemData);
+
+  bool m_useScaling;
+  unsigned int m_scalingIterations;
+  unsigned int m_updatePeriod;
+  unsigned int m_callsSinceUpdate;  /// calls since the factors were computed
+  bool m_scalingValid;
+
+  HQPStackedData m_scaledData;
+  std::vector<std::vector<BlockSource> >
+      m_blockSources;  /// source of each block of m_scaledData
+
+  Vector m_D;    /// factors of the variables
+  Vector m_Eeq;  /// factors of the equality rows of level 0
+  Vector m_Ein;  /// factors of the inequality rows of level 0
+  double m_costScaling;
+
+  // Ruiz equilibration
+  Matrix m_M;         /// scaled rows of a block
+  Vector m_colNorms;  /// infinity norm of every scaled column
+  Vector m_eqNorms;   /// infinity norm of every scaled equality row
+  Vector m_inNorms;   /// infinity norm of every scaled inequality row
+  Vector m_weights;   /// selection weights of a scaled block
+
+  // Multipliers
+  VectorXi m_activeSides;  /// sides of the active set active at the solution
+  StationarityMultipliers m_stationarity;  /// workspace of the multipliers
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_scaling_hpp__
@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_screening_hpp__
+#define __invdyn_solvers_hqp_screening_hpp__
+
+#include "tsid/solvers/solver-HQP-stage.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace tsid {
+namespace solvers {
+/**
+ * @brief Screening stage dropping the inequalities of level 0 that are far
+ * from being active before the problem is passed to another HQP solver.
+ *
+ * Most of the inequalities of level 0, e.g. the 17 rows of the friction cone
+ * of a Contact6d and the 5 rows of a ContactPoint, are inactive and far from
+ * their bounds in a steady stance. The solution of the previous call is used
+ * to predict which sides of the inequalities can become active: a side is
+ * kept if it is in the active set of the previous solution, or if its slack
+ * at the previous solution, divided by the norm of its row, is less than the
+ * margin (see setMargin). The other sides get an infinite bound (see
+ * INFINITE_BOUND), so the wrapped solver does not consider them, e.g.
+ * SolverHQuadProgFast solves a smaller QP.
+ *
+ * The dropped sides are checked at the solution. If one of them is violated,
+ * or if the screened problem cannot be solved, the problem is solved again
+ * with all the inequalities. All the inequalities are also used when there is
+ * no previous solution, or when the layout of the problem changes.
+ *
+ * Since only the bounds change, the output of the wrapped solver (solution,
+ * multipliers and active set) is in the layout of the original problem.
+ */
+class TSID_DLLAPI SolverHQPScreening : public SolverHQPStage {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef math::Vector Vector;
+  typedef math::VectorXi VectorXi;
+
+  SolverHQPScreening(const std::string& name, SolverHQPBase* solver);
+
+  using SolverHQPStage::solve;
+
+  /** Solve the given Hierarchical Quadratic Program
+   */
+  const HQPOutput& solve(const HQPStackedData& problemData);
+
+  /** Return true if the inequalities are screened, false if the problem is
+   * passed unchanged to the wrapped solver. */
+  bool getUseScreening() const { return m_useScreening; }
+  /** Specify whether the inequalities are screened (true by default). */
+  void setUseScreening(bool useScreening);
+
+  /** Get the distance to their bound below which the sides are kept. */
+  double getMargin() const { return m_margin; }
+  /** Set the distance to their bound below which the sides are kept (1 by
+   * default), in the units of the rows of the inequalities normalized to a
+   * unit norm. */
+  void setMargin(double margin) { m_margin = margin; }
+
+  /** Get the number of sides dropped at the last call, 0 if the problem was
+   * solved again with all the inequalities. */
+  unsigned int getNumberOfDroppedSides() const { return m_droppedSides; }
+
+  /** Get the number of calls for which the problem was solved again with all
+   * the inequalities. */
+  unsigned int getNumberOfFullSolves() const { return m_fullSolves; }
+
+  /** Get the problem solved by the last call to solve. */
+  const HQPStackedData& getScreenedData() const { return m_screenedData; }
+
+ protected:
+  void resizeStage(unsigned int n, unsigned int neq, unsigned int nin);
+
+  /** Copy problemData to m_screenedData. The matrices of a level are only
+   * copied if they changed. Return true if the layout changed. */
+  bool copyProblemData(const HQPStackedData& problemData);
+
+  /** Give an infinite bound to the sides that are not kept. */
+  void dropSides();
+
+  /** Restore the bounds of level 0 of problemData. */
+  void restoreBounds(const HQPStackedLevel& level0);
+
+  /** Return true if the dropped sides are satisfied by m_CIx, the
+   * inequalities at the solution. */
+  bool droppedSidesSatisfied(const HQPStackedLevel& level0) const;
+
+  /** Select the sides to keep at the next call from m_CIx and the active set
+   * of the output. */
+  void updateKeptSides(const HQPStackedLevel& level0);
+
+  bool m_useScreening;
+  double m_margin;
+
+  HQPStackedData m_screenedData;
+  std::vector<std::vector<std::uint64_t> >
+      m_matrixVersions;  /// versions of the matrices copied in m_screenedData
+  std::vector<bool> m_keepLower;  /// lower side of each inequality kept
+  std::vector<bool> m_keepUpper;  /// upper side of each inequality kept
+  bool m_keptSidesValid;  /// true if the kept sides come from a solution of
+                          /// the current layout
+  Vector m_CIx;  /// inequalities of level 0 at the solution
+  unsigned int m_droppedSides;
+  unsigned int m_fullSolves;
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_screening_hpp__
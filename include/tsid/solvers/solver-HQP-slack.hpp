@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_slack_hpp__
+#define __invdyn_solvers_hqp_slack_hpp__
+
+#include "tsid/solvers/solver-HQP-stage.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tsid {
+namespace solvers {
+/**
+ * @brief Stage turning the inequalities of the cost levels into soft
+ * constraints with slack variables before the problem is passed to another
+ * HQP solver.
+ *
+ * The HQP solvers only accept equalities in the cost levels. An inequality
+ * lb <= A x <= ub of weight w at level k >= 1 is replaced by a slack variable
+ * s with as many entries as rows:
+ *   - the hard inequality lb <= A x - s <= ub is added at level 0;
+ *   - the cost w || s ||^2 is added at level k.
+ * The slack is zero when the inequality is satisfied, otherwise it is the
+ * violation of the inequality, which is thus minimized in the least-squares
+ * sense like an equality task. Bounds are handled in the same way.
+ *
+ * The slack variables are appended after the n variables of the problem, and
+ * the rows of the soft inequalities after the inequalities of level 0, so the
+ * layout of the original rows is unchanged. The new rows only span the
+ * columns of their inequality and of their slack variables (see
+ * ConstraintBase::columnSupport), and the slack costs are identity
+ * selections, so the problem is not densified. The augmented problem is only
+ * rebuilt when the layout of the problem changes, and the matrices of the
+ * soft inequalities are only copied when they changed.
+ *
+ * The solution x, the active set and the status are those of the original
+ * problem. The multipliers are those of the augmented problem, the entries of
+ * the soft inequalities coming after those of the rows of level 0. If no cost
+ * level contains inequalities, the problem is passed unchanged to the wrapped
+ * solver.
+ */
+class TSID_DLLAPI SolverHQPSlack : public SolverHQPStage {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef math::Vector Vector;
+  typedef math::VectorXi VectorXi;
+
+  SolverHQPSlack(const std::string& name, SolverHQPBase* solver);
+
+  using SolverHQPStage::solve;
+
+  /** Solve the given Hierarchical Quadratic Program
+   */
+  const HQPOutput& solve(const HQPStackedData& problemData);
+
+  /** Get the number of slack variables of the last solved problem. */
+  unsigned int getNumberOfSlacks() const { return m_ns; }
+
+  /** Get the slack variables of the last solution, in the order of the soft
+   * inequalities in the levels. */
+  const Vector& getSlacks() const { return m_slacks; }
+
+  /** Get the augmented problem solved by the last call to solve, empty if the
+   * problem was passed unchanged to the wrapped solver. */
+  const HQPStackedData& getSlackData() const { return m_slackData; }
+
+ protected:
+  /** Soft inequality of a cost level. */
+  struct SoftBlock {
+    unsigned int level;      /// index of the level of the inequality
+    unsigned int block;      /// index of the inequality in the level
+    unsigned int slack;      /// index of its first slack variable
+    unsigned int rowBlock;   /// index of its rows in the blocks of level 0
+    unsigned int costBlock;  /// index of its slack cost in the blocks of the
+                             /// augmented level
+  };
+
+  void resizeStage(unsigned int n, unsigned int neq, unsigned int nin);
+
+  /** Return true if the layout of problemData differs from the one used to
+   * build m_slackData. */
+  bool layoutChanged(const HQPStackedData& problemData) const;
+
+  /** Build the layout of m_slackData from problemData. */
+  void buildLayout(const HQPStackedData& problemData);
+
+  /** Copy the data of problemData to m_slackData. The matrices are only
+   * copied if they changed since the last call. */
+  void copyProblemData(const HQPStackedData& problemData);
+
+  HQPStackedData m_slackData;
+  std::vector<std::vector<HQPStackedBlock> >
+      m_layout;  /// blocks of the problem m_slackData was built from
+  std::vector<std::vector<int> >
+      m_blockIndex;  /// index of each block in its augmented level, -1 for
+                     /// the soft inequalities
+  std::vector<SoftBlock> m_softBlocks;
+  std::vector<std::shared_ptr<math::ConstraintBase> >
+      m_slackConstraints;  /// constraints describing the new blocks
+  Vector m_slacks;
+  bool m_useSlacks;  /// true if the last problem had soft inequalities
+
+  unsigned int m_ns;   /// number of slack variables
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_slack_hpp__
@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_stacked_data_hpp__
+#define __invdyn_solvers_hqp_stacked_data_hpp__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tsid/math/fwd.hpp"
+#include <pinocchio/container/aligned-vector.hpp>
+
+namespace tsid {
+namespace solvers {
+
+/**
+ * Range of rows of an HQPStackedLevel holding a single constraint. Only the
+ * columns spanned by the constraint matrix (see ConstraintBase::colOffset)
+ * can be nonzero in these rows.
+ */
+struct HQPStackedBlock {
+  HQPStackedBlock(double weight,
+                  const std::shared_ptr<math::ConstraintBase>& constraint,
+                  bool isEquality, unsigned int row, unsigned int rows,
+                  unsigned int col, unsigned int cols)
+      : weight(weight),
+        constraint(constraint),
+        isEquality(isEquality),
+        row(row),
+        rows(rows),
+        col(col),
+        cols(cols),
+        matrixVersion(0) {}
+
+  double weight;  /// weight of the constraint (not used at level 0)
+  std::shared_ptr<math::ConstraintBase> constraint;  /// name, type and column
+                                                     /// support only
+  bool isEquality;    /// rows are stored in CE if true, in CI otherwise
+  unsigned int row;   /// index of the first row in CE (or CI)
+  unsigned int rows;  /// number of rows
+  unsigned int col;   /// index of the first column spanned by the constraint
+  unsigned int cols;  /// number of columns spanned by the constraint
+  std::uint64_t matrixVersion;  /// version of the constraint matrix stored in
+                                /// the rows, 0 if not stored yet
+};
+
+/**
+ * All the constraints of one priority level stacked in contiguous matrices:
+ *   CE * x = ce
+ *   ci_lb <= CI * x <= ci_ub
+ * Bounds are stored as inequalities with an identity matrix.
+ * At level 0 the rows are hard constraints, at the other levels they are
+ * weighted least-squares costs.
+ */
+struct HQPStackedLevel {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  math::Matrix CE;
+  math::Vector ce;
+  math::Matrix CI;
+  math::Vector ci_lb;
+  math::Vector ci_ub;
+  std::vector<HQPStackedBlock> blocks;
+
+  /** Resize all the matrices and set them to zero. */
+  void resize(unsigned int n, unsigned int neq, unsigned int nin) {
+    CE.setZero(neq, n);
+    ce.setZero(neq);
+    CI.setZero(nin, n);
+    ci_lb.setZero(nin);
+    ci_ub.setZero(nin);
+  }
+};
+
+typedef pinocchio::container::aligned_vector<HQPStackedLevel> HQPStackedData;
+
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_stacked_data_hpp__
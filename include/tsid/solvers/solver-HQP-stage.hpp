@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#ifndef __invdyn_solvers_hqp_stage_hpp__
+#define __invdyn_solvers_hqp_stage_hpp__
+
+#include "tsid/solvers/solver-HQP-base.hpp"
+
+#include <memory>
+
+namespace tsid {
+namespace solvers {
+/**
+ * @brief Base class of the stages transforming the problem before it is
+ * passed to another HQP solver (see SolverHQPPresolve, SolverHQPScaling,
+ * SolverHQPScreening and SolverHQPSlack).
+ *
+ * The stage owns the wrapped solver, and forwards to it the warm start, the
+ * maximum number of iterations and the maximum time. The QP data are
+ * retrieved by the wrapped solver when the transformed problem is solved.
+ */
+class TSID_DLLAPI SolverHQPStage : public SolverHQPBase {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  void resize(unsigned int n, unsigned int neq, unsigned int nin);
+
+  using SolverHQPBase::solve;
+
+  /** Stack the problem data. The QP data are retrieved by the wrapped solver
+   * when the transformed problem is solved. */
+  void retrieveQPData(const HQPData& problemData,
+                      const bool hessianRegularization = true);
+
+  /** Get the objective value of the last solved problem. */
+  double getObjectiveValue();
+
+  void setUseWarmStart(bool useWarmStart);
+  bool setMaximumIterations(unsigned int maxIter);
+  bool setMaximumTime(double seconds);
+
+  /** Get the wrapped solver. */
+  SolverHQPBase& solver() { return *m_solver; }
+
+ protected:
+  /** Wrap solver, which is deleted with this object. The messages are
+   * prefixed with className. */
+  SolverHQPStage(const std::string& className, const std::string& name,
+                 SolverHQPBase* solver);
+
+  void sendMsg(const std::string& s);
+
+  /** Called by resize when the size of the problem changes, before m_n, m_neq
+   * and m_nin are updated. */
+  virtual void resizeStage(unsigned int /*n*/, unsigned int /*neq*/,
+                           unsigned int /*nin*/) {}
+
+  std::unique_ptr<SolverHQPBase> m_solver;  /// wrapped solver
+  std::string m_className;
+  double m_objValue;
+
+  unsigned int m_neq;  /// number of equality constraints
+  unsigned int m_nin;  /// number of inequality constraints
+  unsigned int m_n;    /// number of variables
+};
+}  // namespace solvers
+}  // namespace tsid
+
+#endif  // ifndef __invdyn_solvers_hqp_stage_hpp__
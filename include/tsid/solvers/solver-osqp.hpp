@@ -33,7 +33,15 @@
 namespace tsid {
 namespace solvers {
 /**
- * @brief
+ * @brief Solver for a 2-level HQP based on OSQP.
+ *
+ * The OSQP workspace is kept as long as the dimensions of the problem do not
+ * change. The sparse matrices passed to OSQP keep their sparsity pattern from
+ * one call to the next (entries that become zero are stored explicitly), so
+ * that OSQP only updates their values instead of being set up again, and
+ * they are only updated when the Hessian or the constraint matrices changed.
+ * When the warm start is enabled (see setUseWarmStart), each solve starts from
+ * the last primal and dual solution.
  */
 class TSID_DLLAPI SolverOSQP : public SolverHQPBase {
  public:
@@ -45,6 +53,8 @@ class TSID_DLLAPI SolverOSQP : public SolverHQPBase {
   typedef math::ConstRefVector ConstRefVector;
   typedef math::ConstRefMatrix ConstRefMatrix;
 
+  typedef Eigen::SparseMatrix<double> SpMat;
+
   SolverOSQP(const std::string& name);
   SolverOSQP(const SolverOSQP& other);
 
@@ -54,11 +64,18 @@ class TSID_DLLAPI SolverOSQP : public SolverHQPBase {
   void retrieveQPData(const HQPData& problemData,
                       const bool hessianRegularization = false);
 
+  /** Retrieve the matrices describing a QP problem from the stacked problem
+   * data. */
+  void retrieveStackedQPData(const HQPStackedData& problemData,
+                             const bool hessianRegularization = false);
+
   /** Return the QP data object. */
   const QPData getQPData() const { return m_qpData; }
 
+  using SolverHQPBase::solve;
+
   /** Solve the given Hierarchical Quadratic Program. */
-  const HQPOutput& solve(const HQPData& problemData);
+  const HQPOutput& solve(const HQPStackedData& problemData);
 
   /** Get the objective value of the last solved problem. */
   double getObjectiveValue();
@@ -78,6 +95,8 @@ class TSID_DLLAPI SolverOSQP : public SolverHQPBase {
 
   double m_objValue;
   double m_hessian_regularization;
+  double m_appliedRegularization;  /// regularization added to H at the last
+                                   /// call
 
   OsqpEigen::Solver m_solver;
 
@@ -94,6 +113,15 @@ class TSID_DLLAPI SolverOSQP : public SolverHQPBase {
   double m_epsRel;
   bool m_isVerbose;
   bool m_isDataInitialized;
+
+  SpMat m_Hsparse;   /// upper triangle of the Hessian
+  SpMat m_CIsparse;  /// stacked equality and inequality constraints
+  bool m_isLastSolutionValid;  /// true if the last solve succeeded
+  bool m_hessianChanged;       /// H changed since the last solve
+  bool m_equalitiesChanged;    /// CE changed since the last solve
+  bool m_inequalitiesChanged;  /// CI changed since the last solve
+  std::vector<std::uint64_t>
+      m_matrixVersions;  /// versions of the level-0 constraint matrices
 };
 }  // namespace solvers
 }  // namespace tsid
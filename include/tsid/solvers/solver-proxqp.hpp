@@ -37,7 +37,17 @@ using namespace proxsuite::proxqp;
 namespace tsid {
 namespace solvers {
 /**
- * @brief
+ * @brief Solver for a 2-level HQP based on the dense solver of ProxQP.
+ *
+ * The ProxQP workspace is kept as long as the dimensions of the problem do not
+ * change: after the first call to init, the problem is modified with update,
+ * passing only the matrices that changed (according to the versions of the
+ * constraint matrices and to the Hessian cache), and keeping the
+ * preconditioner computed by init. When the warm start is enabled (see
+ * setUseWarmStart), each solve starts from the last primal and dual solution.
+ *
+ * The bounds of level 0 (ConstraintBound) are passed to ProxQP as box
+ * constraints, the other inequalities as general inequalities.
  */
 class TSID_DLLAPI SolverProxQP : public SolverHQPBase {
  public:
@@ -57,12 +67,20 @@ class TSID_DLLAPI SolverProxQP : public SolverHQPBase {
   void retrieveQPData(const HQPData& problemData,
                       const bool hessianRegularization = false);
 
+  /** Retrieve the cost of a QP problem from the stacked problem data. The
+   * constraints are used in place, so they are not copied into the QP data
+   * object, except for the inequalities if level 0 contains bounds. */
+  void retrieveStackedQPData(const HQPStackedData& problemData,
+                             const bool hessianRegularization = false);
+
   /** Return the QP data object. */
   const QPData getQPData() const { return m_qpData; }
 
+  using SolverHQPBase::solve;
+
   /** Solve the given Hierarchical Quadratic Program
    */
-  const HQPOutput& solve(const HQPData& problemData);
+  const HQPOutput& solve(const HQPStackedData& problemData);
 
   /** Get the objective value of the last solved problem. */
   double getObjectiveValue();
@@ -82,6 +100,8 @@ class TSID_DLLAPI SolverProxQP : public SolverHQPBase {
 
   double m_objValue;
   double m_hessian_regularization;
+  double m_appliedRegularization;  /// regularization added to H at the last
+                                   /// call
 
   dense::QP<double> m_solver;
 
@@ -97,6 +117,19 @@ class TSID_DLLAPI SolverProxQP : public SolverHQPBase {
   double m_epsAbs;
   double m_epsRel;
   bool m_isVerbose;
+
+  bool m_isInitialized;  /// true if init has been called since the last resize
+  bool m_isLastSolutionValid;  /// true if the last solve succeeded
+  bool m_hessianChanged;       /// H changed since the last solve
+  bool m_equalitiesChanged;    /// CE changed since the last solve
+  bool m_inequalitiesChanged;  /// CI changed since the last solve
+  std::vector<std::uint64_t>
+      m_matrixVersions;  /// versions of the level-0 constraint matrices
+
+  bool m_hasBounds;     /// true if level 0 contains bounds
+  bool m_solverHasBox;  /// true if m_solver has been created with a box
+  Vector m_lb;          /// lower bounds of the variables
+  Vector m_ub;          /// upper bounds of the variables
 };
 }  // namespace solvers
 }  // namespace tsid
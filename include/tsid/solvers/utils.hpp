@@ -20,13 +20,214 @@
 
 #include "tsid/solvers/fwd.hpp"
 
+#include <Eigen/QR>
+
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace tsid {
 namespace solvers {
 
 std::string HQPDataToString(const HQPData& data, bool printMatrices = false);
-}
+
+/**
+ * Stack the constraints of each level of problemData into contiguous
+ * matrices. The layout of stackedData is rebuilt only if the constraints
+ * of problemData have changed since the last call, otherwise only the
+ * content of the matrices is updated.
+ */
+void stackHQPData(const HQPData& problemData, HQPStackedData& stackedData);
+
+/**
+ * Write the inequalities lb <= CI*x <= ub of a level in the one-sided form
+ * CI*x + ci0 >= 0 used by eiquadprog. CI and ci0 must have twice the rows of
+ * the inequalities of the level: the lower and upper rows of each constraint
+ * are stored next to each other.
+ */
+void oneSidedInequalities(const HQPStackedLevel& level, math::RefMatrix CI,
+                          math::RefVector ci0);
+
+/**
+ * Bounds whose absolute value is at least INFINITE_BOUND are considered
+ * infinite, so the corresponding side of an inequality can be dropped.
+ */
+const double INFINITE_BOUND = 1e10;
+
+/**
+ * Return the number of finite sides of the inequalities of a level, i.e. the
+ * number of rows written by finiteOneSidedInequalities.
+ */
+unsigned int countFiniteInequalities(const HQPStackedLevel& level);
+
+/**
+ * Same as oneSidedInequalities, except that the sides with an infinite bound
+ * are skipped, so CI and ci0 must have countFiniteInequalities(level) rows.
+ * rows(k) is set to the index that the row k of CI has in the layout of
+ * oneSidedInequalities. Return true if rows changed.
+ */
+bool finiteOneSidedInequalities(const HQPStackedLevel& level,
+                                math::RefMatrix CI, math::RefVector ci0,
+                                math::VectorXi& rows);
+
+/**
+ * Find the inequality row of the side a, in the layout of
+ * oneSidedInequalities, and whether it is the lower side. Return false if a is
+ * not in the layout.
+ */
+bool findInequalitySide(const HQPStackedLevel& level, int a, unsigned int& row,
+                        bool& lower);
+
+/**
+ * Return the number of inequality rows of a level that are not bounds, i.e.
+ * the rows written by generalInequalities.
+ */
+unsigned int countGeneralInequalities(const HQPStackedLevel& level);
+
+/**
+ * Copy the inequalities of a level that are not bounds to contiguous rows of
+ * CI, ci_lb and ci_ub, for the solvers handling the bounds as a box (see
+ * boundsToBox). CI is only written if copyMatrix is true.
+ */
+void generalInequalities(const HQPStackedLevel& level, math::RefMatrix CI,
+                         math::RefVector ci_lb, math::RefVector ci_ub,
+                         bool copyMatrix = true);
+
+/**
+ * Set the box lb <= x <= ub to the intersection of the bounds of a level.
+ * The entries of the box that are not bounded are infinite. Return false if
+ * the level has no bounds.
+ */
+bool boundsToBox(const HQPStackedLevel& level, math::RefVector lb,
+                 math::RefVector ub);
+
+/**
+ * Add the least-squares terms of the rows A * x = b with weight w:
+ *   H += w * A^T * A   (lower triangle only)
+ *   g -= w * A^T * b
+ * in a single pass over the column ranges of A. If the column support is not
+ * empty, only the columns of A in the support are read, the other ones must be
+ * zero. The strictly upper triangle of H is not modified, see
+ * copyLowerToUpper. No memory is allocated unless the blocks of A exceed the
+ * stack allocation limit of Eigen.
+ */
+void addLeastSquaresTerms(math::ConstRefMatrix A, math::ConstRefVector b,
+                          const math::ColumnSupport& support, double w,
+                          math::RefMatrix H, math::RefVector g);
+
+/** Copy the strictly lower triangle of the square matrix H to its strictly
+ * upper triangle. */
+void copyLowerToUpper(math::RefMatrix H);
+
+/**
+ * Add the weighted least-squares cost of all the equalities of a level:
+ *   H += w * A^T * A
+ *   g -= w * A^T * b
+ * Only the columns in the column support of each constraint are multiplied.
+ * If the matrix of a constraint is a selection (see
+ * ConstraintBase::matrixStructure), its weights are added to the diagonal of
+ * H and the vector is scattered into g, without any product.
+ * H must be symmetric: only its lower triangle is accumulated, then copied to
+ * the upper triangle.
+ * An exception is thrown if the level contains inequalities.
+ */
+void addLeastSquaresCost(const HQPStackedLevel& level, math::RefMatrix H,
+                         math::RefVector g);
+
+/**
+ * Contributions of the blocks of a level to the Hessian of its least-squares
+ * cost, kept between two calls to addLeastSquaresCost.
+ */
+struct LeastSquaresCostCache {
+  struct Entry {
+    std::uint64_t matrixVersion;  /// version of the block matrix A
+    double weight;                /// weight of the block
+    unsigned int col;  /// first column of the block, and first row and column
+                       /// of its contribution to the Hessian
+    math::Matrix AtA;  /// unweighted contribution A^T * A, restricted to the
+                       /// columns spanned by A
+    math::ColumnSupport support;  /// column support of A, only these blocks
+                                  /// of AtA are computed
+
+    Entry() : matrixVersion(0), weight(0.0), col(0) {}
+  };
+
+  std::vector<Entry> entries;  /// one entry per block of the level
+  math::Matrix H;              /// sum of the weighted contributions
+};
+
+/**
+ * Same as above, except that the product A^T * A of each block is kept in the
+ * cache and recomputed only when the version of the block matrix changes
+ * (always if the version is 0). If only weights changed, the cached products
+ * are summed again. The gradient g is always recomputed.
+ * Return true if the Hessian added to H differs from the one of the last call.
+ */
+bool addLeastSquaresCost(const HQPStackedLevel& level,
+                         LeastSquaresCostCache& cache, math::RefMatrix H,
+                         math::RefVector g);
+
+/**
+ * Compare the matrix versions of the blocks of a level with the ones stored in
+ * versions, which are then replaced by the current ones. equalitiesChanged
+ * (resp. inequalitiesChanged) is set to true if the matrix of an equality
+ * (resp. inequality or bound) block may have changed since the last call.
+ * Blocks with an unknown version (0) are always considered as changed, and so
+ * are all the blocks if their number changed.
+ */
+void compareMatrixVersions(const HQPStackedLevel& level,
+                           std::vector<std::uint64_t>& versions,
+                           bool& equalitiesChanged, bool& inequalitiesChanged);
+
+/**
+ * Return true if the blocks a and b have the same constraints at the same
+ * rows and columns, whatever their weights and matrix versions.
+ */
+bool sameBlockLayout(const std::vector<HQPStackedBlock>& a,
+                     const std::vector<HQPStackedBlock>& b);
+
+/**
+ * Return a description of the constraints of a level violated by x,
+ * or an empty string if all constraints are satisfied.
+ */
+std::string constraintViolationsToString(const HQPStackedLevel& level,
+                                         math::ConstRefVector x,
+                                         double tol = 1e-6);
+
+/**
+ * Return the largest violation by x of the constraints of a level, 0 if all
+ * constraints are satisfied.
+ */
+double maxConstraintViolation(const HQPStackedLevel& level,
+                              math::ConstRefVector x);
+
+/**
+ * Workspace of computeStationarityMultipliers.
+ */
+struct StationarityMultipliers {
+  math::Vector grad;  /// gradient of the cost of level 1 at the solution
+  math::Matrix Ct;    /// equalities and active inequalities, with the sign of
+                      /// their side, as columns
+  math::Vector multipliers;  /// multipliers of the columns of Ct
+  Eigen::ColPivHouseholderQR<math::Matrix>
+      qr;  /// decomposition of Ct, its threshold sets the rank
+};
+
+/**
+ * Compute the multipliers of the constraints of level 0 at the solution x
+ * from the stationarity of the cost of level 1:
+ *   sum of w A^T (A x - b) = CE^T lambda + CA^T mu
+ * where CE are the given equality rows and CA the sides in activeSet of the
+ * inequalities of level 0 (layout with both sides of every inequality, see
+ * findInequalitySide), the upper sides being -CI x >= -ub. The multipliers
+ * are stored in ws.multipliers: one per row of CE, then one per side of
+ * activeSet. Return false if there is neither equality nor active side.
+ */
+bool computeStationarityMultipliers(
+    const HQPStackedData& problemData, math::ConstRefMatrix CE,
+    const Eigen::Ref<const math::VectorXi>& activeSet, math::ConstRefVector x,
+    StationarityMultipliers& ws);
+}  // namespace solvers
 
 }  // namespace tsid
 
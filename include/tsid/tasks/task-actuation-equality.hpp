@@ -54,6 +54,10 @@ class TaskActuationEquality : public TaskActuation {
   void mask(const Vector& mask);
 
  protected:
+  /** Set the matrix and the vector of the constraint from the active axes, the
+   * weights and the reference. */
+  void updateConstraint();
+
   Vector m_mask;
   VectorXi m_activeAxes;
   Vector m_ref;
@@ -21,6 +21,7 @@
 #include <tsid/deprecated.hh>
 #include <tsid/tasks/task-base.hpp>
 #include <tsid/formulations/contact-level.hpp>
+#include <cstdint>
 #include <memory>
 
 namespace tsid {
@@ -53,6 +54,20 @@ class TaskContactForce : public TaskBase {
    * contact forces (all of them), returns an empty string.
    */
   virtual const std::string& getAssociatedContactName() = 0;
+
+  /**
+   * Version of the association of this task to a contact. It changes
+   * whenever the associated contact changes, so that the formulation does
+   * not compare the contact names at each time step.
+   */
+  std::uint64_t associationVersion() const { return m_associationVersion; }
+
+ protected:
+  /** Give a new version to the association. Call it whenever the name
+   * returned by getAssociatedContactName changes. */
+  void markAssociationChanged() { m_associationVersion++; }
+
+  std::uint64_t m_associationVersion;
 };
 }  // namespace tasks
 }  // namespace tsid
@@ -121,6 +121,7 @@ class TaskSE3Equality : public TaskMotion {
   Vector m_drift_masked;
   Matrix6x m_J;
   Matrix6x m_J_rotated;
+  math::ColumnSupport m_J_support;  /// columns of m_J that can be nonzero
   ConstraintEquality m_constraint;
   TrajectorySample m_ref;
   bool m_local_frame;
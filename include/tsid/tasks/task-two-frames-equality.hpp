@@ -114,6 +114,9 @@ class TaskTwoFramesEquality : public TaskMotion {
   Vector m_drift_masked;
   Matrix6x m_J1, m_J2;
   Matrix6x m_J1_rotated, m_J2_rotated;
+  math::ColumnSupport m_J1_support, m_J2_support;  /// columns of m_J1 and m_J2
+                                                   /// that can be nonzero
+  math::ColumnSupport m_J_support;  /// union of the two supports
   ConstraintEquality m_constraint;
 };
 
@@ -19,6 +19,16 @@
 
 namespace tsid {
 
-ContactLevel::ContactLevel(contacts::ContactBase& contact) : contact(contact) {}
+ContactLevel::ContactLevel(contacts::ContactBase& contact)
+    : contact(contact),
+      index(0),
+      motionPriority(0),
+      motionRow(0),
+      forceRow(0),
+      forceRegRow(0),
+      motionIndex(0),
+      forceRegIndex(0),
+      forceMatrixVersion(0),
+      forceRegMatrixVersion(0) {}
 
 }  // namespace tsid
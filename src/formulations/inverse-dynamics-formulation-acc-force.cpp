@@ -19,6 +19,7 @@
 
 #include "tsid/math/constraint-bound.hpp"
 #include "tsid/math/constraint-inequality.hpp"
+#include "tsid/solvers/utils.hpp"
 
 using namespace tsid;
 using namespace math;
@@ -29,10 +30,57 @@ using namespace std;
 
 typedef pinocchio::Data Data;
 
+namespace {
+// A = S * [M_a  -J_a^T], S being the matrix of the actuation constraint c. If
+// S is a selection matrix the rows are gathered and scaled instead of
+// multiplied.
+void multiplyActuationMatrix(const ConstraintBase &c, ConstRefMatrix M_a,
+                             ConstRefMatrix J_a, RefMatrix A) {
+  const Eigen::Index nv = M_a.cols();
+  const Eigen::Index k = J_a.rows();
+  const Vector &w = c.selectionWeights();
+  switch (c.matrixStructure()) {
+    case CONSTRAINT_MATRIX_SCALED_IDENTITY:
+      A.leftCols(nv) = w(0) * M_a;
+      A.rightCols(k) = -w(0) * J_a.transpose();
+      break;
+    case CONSTRAINT_MATRIX_DIAGONAL:
+      A.leftCols(nv) = w.asDiagonal() * M_a;
+      A.rightCols(k) = -(w.asDiagonal() * J_a.transpose());
+      break;
+    case CONSTRAINT_MATRIX_SELECTION:
+      for (Eigen::Index i = 0; i < A.rows(); i++) {
+        const Eigen::Index j = c.selectedColumns()(i);
+        A.row(i).head(nv) = w(i) * M_a.row(j);
+        A.row(i).tail(k) = -w(i) * J_a.col(j).transpose();
+      }
+      break;
+    default:
+      A.leftCols(nv).noalias() = c.matrix() * M_a;
+      A.rightCols(k).noalias() = -c.matrix() * J_a.transpose();
+  }
+}
+
+// y -= S * h_a, S being the matrix of the actuation constraint c
+void subtractActuationVector(const ConstraintBase &c, ConstRefVector h_a,
+                             RefVector y) {
+  if (c.matrixStructure() == CONSTRAINT_MATRIX_DENSE) {
+    y.noalias() -= c.matrix() * h_a;
+    return;
+  }
+  const Vector &w = c.selectionWeights();
+  for (Eigen::Index i = 0; i < y.size(); i++)
+    y(i) -= w(i) * h_a(c.selectedColumns()(i));
+}
+}  // namespace
+
 InverseDynamicsFormulationAccForce::InverseDynamicsFormulationAccForce(
     const std::string &name, RobotWrapper &robot, bool verbose)
     : InverseDynamicsFormulationBase(name, robot, verbose),
       m_data(robot.model()),
+      m_stackedLayoutDirty(true),
+      m_assembleStacked(false),
+      m_useBoundConstraints(false),
       m_baseDynamics(new math::ConstraintEquality(
           "base-dynamics", robot.nv() - robot.na(), robot.nv())),
       m_solutionDecoded(false) {
@@ -60,38 +108,211 @@ unsigned int InverseDynamicsFormulationAccForce::nEq() const { return m_eq; }
 
 unsigned int InverseDynamicsFormulationAccForce::nIn() const { return m_in; }
 
+void InverseDynamicsFormulationAccForce::setUseBoundConstraints(
+    bool useBoundConstraints) {
+  m_useBoundConstraints = useBoundConstraints;
+}
+
+bool InverseDynamicsFormulationAccForce::getUseBoundConstraints() const {
+  return m_useBoundConstraints;
+}
+
 void InverseDynamicsFormulationAccForce::resizeHqpData() {
   m_Jc.setZero(m_k, m_v);
   m_baseDynamics->resize(m_u, m_v + m_k);
+  // bounds and actuation tasks span all the variables, the columns of the
+  // other constraints are set by updateColumnSpans
   for (HQPData::iterator it = m_hqpData.begin(); it != m_hqpData.end(); it++) {
     for (ConstraintLevel::iterator itt = it->begin(); itt != it->end(); itt++) {
-      itt->second->resize(itt->second->rows(), m_v + m_k);
+      if (!itt->second->isBound()) continue;
+      if (it == m_hqpData.begin()) m_in += m_v + m_k - itt->second->rows();
+      itt->second->resize(m_v + m_k, m_v + m_k);
+    }
+  }
+  for (auto &tl : m_taskActuations)
+    tl->constraint->resize(tl->constraint->rows(), m_v + m_k);
+  m_stackedLayoutDirty = true;
+  resetMatrixVersions();
+}
+
+void InverseDynamicsFormulationAccForce::updateStackedLayout() {
+  // Rows are stacked in the same order as the constraints in m_hqpData, so
+  // that the weights can be refreshed without looking them up by name.
+  m_stackedData.resize(m_hqpData.size());
+  for (unsigned int i = 0; i < m_hqpData.size(); i++) {
+    HQPStackedLevel &level = m_stackedData[i];
+    level.blocks.clear();
+    unsigned int neq = 0, nin = 0;
+    for (ConstraintLevel::iterator it = m_hqpData[i].begin();
+         it != m_hqpData[i].end(); it++) {
+      const unsigned int m = it->second->rows();
+      const unsigned int col = it->second->colOffset();
+      const unsigned int cols = it->second->cols();
+      if (it->second->isEquality()) {
+        level.blocks.push_back(
+            HQPStackedBlock(it->first, it->second, true, neq, m, col, cols));
+        neq += m;
+      } else {
+        level.blocks.push_back(
+            HQPStackedBlock(it->first, it->second, false, nin, m, col, cols));
+        nin += m;
+      }
     }
+    level.resize(m_v + m_k, neq, nin);
   }
+
+  for (auto &tl : m_taskMotions)
+    tl->stackedRow = findStackedRow(tl->priority, tl->constraint.get());
+  for (auto &tl : m_taskContactForces)
+    tl->stackedRow = findStackedRow(tl->priority, tl->constraint.get());
+  for (auto &tl : m_taskActuations)
+    tl->stackedRow = findStackedRow(tl->priority, tl->constraint.get());
+  for (auto &cl : m_contacts) {
+    cl->motionRow =
+        findStackedRow(cl->motionPriority, cl->motionConstraint.get());
+    cl->forceRow = findStackedRow(0, cl->forceConstraint.get());
+    cl->forceRegRow = findStackedRow(1, cl->forceRegTask.get());
+  }
+  m_stackedLayoutDirty = false;
+  resetMatrixVersions();
+}
+
+void InverseDynamicsFormulationAccForce::resetMatrixVersions() {
+  for (auto &tl : m_taskMotions) tl->matrixVersion = 0;
+  for (auto &tl : m_taskContactForces) tl->matrixVersion = 0;
+  for (auto &cl : m_contacts) {
+    cl->forceMatrixVersion = 0;
+    cl->forceRegMatrixVersion = 0;
+  }
+}
+
+unsigned int InverseDynamicsFormulationAccForce::findStackedRow(
+    unsigned int priorityLevel, const ConstraintBase *constraint) const {
+  for (const HQPStackedBlock &b : m_stackedData[priorityLevel].blocks)
+    if (b.constraint.get() == constraint) return b.row;
+  assert(false);
+  return 0;
+}
+
+unsigned int InverseDynamicsFormulationAccForce::findHqpIndex(
+    unsigned int priorityLevel, const ConstraintBase *constraint) const {
+  const ConstraintLevel &cl = m_hqpData[priorityLevel];
+  for (unsigned int i = 0; i < cl.size(); i++)
+    if (cl[i].second.get() == constraint) return i;
+  return static_cast<unsigned int>(cl.size());
+}
+
+void InverseDynamicsFormulationAccForce::updateHqpIndices() {
+  for (auto &e : m_taskHandles)
+    if (e.constraint) e.hqpIndex = findHqpIndex(e.priority, e.constraint.get());
+  for (auto &cl : m_contacts) {
+    cl->motionIndex =
+        findHqpIndex(cl->motionPriority, cl->motionConstraint.get());
+    cl->forceRegIndex = findHqpIndex(1, cl->forceRegTask.get());
+  }
+}
+
+void InverseDynamicsFormulationAccForce::updateAssociatedContacts() {
+  for (auto &tl : m_taskContactForces) {
+    tl->associationVersion = tl->task.associationVersion();
+    tl->contact.reset();
+    tl->matrixVersion = 0;  // the columns of the task may change
+    const std::string &contactName = tl->task.getAssociatedContactName();
+    if (contactName == "") continue;
+    for (auto &cl : m_contacts) {
+      if (cl->contact.name() == contactName) {
+        tl->contact = cl;
+        break;
+      }
+    }
+  }
+  updateColumnSpans();
+}
+
+void InverseDynamicsFormulationAccForce::updateColumnSpans() {
+  // the force variables of a contact are stored after the accelerations
+  for (auto &cl : m_contacts) {
+    cl->forceConstraint->setColOffset(m_v + cl->index);
+    cl->forceRegTask->setColOffset(m_v + cl->index);
+  }
+  // a force task spans the forces of its contact, or all of them
+  for (auto &tl : m_taskContactForces) {
+    if (tl->constraint->isBound()) continue;
+    unsigned int col = m_v;
+    unsigned int cols = m_k;
+    if (tl->contact) {
+      col += tl->contact->index;
+      cols = tl->contact->contact.n_force();
+    }
+    if (tl->constraint->cols() != cols)
+      tl->constraint->resize(tl->constraint->rows(), cols);
+    tl->constraint->setColOffset(col);
+  }
+  m_stackedLayoutDirty = true;
+}
+
+InverseDynamicsFormulationAccForce::ConstraintRows
+InverseDynamicsFormulationAccForce::constraintRows(ConstraintBase &constraint,
+                                                   unsigned int priorityLevel,
+                                                   unsigned int stackedRow) {
+  if (!m_assembleStacked) {
+    // the non-const matrix() would change the version of the matrix even if
+    // it is not written, ConstraintRows::A() takes care of it instead
+    Matrix &A = const_cast<Matrix &>(
+        static_cast<const ConstraintBase &>(constraint).matrix());
+    if (constraint.isEquality())
+      return ConstraintRows(constraint, A, constraint.vector(),
+                            constraint.vector(), constraint.vector());
+    return ConstraintRows(constraint, A, constraint.lowerBound(),
+                          constraint.lowerBound(), constraint.upperBound());
+  }
+
+  HQPStackedLevel &level = m_stackedData[priorityLevel];
+  const unsigned int m = constraint.rows();
+  const unsigned int col = constraint.colOffset();
+  const unsigned int cols = constraint.cols();
+  if (constraint.isEquality()) {
+    RefVector b = level.ce.segment(stackedRow, m);
+    return ConstraintRows(constraint, level.CE.block(stackedRow, col, m, cols),
+                          b, b, b);
+  }
+  RefVector lb = level.ci_lb.segment(stackedRow, m);
+  return ConstraintRows(constraint, level.CI.block(stackedRow, col, m, cols),
+                        lb, lb, level.ci_ub.segment(stackedRow, m));
 }
 
 template <class TaskLevelPointer>
 void InverseDynamicsFormulationAccForce::addTask(TaskLevelPointer tl,
                                                  double weight,
                                                  unsigned int priorityLevel) {
-  if (priorityLevel > m_hqpData.size()) m_hqpData.resize(priorityLevel);
+  if (priorityLevel >= m_hqpData.size()) m_hqpData.resize(priorityLevel + 1);
+  // motion tasks only span the accelerations, the columns of force tasks
+  // are set by updateColumnSpans
   const ConstraintBase &c = tl->task.getConstraint();
   if (c.isEquality()) {
     tl->constraint =
-        std::make_shared<ConstraintEquality>(c.name(), c.rows(), m_v + m_k);
+        std::make_shared<ConstraintEquality>(c.name(), c.rows(), m_v);
     if (priorityLevel == 0) m_eq += c.rows();
-  } else  // if(c.isInequality())
-  {
+  } else if (c.isBound() && m_useBoundConstraints) {
+    tl->constraint = std::make_shared<ConstraintBound>(c.name(), m_v + m_k);
+    if (priorityLevel == 0) m_in += m_v + m_k;
+  } else {
     tl->constraint =
-        std::make_shared<ConstraintInequality>(c.name(), c.rows(), m_v + m_k);
+        std::make_shared<ConstraintInequality>(c.name(), c.rows(), m_v);
     if (priorityLevel == 0) m_in += c.rows();
   }
-  // don't use bounds for now because EiQuadProg doesn't exploit them anyway
-  //  else
-  //    tl->constraint = new ConstraintBound(c.name(), m_v+m_k);
   m_hqpData[priorityLevel].push_back(
       make_pair<double, std::shared_ptr<ConstraintBase> >(weight,
                                                           tl->constraint));
+  m_stackedLayoutDirty = true;
+
+  TaskHandleEntry entry;
+  entry.name = tl->task.name();
+  entry.constraint = tl->constraint;
+  entry.priority = priorityLevel;
+  entry.hqpIndex =
+      static_cast<unsigned int>(m_hqpData[priorityLevel].size() - 1);
+  m_taskHandles.push_back(entry);
 }
 
 bool InverseDynamicsFormulationAccForce::addMotionTask(
@@ -122,6 +343,7 @@ bool InverseDynamicsFormulationAccForce::addForceTask(
   auto tl = std::make_shared<TaskLevelForce>(task, priorityLevel);
   m_taskContactForces.push_back(tl);
   addTask(tl, weight, priorityLevel);
+  updateAssociatedContacts();
   return true;
 }
 
@@ -137,7 +359,7 @@ bool InverseDynamicsFormulationAccForce::addActuationTask(
   auto tl = std::make_shared<TaskLevel>(task, priorityLevel);
   m_taskActuations.push_back(tl);
 
-  if (priorityLevel > m_hqpData.size()) m_hqpData.resize(priorityLevel);
+  if (priorityLevel >= m_hqpData.size()) m_hqpData.resize(priorityLevel + 1);
 
   const ConstraintBase &c = tl->task.getConstraint();
   if (c.isEquality()) {
@@ -155,6 +377,15 @@ bool InverseDynamicsFormulationAccForce::addActuationTask(
   m_hqpData[priorityLevel].push_back(
       make_pair<double, std::shared_ptr<ConstraintBase> >(weight,
                                                           tl->constraint));
+  m_stackedLayoutDirty = true;
+
+  TaskHandleEntry entry;
+  entry.name = tl->task.name();
+  entry.constraint = tl->constraint;
+  entry.priority = priorityLevel;
+  entry.hqpIndex =
+      static_cast<unsigned int>(m_hqpData[priorityLevel].size() - 1);
+  m_taskHandles.push_back(entry);
 
   return true;
 }
@@ -174,25 +405,48 @@ bool InverseDynamicsFormulationAccForce::updateTaskWeight(
   return false;
 }
 
+int InverseDynamicsFormulationAccForce::getTaskHandle(
+    const std::string &task_name) const {
+  for (unsigned int i = 0; i < m_taskHandles.size(); i++)
+    if (m_taskHandles[i].constraint && m_taskHandles[i].name == task_name)
+      return static_cast<int>(i);
+  return -1;
+}
+
+bool InverseDynamicsFormulationAccForce::updateTaskWeight(int task_handle,
+                                                          double weight) {
+  if (task_handle < 0 || task_handle >= int(m_taskHandles.size()))
+    return false;
+  const TaskHandleEntry &e = m_taskHandles[task_handle];
+  // weights do not matter in the first priority level
+  if (!e.constraint || e.priority == 0 ||
+      e.hqpIndex >= m_hqpData[e.priority].size())
+    return false;
+  m_hqpData[e.priority][e.hqpIndex].first = weight;
+  return true;
+}
+
 bool InverseDynamicsFormulationAccForce::addRigidContact(
     ContactBase &contact, double force_regularization_weight,
     double motion_weight, unsigned int motionPriorityLevel) {
   auto cl = std::make_shared<ContactLevel>(contact);
   cl->index = m_k;
+  cl->motionPriority = motionPriorityLevel;
   m_k += contact.n_force();
   m_contacts.push_back(cl);
   resizeHqpData();
 
   const ConstraintBase &motionConstr = contact.getMotionConstraint();
   cl->motionConstraint = std::make_shared<ConstraintEquality>(
-      contact.name() + "_motion_task", motionConstr.rows(), m_v + m_k);
+      contact.name() + "_motion_task", motionConstr.rows(), m_v);
   m_hqpData[motionPriorityLevel].push_back(
       solvers::make_pair<double, std::shared_ptr<ConstraintBase> >(
           motion_weight, cl->motionConstraint));
 
   const ConstraintInequality &forceConstr = contact.getForceConstraint();
   cl->forceConstraint = std::make_shared<ConstraintInequality>(
-      contact.name() + "_force_constraint", forceConstr.rows(), m_v + m_k);
+      contact.name() + "_force_constraint", forceConstr.rows(),
+      contact.n_force());
   m_hqpData[0].push_back(
       solvers::make_pair<double, std::shared_ptr<ConstraintBase> >(
           1.0, cl->forceConstraint));
@@ -200,7 +454,8 @@ bool InverseDynamicsFormulationAccForce::addRigidContact(
   const ConstraintEquality &forceRegConstr =
       contact.getForceRegularizationTask();
   cl->forceRegTask = std::make_shared<ConstraintEquality>(
-      contact.name() + "_force_reg_task", forceRegConstr.rows(), m_v + m_k);
+      contact.name() + "_force_reg_task", forceRegConstr.rows(),
+      contact.n_force());
   m_hqpData[1].push_back(
       solvers::make_pair<double, std::shared_ptr<ConstraintBase> >(
           force_regularization_weight, cl->forceRegTask));
@@ -208,6 +463,10 @@ bool InverseDynamicsFormulationAccForce::addRigidContact(
   if (motionPriorityLevel == 0) m_eq += motionConstr.rows();
   m_in += forceConstr.rows();
 
+  m_contactHandles.push_back(cl);
+  updateHqpIndices();
+  updateAssociatedContacts();
+
   return true;
 }
 
@@ -244,6 +503,31 @@ bool InverseDynamicsFormulationAccForce::updateRigidContactWeights(
   return false;
 }
 
+int InverseDynamicsFormulationAccForce::getContactHandle(
+    const std::string &contact_name) const {
+  for (unsigned int i = 0; i < m_contactHandles.size(); i++)
+    if (m_contactHandles[i] &&
+        m_contactHandles[i]->contact.name() == contact_name)
+      return static_cast<int>(i);
+  return -1;
+}
+
+bool InverseDynamicsFormulationAccForce::updateRigidContactWeights(
+    int contact_handle, double force_regularization_weight,
+    double motion_weight) {
+  if (contact_handle < 0 || contact_handle >= int(m_contactHandles.size()) ||
+      !m_contactHandles[contact_handle])
+    return false;
+  const ContactLevel &cl = *m_contactHandles[contact_handle];
+  if (force_regularization_weight >= 0.0)
+    m_hqpData[1][cl.forceRegIndex].first = force_regularization_weight;
+  if (motion_weight < 0.0) return true;
+  // weights do not matter in the first priority level
+  if (cl.motionPriority == 0) return false;
+  m_hqpData[cl.motionPriority][cl.motionIndex].first = motion_weight;
+  return true;
+}
+
 bool InverseDynamicsFormulationAccForce::addMeasuredForce(
     MeasuredForceBase &measuredForce) {
   auto tl = std::make_shared<MeasuredForceLevel>(measuredForce);
@@ -254,6 +538,24 @@ bool InverseDynamicsFormulationAccForce::addMeasuredForce(
 
 const HQPData &InverseDynamicsFormulationAccForce::computeProblemData(
     double time, ConstRefVector q, ConstRefVector v) {
+  // the matrices copied so far have been written into the stacked data
+  if (m_assembleStacked) resetMatrixVersions();
+  m_assembleStacked = false;
+  assembleProblemData(time, q, v);
+  return m_hqpData;
+}
+
+const HQPStackedData &
+InverseDynamicsFormulationAccForce::computeStackedProblemData(
+    double time, ConstRefVector q, ConstRefVector v) {
+  if (!m_assembleStacked) resetMatrixVersions();
+  m_assembleStacked = true;
+  assembleProblemData(time, q, v);
+  return m_stackedData;
+}
+
+void InverseDynamicsFormulationAccForce::assembleProblemData(
+    double time, ConstRefVector q, ConstRefVector v) {
   m_t = time;
 
   for (auto it_ct = m_contactTransitions.begin();
@@ -277,6 +579,26 @@ const HQPData &InverseDynamicsFormulationAccForce::computeProblemData(
     }
   }
 
+  // the association of a force task changes the columns it spans, so it is
+  // resolved before the stacked layout is updated
+  for (auto &it : m_taskContactForces) {
+    if (it->associationVersion != it->task.associationVersion()) {
+      updateAssociatedContacts();
+      break;
+    }
+  }
+
+  if (m_assembleStacked) {
+    if (m_stackedLayoutDirty) {
+      updateStackedLayout();
+    } else {
+      // weights may have been changed by updateTaskWeight
+      for (unsigned int i = 1; i < m_hqpData.size(); i++)
+        for (unsigned int j = 0; j < m_hqpData[i].size(); j++)
+          m_stackedData[i].blocks[j].weight = m_hqpData[i][j].first;
+    }
+  }
+
   m_robot.computeAllTerms(m_data, q, v);
 
   for (auto cl : m_contacts) {
@@ -284,23 +606,45 @@ const HQPData &InverseDynamicsFormulationAccForce::computeProblemData(
 
     const ConstraintBase &mc =
         cl->contact.computeMotionTask(time, q, v, m_data);
-    cl->motionConstraint->matrix().leftCols(m_v) = mc.matrix();
-    cl->motionConstraint->vector() = mc.vector();
+    ConstraintRows motion = constraintRows(
+        *cl->motionConstraint, cl->motionPriority, cl->motionRow);
+    cl->motionConstraint->setColumnSupport(mc.columnSupport());
+    motion.A() = mc.matrix();
+    motion.b = mc.vector();
 
     const Matrix &T =
         cl->contact.getForceGeneratorMatrix();  // e.g., 6x12 for a 6d contact
-    m_Jc.middleRows(cl->index, m).noalias() = T.transpose() * mc.matrix();
+    // only the columns of the joints supporting the contact frame are nonzero,
+    // the other columns of m_Jc have been set to zero by resizeHqpData
+    const ColumnSupport &support = mc.columnSupport();
+    if (support.empty())
+      m_Jc.middleRows(cl->index, m).noalias() = T.transpose() * mc.matrix();
+    for (const ColumnRange &r : support)
+      m_Jc.block(cl->index, r.col, m, r.cols).noalias() =
+          T.transpose() * mc.matrix().middleCols(r.col, r.cols);
 
     const ConstraintInequality &fc =
         cl->contact.computeForceTask(time, q, v, m_data);
-    cl->forceConstraint->matrix().middleCols(m_v + cl->index, m) = fc.matrix();
-    cl->forceConstraint->lowerBound() = fc.lowerBound();
-    cl->forceConstraint->upperBound() = fc.upperBound();
+    ConstraintRows force =
+        constraintRows(*cl->forceConstraint, 0, cl->forceRow);
+    // the friction cone and the force regularization usually only change
+    // when the contact parameters are modified
+    if (fc.matrixVersion() != cl->forceMatrixVersion) {
+      force.A() = fc.matrix();
+      cl->forceMatrixVersion = fc.matrixVersion();
+    }
+    force.lb = fc.lowerBound();
+    force.ub = fc.upperBound();
 
     const ConstraintEquality &fr =
         cl->contact.computeForceRegularizationTask(time, q, v, m_data);
-    cl->forceRegTask->matrix().middleCols(m_v + cl->index, m) = fr.matrix();
-    cl->forceRegTask->vector() = fr.vector();
+    ConstraintRows forceReg =
+        constraintRows(*cl->forceRegTask, 1, cl->forceRegRow);
+    if (fr.matrixVersion() != cl->forceRegMatrixVersion) {
+      forceReg.A() = fr.matrix();
+      cl->forceRegMatrixVersion = fr.matrixVersion();
+    }
+    forceReg.b = fr.vector();
   }
 
   // Add all measured external forces to dynamic model
@@ -318,25 +662,46 @@ const HQPData &InverseDynamicsFormulationAccForce::computeProblemData(
       m_robot.nonLinearEffects(m_data).head(m_u) - h_fext.head(m_u);
   const Matrix &J_u = m_Jc.leftCols(m_u);
 
-  m_baseDynamics->matrix().leftCols(m_v) = M_u;
-  m_baseDynamics->matrix().rightCols(m_k) = -J_u.transpose();
-  m_baseDynamics->vector() = -h_u;
+  // the base dynamics is always the first constraint of level 0
+  ConstraintRows baseDynamics = constraintRows(*m_baseDynamics, 0, 0);
+  RefMatrix baseDynamicsA = baseDynamics.A();
+  baseDynamicsA.leftCols(m_v) = M_u;
+  baseDynamicsA.rightCols(m_k) = -J_u.transpose();
+  baseDynamics.b = -h_u;
 
   //  std::vector<TaskLevel*>::iterator it;
   //  for(it=m_taskMotions.begin(); it!=m_taskMotions.end(); it++)
   for (auto &it : m_taskMotions) {
     const ConstraintBase &c = it->task.compute(time, q, v, m_data);
+    ConstraintRows rows =
+        constraintRows(*it->constraint, it->priority, it->stackedRow);
+    if (it->constraint->isBound()) {
+      if (c.matrixVersion() != it->matrixVersion) {
+        if (m_assembleStacked) rows.A().setIdentity();
+        it->matrixVersion = c.matrixVersion();
+      }
+      rows.lb.head(m_v) = c.lowerBound();
+      rows.lb.tail(m_k).setConstant(-INFINITE_BOUND);
+      rows.ub.head(m_v) = c.upperBound();
+      rows.ub.tail(m_k).setConstant(INFINITE_BOUND);
+      continue;
+    }
+    // constant task matrices (e.g. joint posture) are copied only once
+    if (c.matrixVersion() != it->matrixVersion) {
+      if (c.isBound()) {
+        rows.A() = Matrix::Identity(m_v, m_v);
+      } else {
+        it->constraint->setColumnSupport(c.columnSupport());
+        it->constraint->copyMatrixStructure(c);
+        rows.A() = c.matrix();
+      }
+      it->matrixVersion = c.matrixVersion();
+    }
     if (c.isEquality()) {
-      it->constraint->matrix().leftCols(m_v) = c.matrix();
-      it->constraint->vector() = c.vector();
-    } else if (c.isInequality()) {
-      it->constraint->matrix().leftCols(m_v) = c.matrix();
-      it->constraint->lowerBound() = c.lowerBound();
-      it->constraint->upperBound() = c.upperBound();
+      rows.b = c.vector();
     } else {
-      it->constraint->matrix().leftCols(m_v) = Matrix::Identity(m_v, m_v);
-      it->constraint->lowerBound() = c.lowerBound();
-      it->constraint->upperBound() = c.upperBound();
+      rows.lb = c.lowerBound();
+      rows.ub = c.upperBound();
     }
   }
 
@@ -346,18 +711,11 @@ const HQPData &InverseDynamicsFormulationAccForce::computeProblemData(
     int i0 = m_v;
     int c_size = m_k;
 
-    // if the task is associated to a specific contact
-    // cout<<"Associated contact name:
-    // "<<it->task.getAssociatedContactName()<<endl;
-    if (it->task.getAssociatedContactName() != "") {
-      // look for the associated contact
-      for (auto cl : m_contacts) {
-        if (it->task.getAssociatedContactName() == cl->contact.name()) {
-          i0 += cl->index;
-          c_size = cl->contact.n_force();
-          break;
-        }
-      }
+    // if the task is associated to a specific contact, resolved when tasks
+    // or contacts are added or removed
+    if (it->contact) {
+      i0 += it->contact->index;
+      c_size = it->contact->contact.n_force();
     }
 
     const ConstraintBase &c = it->task.compute(time, q, v, m_data, &m_contacts);
@@ -367,49 +725,68 @@ const HQPData &InverseDynamicsFormulationAccForce::computeProblemData(
     // cout<<"constraint matrix size: "<<it->constraint->matrix().rows()<<" x
     // "<<it->constraint->matrix().cols()<<endl;
 
+    ConstraintRows rows =
+        constraintRows(*it->constraint, it->priority, it->stackedRow);
+    if (it->constraint->isBound()) {
+      if (c.matrixVersion() != it->matrixVersion) {
+        if (m_assembleStacked) rows.A().setIdentity();
+        it->matrixVersion = c.matrixVersion();
+      }
+      rows.lb.setConstant(-INFINITE_BOUND);
+      rows.lb.segment(i0, c_size) = c.lowerBound();
+      rows.ub.setConstant(INFINITE_BOUND);
+      rows.ub.segment(i0, c_size) = c.upperBound();
+      continue;
+    }
+    if (c.matrixVersion() != it->matrixVersion) {
+      if (c.isBound())
+        rows.A() = Matrix::Identity(c_size, c_size);
+      else
+        rows.A() = c.matrix();
+      it->matrixVersion = c.matrixVersion();
+    }
     if (c.isEquality()) {
-      it->constraint->matrix().middleCols(i0, c_size) = c.matrix();
-      it->constraint->vector() = c.vector();
-    } else if (c.isInequality()) {
-      it->constraint->matrix().middleCols(i0, c_size) = c.matrix();
-      it->constraint->lowerBound() = c.lowerBound();
-      it->constraint->upperBound() = c.upperBound();
+      rows.b = c.vector();
     } else {
-      it->constraint->matrix().middleCols(i0, c_size) =
-          Matrix::Identity(c_size, c_size);
-      it->constraint->lowerBound() = c.lowerBound();
-      it->constraint->upperBound() = c.upperBound();
+      rows.lb = c.lowerBound();
+      rows.ub = c.upperBound();
     }
   }
 
   for (auto &it : m_taskActuations) {
     const ConstraintBase &c = it->task.compute(time, q, v, m_data);
+    ConstraintRows rows =
+        constraintRows(*it->constraint, it->priority, it->stackedRow);
+    // the actuation rows depend on the mass matrix, they are always written
+    RefMatrix A = rows.A();
     if (c.isEquality()) {
-      it->constraint->matrix().leftCols(m_v).noalias() = c.matrix() * M_a;
-      it->constraint->matrix().rightCols(m_k).noalias() =
-          -c.matrix() * J_a.transpose();
-      it->constraint->vector() = c.vector();
-      it->constraint->vector().noalias() -= c.matrix() * h_a;
+      multiplyActuationMatrix(c, M_a, J_a, A);
+      rows.b = c.vector();
+      subtractActuationVector(c, h_a, rows.b);
     } else if (c.isInequality()) {
-      it->constraint->matrix().leftCols(m_v).noalias() = c.matrix() * M_a;
-      it->constraint->matrix().rightCols(m_k).noalias() =
-          -c.matrix() * J_a.transpose();
-      it->constraint->lowerBound() = c.lowerBound();
-      it->constraint->lowerBound().noalias() -= c.matrix() * h_a;
-      it->constraint->upperBound() = c.upperBound();
-      it->constraint->upperBound().noalias() -= c.matrix() * h_a;
+      multiplyActuationMatrix(c, M_a, J_a, A);
+      rows.lb = c.lowerBound();
+      subtractActuationVector(c, h_a, rows.lb);
+      rows.ub = c.upperBound();
+      subtractActuationVector(c, h_a, rows.ub);
     } else {
       // NB: An actuator bound becomes an inequality
-      it->constraint->matrix().leftCols(m_v) = M_a;
-      it->constraint->matrix().rightCols(m_k) = -J_a.transpose();
-      it->constraint->lowerBound() = c.lowerBound() - h_a;
-      it->constraint->upperBound() = c.upperBound() - h_a;
+      A.leftCols(m_v) = M_a;
+      A.rightCols(m_k) = -J_a.transpose();
+      rows.lb = c.lowerBound() - h_a;
+      rows.ub = c.upperBound() - h_a;
     }
   }
 
-  m_solutionDecoded = false;
+  if (m_assembleStacked) {
+    // the matrices written above have been given a new version by
+    // ConstraintRows::A(), the others are unchanged
+    for (HQPStackedLevel &level : m_stackedData)
+      for (HQPStackedBlock &b : level.blocks)
+        b.matrixVersion = b.constraint->matrixVersion();
+  }
 
-  return m_hqpData;
+  m_solutionDecoded = false;
 }
 
 bool InverseDynamicsFormulationAccForce::decodeSolution(const HQPOutput &sol) {
@@ -474,8 +851,34 @@ bool InverseDynamicsFormulationAccForce::getContactForces(
   return false;
 }
 
+Vector InverseDynamicsFormulationAccForce::getContactForces(
+    int contactHandle, const HQPOutput &sol) {
+  if (contactHandle < 0 || contactHandle >= int(m_contactHandles.size()) ||
+      !m_contactHandles[contactHandle])
+    return Vector::Zero(0);
+  decodeSolution(sol);
+  const ContactLevel &cl = *m_contactHandles[contactHandle];
+  return m_f.segment(cl.index, cl.contact.n_force());
+}
+
+bool InverseDynamicsFormulationAccForce::getContactForces(
+    int contactHandle, const HQPOutput &sol, RefVector f) {
+  if (contactHandle < 0 || contactHandle >= int(m_contactHandles.size()) ||
+      !m_contactHandles[contactHandle])
+    return false;
+  decodeSolution(sol);
+  const ContactLevel &cl = *m_contactHandles[contactHandle];
+  const int k = cl.contact.n_force();
+  assert(f.size() == k);
+  f = m_f.segment(cl.index, k);
+  return true;
+}
+
 bool InverseDynamicsFormulationAccForce::removeTask(const std::string &taskName,
                                                     double) {
+  for (auto &e : m_taskHandles)
+    if (e.constraint && e.name == taskName) e.constraint.reset();
+
 #ifndef NDEBUG
   bool taskFound = removeFromHqpData(taskName);
   assert(taskFound);
@@ -490,6 +893,8 @@ bool InverseDynamicsFormulationAccForce::removeTask(const std::string &taskName,
           m_eq -= (*it)->constraint->rows();
         else if ((*it)->constraint->isInequality())
           m_in -= (*it)->constraint->rows();
+        else if ((*it)->constraint->isBound())
+          m_in -= m_v + m_k;
       }
       m_taskMotions.erase(it);
       return true;
@@ -517,6 +922,15 @@ bool InverseDynamicsFormulationAccForce::removeTask(const std::string &taskName,
   return false;
 }
 
+bool InverseDynamicsFormulationAccForce::removeTask(int taskHandle,
+                                                    double transition_duration) {
+  if (taskHandle < 0 || taskHandle >= int(m_taskHandles.size()) ||
+      !m_taskHandles[taskHandle].constraint)
+    return false;
+  const std::string taskName = m_taskHandles[taskHandle].name;
+  return removeTask(taskName, transition_duration);
+}
+
 bool InverseDynamicsFormulationAccForce::removeRigidContact(
     const std::string &contactName, double transition_duration) {
   if (transition_duration > 0.0) {
@@ -556,8 +970,11 @@ bool InverseDynamicsFormulationAccForce::removeRigidContact(
   for (auto it = m_contacts.begin(); it != m_contacts.end(); it++) {
     if ((*it)->contact.name() == contactName) {
       m_k -= (*it)->contact.n_force();
-      m_eq -= (*it)->motionConstraint->rows();
+      if ((*it)->motionPriority == 0)
+        m_eq -= (*it)->motionConstraint->rows();
       m_in -= (*it)->forceConstraint->rows();
+      for (auto &ch : m_contactHandles)
+        if (ch == *it) ch.reset();
       m_contacts.erase(it);
       resizeHqpData();
       contact_found = true;
@@ -570,10 +987,21 @@ bool InverseDynamicsFormulationAccForce::removeRigidContact(
     it->index = k;
     k += it->contact.n_force();
   }
+  updateAssociatedContacts();
   return contact_found && first_constraint_found && second_constraint_found &&
          third_constraint_found;
 }
 
+bool InverseDynamicsFormulationAccForce::removeRigidContact(
+    int contactHandle, double transition_duration) {
+  if (contactHandle < 0 || contactHandle >= int(m_contactHandles.size()) ||
+      !m_contactHandles[contactHandle])
+    return false;
+  const std::string contactName =
+      m_contactHandles[contactHandle]->contact.name();
+  return removeRigidContact(contactName, transition_duration);
+}
+
 bool InverseDynamicsFormulationAccForce::removeMeasuredForce(
     const std::string &measuredForceName) {
   for (auto it = m_measuredForces.begin(); it != m_measuredForces.end(); it++) {
@@ -594,6 +1022,8 @@ bool InverseDynamicsFormulationAccForce::removeFromHqpData(
          !found && itt != it->end(); itt++) {
       if (itt->second->name() == name) {
         it->erase(itt);
+        m_stackedLayoutDirty = true;
+        updateHqpIndices();
         return true;
       }
     }
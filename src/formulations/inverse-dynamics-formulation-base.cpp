@@ -16,15 +16,20 @@
 //
 
 #include "tsid/formulations/inverse-dynamics-formulation-base.hpp"
+#include "tsid/solvers/utils.hpp"
 
 namespace tsid {
 
 TaskLevel::TaskLevel(tasks::TaskBase& task, unsigned int priority)
-    : task(task), priority(priority) {}
+    : task(task), priority(priority), stackedRow(0), matrixVersion(0) {}
 
 TaskLevelForce::TaskLevelForce(tasks::TaskContactForce& task,
                                unsigned int priority)
-    : task(task), priority(priority) {}
+    : task(task),
+      priority(priority),
+      stackedRow(0),
+      associationVersion(0),
+      matrixVersion(0) {}
 
 InverseDynamicsFormulationBase::InverseDynamicsFormulationBase(
     const std::string& name, RobotWrapper& robot, bool verbose)
@@ -37,4 +42,41 @@ MeasuredForceLevel::MeasuredForceLevel(
 bool InverseDynamicsFormulationBase::addRigidContact(ContactBase& contact) {
   return addRigidContact(contact, 1e-5);
 }
+
+int InverseDynamicsFormulationBase::getTaskHandle(const std::string&) const {
+  return -1;
+}
+
+bool InverseDynamicsFormulationBase::updateTaskWeight(int, double) {
+  return false;
+}
+
+int InverseDynamicsFormulationBase::getContactHandle(
+    const std::string&) const {
+  return -1;
+}
+
+bool InverseDynamicsFormulationBase::updateRigidContactWeights(int, double,
+                                                               double) {
+  return false;
+}
+
+bool InverseDynamicsFormulationBase::removeTask(int, double) { return false; }
+
+bool InverseDynamicsFormulationBase::removeRigidContact(int, double) {
+  return false;
+}
+
+bool InverseDynamicsFormulationBase::getContactForces(int, const HQPOutput&,
+                                                      RefVector) {
+  return false;
+}
+
+const solvers::HQPStackedData&
+InverseDynamicsFormulationBase::computeStackedProblemData(double time,
+                                                          ConstRefVector q,
+                                                          ConstRefVector v) {
+  solvers::stackHQPData(computeProblemData(time, q, v), m_stackedProblemData);
+  return m_stackedProblemData;
+}
 }  // namespace tsid
@@ -17,24 +17,112 @@
 
 #include <tsid/math/constraint-base.hpp>
 
+#include <atomic>
+
 using namespace tsid::math;
 
-ConstraintBase::ConstraintBase(const std::string& name) : m_name(name) {}
+namespace {
+// Shared by all the constraints, so that two different matrices never have
+// the same version
+std::atomic<std::uint64_t> matrixVersionCounter(0);
+}  // namespace
+
+ConstraintBase::ConstraintBase(const std::string& name)
+    : m_name(name),
+      m_matrixVersion(++matrixVersionCounter),
+      m_colOffset(0),
+      m_matrixStructure(CONSTRAINT_MATRIX_DENSE) {}
 
 ConstraintBase::ConstraintBase(const std::string& name, const unsigned int rows,
                                const unsigned int cols)
-    : m_name(name) {
+    : m_name(name),
+      m_matrixVersion(++matrixVersionCounter),
+      m_colOffset(0),
+      m_matrixStructure(CONSTRAINT_MATRIX_DENSE) {
   m_A = Matrix::Zero(rows, cols);
 }
 
 ConstraintBase::ConstraintBase(const std::string& name, ConstRefMatrix A)
-    : m_name(name), m_A(A) {}
+    : m_name(name),
+      m_A(A),
+      m_matrixVersion(++matrixVersionCounter),
+      m_colOffset(0),
+      m_matrixStructure(CONSTRAINT_MATRIX_DENSE) {}
 
 const std::string& ConstraintBase::name() const { return m_name; }
 
 const Matrix& ConstraintBase::matrix() const { return m_A; }
 
-Matrix& ConstraintBase::matrix() { return m_A; }
+Matrix& ConstraintBase::matrix() { return matrixForWrite(); }
+
+Matrix& ConstraintBase::matrixForWrite() {
+  m_matrixStructure = CONSTRAINT_MATRIX_DENSE;
+  markMatrixChanged();
+  return m_A;
+}
+
+void ConstraintBase::markMatrixChanged() {
+  m_matrixVersion = ++matrixVersionCounter;
+}
+
+void ConstraintBase::setColOffset(const unsigned int offset) {
+  if (offset == m_colOffset) return;
+  m_colOffset = offset;
+  markMatrixChanged();
+}
+
+void ConstraintBase::setColumnSupport(const ColumnSupport& support) {
+  if (support == m_columnSupport) return;
+  m_columnSupport = support;
+  markMatrixChanged();
+}
+
+void ConstraintBase::setSelectionMatrix(const VectorXi& cols,
+                                        ConstRefVector weights) {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(cols.size() == m_A.rows(),
+                                 "cols do not match the constraint dimension");
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(
+      weights.size() == m_A.rows(),
+      "weights do not match the constraint dimension");
+  bool diagonal = m_A.rows() == m_A.cols();
+  for (Eigen::Index i = 0; i < cols.size(); i++) {
+    PINOCCHIO_CHECK_INPUT_ARGUMENT(cols(i) >= 0 && cols(i) < m_A.cols(),
+                                   "selected column out of range");
+    diagonal = diagonal && cols(i) == i;
+  }
+
+  m_A.setZero();
+  for (Eigen::Index i = 0; i < cols.size(); i++) m_A(i, cols(i)) = weights(i);
+  m_selectedColumns = cols;
+  m_selectionWeights = weights;
+  if (!diagonal)
+    m_matrixStructure = CONSTRAINT_MATRIX_SELECTION;
+  else if (weights.size() > 0 && (weights.array() == weights(0)).all())
+    m_matrixStructure = CONSTRAINT_MATRIX_SCALED_IDENTITY;
+  else
+    m_matrixStructure = CONSTRAINT_MATRIX_DIAGONAL;
+  markMatrixChanged();
+}
+
+void ConstraintBase::copyMatrixStructure(const ConstraintBase& other) {
+  if (other.m_matrixStructure == m_matrixStructure &&
+      (m_matrixStructure == CONSTRAINT_MATRIX_DENSE ||
+       (other.m_selectedColumns == m_selectedColumns &&
+        other.m_selectionWeights == m_selectionWeights)))
+    return;
+  m_matrixStructure = other.m_matrixStructure;
+  m_selectedColumns = other.m_selectedColumns;
+  m_selectionWeights = other.m_selectionWeights;
+  markMatrixChanged();
+}
+
+ConstRefVector ConstraintBase::spannedVariables(ConstRefVector x) const {
+  if (x.size() == static_cast<Eigen::Index>(cols())) return x;
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(
+      x.size() >= static_cast<Eigen::Index>(m_colOffset + cols()),
+      "x does not contain the variables spanned by the constraint");
+  return x.segment(m_colOffset, cols());
+}
 
 bool ConstraintBase::setMatrix(ConstRefMatrix A) {
   PINOCCHIO_CHECK_INPUT_ARGUMENT(m_A.cols() == A.cols(),
@@ -42,5 +130,7 @@ bool ConstraintBase::setMatrix(ConstRefMatrix A) {
   PINOCCHIO_CHECK_INPUT_ARGUMENT(m_A.rows() == A.rows(),
                                  "rows do not match the constraint dimension");
   m_A = A;
+  m_matrixStructure = CONSTRAINT_MATRIX_DENSE;
+  markMatrixChanged();
   return true;
 }
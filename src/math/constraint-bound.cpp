@@ -51,6 +51,9 @@ unsigned int ConstraintBound::cols() const {
 void ConstraintBound::resize(const unsigned int r, const unsigned int c) {
   PINOCCHIO_CHECK_INPUT_ARGUMENT(r == c, "r and c need to be equal!");
   m_A.setIdentity(r, c);
+  m_columnSupport.clear();
+  m_matrixStructure = CONSTRAINT_MATRIX_DENSE;
+  markMatrixChanged();
   m_lb.setZero(r);
   m_ub.setZero(r);
 }
@@ -87,6 +90,7 @@ bool ConstraintBound::setUpperBound(ConstRefVector ub) {
 }
 
 bool ConstraintBound::checkConstraint(ConstRefVector x, double tol) const {
-  return (x.array() <= m_ub.array() + tol).all() &&
-         (x.array() >= m_lb.array() - tol).all();
+  ConstRefVector xs = spannedVariables(x);
+  return (xs.array() <= m_ub.array() + tol).all() &&
+         (xs.array() >= m_lb.array() - tol).all();
 }
@@ -45,6 +45,9 @@ unsigned int ConstraintEquality::cols() const {
 
 void ConstraintEquality::resize(const unsigned int r, const unsigned int c) {
   m_A.setZero(r, c);
+  m_columnSupport.clear();
+  m_matrixStructure = CONSTRAINT_MATRIX_DENSE;
+  markMatrixChanged();
   m_b.setZero(r);
 }
 
@@ -86,5 +89,5 @@ bool ConstraintEquality::setUpperBound(ConstRefVector) {
 }
 
 bool ConstraintEquality::checkConstraint(ConstRefVector x, double tol) const {
-  return (m_A * x - m_b).norm() < tol;
+  return (m_A * spannedVariables(x) - m_b).norm() < tol;
 }
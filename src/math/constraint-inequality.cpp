@@ -51,6 +51,9 @@ unsigned int ConstraintInequality::cols() const {
 
 void ConstraintInequality::resize(const unsigned int r, const unsigned int c) {
   m_A.setZero(r, c);
+  m_columnSupport.clear();
+  m_matrixStructure = CONSTRAINT_MATRIX_DENSE;
+  markMatrixChanged();
   m_lb.setZero(r);
   m_ub.setZero(r);
 }
@@ -87,6 +90,7 @@ bool ConstraintInequality::setUpperBound(ConstRefVector ub) {
 }
 
 bool ConstraintInequality::checkConstraint(ConstRefVector x, double tol) const {
-  return ((m_A * x).array() <= m_ub.array() + tol).all() &&
-         ((m_A * x).array() >= m_lb.array() - tol).all();
+  const Vector Ax = m_A * spannedVariables(x);
+  return (Ax.array() <= m_ub.array() + tol).all() &&
+         (Ax.array() >= m_lb.array() - tol).all();
 }
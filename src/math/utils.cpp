@@ -17,6 +17,8 @@
 
 #include <tsid/math/utils.hpp>
 
+#include <algorithm>
+
 namespace tsid {
 namespace math {
 
@@ -200,5 +202,22 @@ void nullSpaceBasisFromDecomposition(
   map = vMatrix.rightCols(vMatrix.cols() - rank);
 }
 
+void addColumnRange(ColumnSupport &support, unsigned int col,
+                    unsigned int cols) {
+  if (cols == 0) return;
+  // skip the ranges ending before col
+  ColumnSupport::iterator it = support.begin();
+  while (it != support.end() && it->col + it->cols < col) it++;
+  // merge the ranges overlapping or touching [col, col + cols)
+  unsigned int begin = col;
+  unsigned int end = col + cols;
+  while (it != support.end() && it->col <= end) {
+    begin = std::min(begin, it->col);
+    end = std::max(end, it->col + it->cols);
+    it = support.erase(it);
+  }
+  support.insert(it, ColumnRange(begin, end - begin));
+}
+
 }  // namespace math
 }  // namespace tsid
@@ -16,6 +16,7 @@
 //
 
 #include "tsid/robots/robot-wrapper.hpp"
+#include "tsid/math/utils.hpp"
 
 #include <pinocchio/multibody/model.hpp>
 #include <pinocchio/parsers/urdf.hpp>
@@ -343,6 +344,22 @@ void RobotWrapper::frameJacobianLocal(Data& data, const Model::FrameIndex index,
   return pinocchio::getFrameJacobian(m_model, data, index, pinocchio::LOCAL, J);
 }
 
+math::ColumnSupport RobotWrapper::frameJacobianSupport(
+    const Model::FrameIndex index) const {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(index < m_model.frames.size(),
+                                 "Frame index greater than size of frame "
+                                 "vector in model - frame may not exist");
+  math::ColumnSupport support;
+  const std::vector<Model::JointIndex>& joints =
+      m_model.supports[m_model.frames[index].parent];
+  for (Model::JointIndex j : joints) {
+    if (j == 0) continue;  // the universe has no velocity
+    math::addColumnRange(support, m_model.joints[j].idx_v(),
+                         m_model.joints[j].nv());
+  }
+  return support;
+}
+
 const Data::Matrix6x& RobotWrapper::momentumJacobian(const Data& data) const {
   return data.Ag;
 }
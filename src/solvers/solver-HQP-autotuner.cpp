@@ -0,0 +1,230 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-autotuner.hpp"
+#include "tsid/solvers/utils.hpp"
+#include "tsid/math/utils.hpp"
+
+#include <pinocchio/macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+namespace tsid {
+namespace solvers {
+
+using namespace math;
+SolverHQPAutotuner::SolverHQPAutotuner(const std::string& name)
+    : SolverHQPBase(name),
+      m_warmupLength(100),
+      m_warmupCount(0),
+      m_tolerance(1e-3),
+      m_percentile(0.9),
+      m_selected(-1),
+      m_outputSolver(-1) {
+  m_n = 0;
+  m_neq = 0;
+  m_nin = 0;
+}
+
+void SolverHQPAutotuner::sendMsg(const std::string& s) {
+  std::cout << "[SolverHQPAutotuner." << m_name << "] " << s << std::endl;
+}
+
+void SolverHQPAutotuner::addSolver(SolverHQPBase* solver) {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(solver != NULL, "The solver cannot be null");
+  m_solvers.push_back(std::unique_ptr<SolverHQPBase>(solver));
+  m_solveTimes.push_back(std::vector<double>());
+  m_solveTimes.back().reserve(m_warmupLength);
+  m_qualified.push_back(true);
+  restart();
+}
+
+SolverHQPBase& SolverHQPAutotuner::solver(unsigned int i) {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(i < m_solvers.size(),
+                                 "The index of the solver is out of range");
+  return *m_solvers[i];
+}
+
+void SolverHQPAutotuner::resize(unsigned int n, unsigned int neq,
+                                unsigned int nin) {
+  if (n != m_n || neq != m_neq || nin != m_nin) {
+#ifndef NDEBUG
+    sendMsg("Resizing problem from (" + toString(m_n) + ", " +
+            toString(m_neq) + ", " + toString(m_nin) + ") to (" + toString(n) +
+            ", " + toString(neq) + ", " + toString(nin) + ")");
+#endif
+    // the best solver depends on the size of the problem
+    restart();
+  }
+
+  m_n = n;
+  m_neq = neq;
+  m_nin = nin;
+}
+
+void SolverHQPAutotuner::retrieveQPData(const HQPData& problemData,
+                                        const bool /*hessianRegularization*/) {
+  stackHQPData(problemData, m_stackedData);
+}
+
+void SolverHQPAutotuner::restart() {
+  m_selected = -1;
+  m_warmupCount = 0;
+  for (std::size_t i = 0; i < m_solvers.size(); i++) {
+    m_solveTimes[i].clear();
+    m_qualified[i] = true;
+  }
+}
+
+bool SolverHQPAutotuner::isQualified(unsigned int i) const {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(i < m_solvers.size(),
+                                 "The index of the solver is out of range");
+  return m_qualified[i];
+}
+
+double SolverHQPAutotuner::getSolveTime(unsigned int i,
+                                        double percentile) const {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(i < m_solvers.size(),
+                                 "The index of the solver is out of range");
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(percentile >= 0.0 && percentile <= 1.0,
+                                 "The percentile must be between 0 and 1");
+  if (m_solveTimes[i].empty()) return 0.0;
+  std::vector<double> times = m_solveTimes[i];
+  const std::size_t k = std::min(
+      static_cast<std::size_t>(percentile * static_cast<double>(times.size())),
+      times.size() - 1);
+  std::nth_element(times.begin(), times.begin() + k, times.end());
+  return times[k];
+}
+
+const HQPOutput& SolverHQPAutotuner::solveAll(
+    const HQPStackedData& problemData) {
+  typedef std::chrono::steady_clock Clock;
+  const bool timed = m_warmupCount > 0;
+  const HQPOutput* reference = NULL;
+  for (std::size_t i = 0; i < m_solvers.size(); i++) {
+    const Clock::time_point start = Clock::now();
+    const HQPOutput& output = m_solvers[i]->solve(problemData);
+    const double time =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    if (timed) m_solveTimes[i].push_back(time);
+
+    if (i == 0) {
+      reference = &output;
+      continue;
+    }
+    if (!m_qualified[i]) continue;
+    if (output.status != reference->status ||
+        (output.status == HQP_STATUS_OPTIMAL &&
+         (output.x - reference->x).norm() >
+             m_tolerance * (1.0 + reference->x.norm()))) {
+#ifndef NDEBUG
+      sendMsg("Solver " + m_solvers[i]->name() +
+              " disagrees with the reference");
+#endif
+      m_qualified[i] = false;
+    }
+  }
+  m_warmupCount++;
+  return *reference;
+}
+
+void SolverHQPAutotuner::select() {
+  double bestTime = std::numeric_limits<double>::infinity();
+  m_selected = 0;
+  for (unsigned int i = 0; i < m_solvers.size(); i++) {
+    if (!m_qualified[i]) continue;
+    const double time = getSolveTime(i, m_percentile);
+    if (time < bestTime) {
+      bestTime = time;
+      m_selected = static_cast<int>(i);
+    }
+  }
+#ifndef NDEBUG
+  sendMsg("Selected solver " + m_solvers[m_selected]->name() + " (" +
+          toString(1e6 * bestTime) + " us)");
+#endif
+}
+
+const HQPOutput& SolverHQPAutotuner::solve(const HQPStackedData& problemData) {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(m_solvers.size() > 0,
+                                 "The autotuner does not contain any solver");
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  if (m_selected >= 0) {
+    m_outputSolver = m_selected;
+    return m_solvers[m_selected]->solve(problemData);
+  }
+
+  const HQPOutput& output = solveAll(problemData);
+  m_outputSolver = 0;
+  if (m_warmupCount >= m_warmupLength) select();
+  return output;
+}
+
+double SolverHQPAutotuner::getObjectiveValue() {
+  if (m_outputSolver < 0) return 0.0;
+  return m_solvers[m_outputSolver]->getObjectiveValue();
+}
+
+void SolverHQPAutotuner::setUseWarmStart(bool useWarmStart) {
+  SolverHQPBase::setUseWarmStart(useWarmStart);
+  for (std::unique_ptr<SolverHQPBase>& solver : m_solvers)
+    solver->setUseWarmStart(useWarmStart);
+}
+
+bool SolverHQPAutotuner::setMaximumIterations(unsigned int maxIter) {
+  if (!SolverHQPBase::setMaximumIterations(maxIter)) return false;
+  for (std::unique_ptr<SolverHQPBase>& solver : m_solvers)
+    solver->setMaximumIterations(maxIter);
+  return true;
+}
+
+bool SolverHQPAutotuner::setMaximumTime(double seconds) {
+  if (!SolverHQPBase::setMaximumTime(seconds)) return false;
+  for (std::unique_ptr<SolverHQPBase>& solver : m_solvers)
+    solver->setMaximumTime(seconds);
+  return true;
+}
+
+bool SolverHQPAutotuner::setWarmupLength(unsigned int length) {
+  if (length < 2) return false;
+  m_warmupLength = length;
+  for (std::vector<double>& times : m_solveTimes) times.reserve(length);
+  restart();
+  return true;
+}
+
+bool SolverHQPAutotuner::setTolerance(double tolerance) {
+  if (tolerance <= 0.0) return false;
+  m_tolerance = tolerance;
+  return true;
+}
+
+bool SolverHQPAutotuner::setPercentile(double percentile) {
+  if (percentile < 0.0 || percentile > 1.0) return false;
+  m_percentile = percentile;
+  return true;
+}
+}  // namespace solvers
+}  // namespace tsid
@@ -16,6 +16,7 @@
 //
 
 #include "tsid/solvers/solver-HQP-base.hpp"
+#include "tsid/solvers/utils.hpp"
 
 #include <iostream>
 
@@ -33,6 +34,11 @@ SolverHQPBase::SolverHQPBase(const std::string& name) {
   m_useWarmStart = true;
 }
 
+const HQPOutput& SolverHQPBase::solve(const HQPData& problemData) {
+  stackHQPData(problemData, m_stackedData);
+  return solve(m_stackedData);
+}
+
 bool SolverHQPBase::setMaximumIterations(unsigned int maxIter) {
   if (maxIter == 0) return false;
   m_maxIter = maxIter;
@@ -0,0 +1,286 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-eiquadprog-cascade.hpp"
+#include "tsid/solvers/utils.hpp"
+#include "tsid/math/utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace eiquadprog::solvers;
+
+namespace tsid {
+namespace solvers {
+
+using namespace math;
+SolverHQuadProgCascade::SolverHQuadProgCascade(const std::string& name)
+    : SolverHQPBase(name),
+      m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION),
+      m_rankThreshold(1e-8),
+      m_objValue(0.0),
+      m_lastLevel(-1) {
+  m_n = 0;
+  m_neq = 0;
+  m_nin = 0;
+}
+
+void SolverHQuadProgCascade::sendMsg(const std::string& s) {
+  std::cout << "[SolverHQuadProgCascade." << m_name << "] " << s << std::endl;
+}
+
+void SolverHQuadProgCascade::resize(unsigned int n, unsigned int neq,
+                                    unsigned int nin) {
+  if (n != m_n || neq != m_neq || nin != m_nin) {
+#ifndef NDEBUG
+    sendMsg("Resizing problem from (" + toString(m_n) + ", " +
+            toString(m_neq) + ", " + toString(m_nin) + ") to (" + toString(n) +
+            ", " + toString(neq) + ", " + toString(nin) + ")");
+#endif
+    m_output.resize(n, neq, 2 * nin);
+  }
+
+  m_n = n;
+  m_neq = neq;
+  m_nin = nin;
+}
+
+void SolverHQuadProgCascade::retrieveQPData(
+    const HQPData& problemData, const bool /*hessianRegularization*/) {
+  stackHQPData(problemData, m_stackedData);
+}
+
+bool SolverHQuadProgCascade::solveLevel(const HQPStackedLevel& level0,
+                                        const HQPStackedLevel* level,
+                                        LevelWorkspace& ws) {
+  const Eigen::Index nz = m_Z.cols();
+  Vector& x = m_output.x;
+
+  // Cost of the level in the reduced variables:
+  //   min 0.5 * || AZ u - r ||^2  with AZ = sqrt(W) A Z, r = sqrt(W) (b - A x)
+  if (level != NULL) {
+    ws.AZ.resize(level->CE.rows(), nz);
+    ws.r.resize(level->CE.rows());
+    for (std::vector<HQPStackedBlock>::const_iterator it =
+             level->blocks.begin();
+         it != level->blocks.end(); it++) {
+      if (!it->isEquality)
+        PINOCCHIO_CHECK_INPUT_ARGUMENT(
+            false, "Inequalities in the cost function are not implemented yet");
+
+      const double sw = std::sqrt(it->weight);
+      const auto A = level->CE.middleRows(it->row, it->rows);
+      ws.AZ.middleRows(it->row, it->rows).noalias() = sw * A * m_Z;
+      ws.r.segment(it->row, it->rows) =
+          sw * level->ce.segment(it->row, it->rows);
+      ws.r.segment(it->row, it->rows).noalias() -= sw * A * x;
+    }
+    ws.H.noalias() = ws.AZ.transpose() * ws.AZ;
+    ws.g.noalias() = -ws.AZ.transpose() * ws.r;
+  } else {
+    ws.AZ.resize(0, nz);
+    ws.H.setZero(nz, nz);
+    ws.g.setZero(nz);
+  }
+  ws.H.diagonal().array() += m_hessian_regularization;
+
+  // Without inequalities the level is an unconstrained least-squares problem
+  ws.useSolver = level0.CI.rows() > 0;
+  if (!ws.useSolver) {
+    ws.llt.compute(ws.H);
+    ws.u = ws.llt.solve(ws.g);
+    ws.u = -ws.u;
+    m_objValue = 0.5 * ws.g.dot(ws.u);
+    x.noalias() += m_Z * ws.u;
+    return true;
+  }
+
+  //  min 0.5 * u H u + g u
+  //  s.t.
+  //  CI Z u + CI x - lb >= 0
+  //  - CI Z u + ub - CI x >= 0
+  const unsigned int nin = 2 * static_cast<unsigned int>(level0.CI.rows());
+  if (ws.nz != nz || ws.nin != nin) {
+    ws.solver.reset(nz, 0, nin);
+    ws.solver.setMaxIter(m_maxIter);
+    ws.CE.resize(0, nz);
+    ws.ce0.resize(0);
+    ws.CI.resize(nin, nz);
+    ws.ci0.resize(nin);
+    ws.u.resize(nz);
+    ws.nz = static_cast<unsigned int>(nz);
+    ws.nin = nin;
+  }
+
+  m_CIx.noalias() = level0.CI * x;
+  m_CIZ.noalias() = level0.CI * m_Z;
+  for (std::vector<HQPStackedBlock>::const_iterator it = level0.blocks.begin();
+       it != level0.blocks.end(); it++) {
+    if (it->isEquality) continue;
+    const unsigned int i_in = 2 * it->row;
+    ws.CI.middleRows(i_in, it->rows) = m_CIZ.middleRows(it->row, it->rows);
+    ws.ci0.segment(i_in, it->rows) = m_CIx.segment(it->row, it->rows) -
+                                     level0.ci_lb.segment(it->row, it->rows);
+    ws.CI.middleRows(i_in + it->rows, it->rows) =
+        -m_CIZ.middleRows(it->row, it->rows);
+    ws.ci0.segment(i_in + it->rows, it->rows) =
+        level0.ci_ub.segment(it->row, it->rows) -
+        m_CIx.segment(it->row, it->rows);
+  }
+
+  EiquadprogFast_status status =
+      ws.solver.solve_quadprog(ws.H, ws.g, ws.CE, ws.ce0, ws.CI, ws.ci0, ws.u);
+  m_output.iterations += ws.solver.getIteratios();
+
+  if (status == EIQUADPROG_FAST_OPTIMAL) {
+    m_objValue = ws.solver.getObjValue();
+    x.noalias() += m_Z * ws.u;
+    return true;
+  }
+
+  if (status == EIQUADPROG_FAST_UNBOUNDED)
+    m_output.status = HQP_STATUS_INFEASIBLE;
+  else if (status == EIQUADPROG_FAST_MAX_ITER_REACHED)
+    m_output.status = HQP_STATUS_MAX_ITER_REACHED;
+  else
+    m_output.status = HQP_STATUS_ERROR;
+  return false;
+}
+
+void SolverHQuadProgCascade::updateNullSpace(LevelWorkspace& ws) {
+  if (ws.AZ.rows() == 0) return;
+
+  // The null space of AZ is spanned by the last columns of Q, where
+  // (AZ)^T P = Q R
+  ws.qr.setThreshold(m_rankThreshold);
+  ws.qr.compute(ws.AZ.transpose());
+  const Eigen::Index rank = ws.qr.rank();
+  if (rank == 0) return;
+
+  // Q is not formed: Z Q is obtained by applying the Householder reflections
+  // of Q to Z, its last columns span the new null space
+  const Eigen::Index nz = m_Z.cols() - rank;
+  m_Z.applyOnTheRight(ws.qr.householderQ());
+  m_Znext = m_Z.rightCols(nz);
+  m_Z.swap(m_Znext);
+}
+
+const HQPOutput& SolverHQuadProgCascade::solve(
+    const HQPStackedData& problemData) {
+  const HQPStackedLevel& level0 = problemData[0];
+  const unsigned int n = static_cast<unsigned int>(level0.CE.cols());
+  resize(n, static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  const unsigned int nLevels =
+      std::max(static_cast<unsigned int>(problemData.size()), 2u);
+  if (m_levels.size() < nLevels) m_levels.resize(nLevels);
+
+  m_output.status = HQP_STATUS_OPTIMAL;
+  m_output.iterations = 0;
+  m_lastLevel = -1;
+  m_objValue = 0.0;
+
+  // Particular solution and null space of the level-0 equalities, where
+  // CE^T P = Q R
+  Vector& x = m_output.x;
+  if (m_neq > 0) {
+    LevelWorkspace& ws = m_levels[0];
+    ws.qr.setThreshold(m_rankThreshold);
+    ws.qr.compute(level0.CE.transpose());
+    const Eigen::Index rank = ws.qr.rank();
+    m_y = ws.qr.colsPermutation().transpose() * level0.ce;
+    ws.qr.matrixR()
+        .topLeftCorner(rank, rank)
+        .triangularView<Eigen::Upper>()
+        .transpose()
+        .solveInPlace(m_y.head(rank));
+    // Q is not formed: x = Q [y; 0] and Z = Q [0; I] are obtained by applying
+    // the Householder reflections of Q
+    x.setZero(n);
+    x.head(rank) = m_y.head(rank);
+    x.applyOnTheLeft(ws.qr.householderQ());
+    m_Z.setZero(n, n - rank);
+    m_Z.bottomRows(n - rank).setIdentity();
+    m_Z.applyOnTheLeft(ws.qr.householderQ());
+
+    if ((level0.CE * x - level0.ce).norm() > 1e-6 * (1.0 + level0.ce.norm())) {
+      m_output.status = HQP_STATUS_INFEASIBLE;
+      return m_output;
+    }
+  } else {
+    x.setZero(n);
+    m_Z.setIdentity(n, n);
+  }
+
+  // Index of the last level containing tasks, the null space does not need
+  // to be updated after it
+  unsigned int lastTaskLevel = 1;
+  for (unsigned int k = 1; k < problemData.size(); k++)
+    if (problemData[k].blocks.size() > 0) lastTaskLevel = k;
+
+  for (unsigned int k = 1; k <= lastTaskLevel; k++) {
+    const HQPStackedLevel* level =
+        k < problemData.size() && problemData[k].blocks.size() > 0
+            ? &problemData[k]
+            : NULL;
+    // Level 1 is always solved, to enforce the level-0 inequalities
+    if (k > 1 && level == NULL) continue;
+
+    if (m_Z.cols() == 0) {
+      // x is fully determined by the levels already solved
+      if (k == 1 && m_nin > 0 &&
+          ((level0.CI * x - level0.ci_lb).minCoeff() < -1e-6 ||
+           (level0.ci_ub - level0.CI * x).minCoeff() < -1e-6))
+        m_output.status = HQP_STATUS_INFEASIBLE;
+      break;
+    }
+
+    LevelWorkspace& ws = m_levels[k];
+    if (!solveLevel(level0, level, ws)) return m_output;
+    if (ws.useSolver) m_lastLevel = static_cast<int>(k);
+    if (k < lastTaskLevel) updateNullSpace(ws);
+  }
+
+  m_output.lambda.setZero();
+  if (m_lastLevel >= 0) {
+    const EiquadprogFast& solver = m_levels[m_lastLevel].solver;
+    m_output.lambda.tail(2 * m_nin) = solver.getLagrangeMultipliers();
+    m_output.activeSet = solver.getActiveSet().head(solver.getActiveSetSize());
+  } else {
+    m_output.activeSet.resize(0);
+  }
+
+#ifndef NDEBUG
+  if (m_output.status == HQP_STATUS_OPTIMAL) {
+    const std::string violations = constraintViolationsToString(level0, x);
+    if (!violations.empty()) sendMsg(violations);
+  }
+#endif
+
+  return m_output;
+}
+
+double SolverHQuadProgCascade::getObjectiveValue() { return m_objValue; }
+
+bool SolverHQuadProgCascade::setMaximumIterations(unsigned int maxIter) {
+  SolverHQPBase::setMaximumIterations(maxIter);
+  for (LevelWorkspace& ws : m_levels) ws.solver.setMaxIter(maxIter);
+  return true;
+}
+}  // namespace solvers
+}  // namespace tsid
@@ -16,6 +16,7 @@
 //
 
 #include "tsid/solvers/solver-HQP-eiquadprog-fast.hpp"
+#include "tsid/solvers/utils.hpp"
 #include "tsid/math/utils.hpp"
 #include "eiquadprog/eiquadprog-fast.hpp"
 #include "tsid/utils/stop-watch.hpp"
@@ -27,13 +28,25 @@ using namespace eiquadprog::solvers;
 namespace tsid {
 namespace solvers {
 
+namespace {
+// Tolerance on the optimality conditions checked on the warm-start solution
+const double WARM_START_TOLERANCE = 1e-8;
+}  // namespace
+
 using namespace math;
 SolverHQuadProgFast::SolverHQuadProgFast(const std::string& name)
     : SolverHQPBase(name),
-      m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION) {
+      m_objValue(0.0),
+      m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION),
+      m_appliedRegularization(0.0),
+      m_provideHessianFactor(false),
+      m_activeSetValid(false),
+      m_hessianFactorValid(false),
+      m_kktFactorValid(false) {
   m_n = 0;
   m_neq = 0;
   m_nin = 0;
+  m_ninOneSided = 0;
 }
 
 void SolverHQuadProgFast::sendMsg(const std::string& s) {
@@ -61,6 +74,9 @@ void SolverHQuadProgFast::resize(unsigned int n, unsigned int neq,
 #endif
     m_qpData.CI.resize(2 * nin, n);
     m_qpData.ci0.resize(2 * nin);
+    m_CIx.resize(2 * nin);
+    m_inequalityRows.setConstant(2 * nin, -1);
+    m_ninOneSided = 2 * nin;
   }
   if (resizeVar) {
 #ifndef NDEBUG
@@ -69,11 +85,18 @@ void SolverHQuadProgFast::resize(unsigned int n, unsigned int neq,
     m_qpData.H.resize(n, n);
     m_qpData.g.resize(n);
     m_output.x.resize(n);
+    m_Jinv.resize(n, n);
+    m_M.resize(n, n);
+    m_MMt.resize(n, n);
+    m_Jtg.resize(n);
+    m_lambdaWs.resize(n);
+    m_hessianFactorValid = false;
   }
 
   if (resizeVar || resizeIn || resizeEq) {
-    m_solver.reset(n, neq, nin * 2);
+    m_solver.reset(n, neq, m_ninOneSided);
     m_output.resize(n, neq, 2 * nin);
+    m_activeSetValid = false;
   }
 
   m_n = n;
@@ -81,143 +104,230 @@ void SolverHQuadProgFast::resize(unsigned int n, unsigned int neq,
   m_nin = nin;
 }
 
+void SolverHQuadProgFast::resizeOneSidedInequalities(unsigned int nin) {
+  if (nin == m_ninOneSided) return;
+#ifndef NDEBUG
+  sendMsg("Resizing one-sided inequality constraints from " +
+          toString(m_ninOneSided) + " to " + toString(nin));
+#endif
+  m_qpData.CI.resize(nin, m_n);
+  m_qpData.ci0.resize(nin);
+  m_CIx.resize(nin);
+  m_inequalityRows.setConstant(nin, -1);
+  m_solver.reset(m_n, m_neq, nin);
+  m_activeSetValid = false;
+  m_ninOneSided = nin;
+}
+
+void SolverHQuadProgFast::updateOutputActiveSet() {
+  m_activeSet = m_solver.getActiveSet().segment(
+      m_neq, m_solver.getActiveSetSize() - m_neq);
+  m_output.activeSet.resize(m_activeSet.size());
+  for (Eigen::Index k = 0; k < m_activeSet.size(); k++)
+    m_output.activeSet(k) = m_inequalityRows(m_activeSet(k));
+}
+
 void SolverHQuadProgFast::retrieveQPData(const HQPData& problemData,
                                          const bool hessianRegularization) {
+  stackHQPData(problemData, m_stackedData);
+  retrieveStackedQPData(m_stackedData, hessianRegularization);
+  m_qpData.CE = m_stackedData[0].CE;
+}
+
+void SolverHQuadProgFast::retrieveStackedQPData(
+    const HQPStackedData& problemData, const bool hessianRegularization) {
   if (problemData.size() > 2) {
     PINOCCHIO_CHECK_INPUT_ARGUMENT(
         false, "Solver not implemented for more than 2 hierarchical levels.");
   }
 
-  // Compute the constraint matrix sizes
-  unsigned int neq = 0, nin = 0;
-  const ConstraintLevel& cl0 = problemData[0];
-  if (cl0.size() > 0) {
-    const unsigned int n = cl0[0].second->cols();
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      assert(n == constr->cols());
-      if (constr->isEquality())
-        neq += constr->rows();
-      else
-        nin += constr->rows();
-    }
-    // If necessary, resize the constraint matrices
-    resize(n, neq, nin);
-
-    unsigned int i_eq = 0, i_in = 0;
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      if (constr->isEquality()) {
-        m_qpData.CE.middleRows(i_eq, constr->rows()) = constr->matrix();
-        m_qpData.ce0.segment(i_eq, constr->rows()) = -constr->vector();
-        i_eq += constr->rows();
-
-      } else if (constr->isInequality()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()) = constr->matrix();
-        m_qpData.ci0.segment(i_in, constr->rows()) = -constr->lowerBound();
-        i_in += constr->rows();
-        m_qpData.CI.middleRows(i_in, constr->rows()) = -constr->matrix();
-        m_qpData.ci0.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      } else if (constr->isBound()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()).setIdentity();
-        m_qpData.ci0.segment(i_in, constr->rows()) = -constr->lowerBound();
-        i_in += constr->rows();
-        m_qpData.CI.middleRows(i_in, constr->rows()) =
-            -Matrix::Identity(m_n, m_n);
-        m_qpData.ci0.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      }
-    }
-  } else
-    resize(m_n, neq, nin);
+  // If necessary, resize the constraint matrices
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  resizeOneSidedInequalities(countFiniteInequalities(level0));
+
+  m_qpData.ce0 = -level0.ce;
+  if (finiteOneSidedInequalities(level0, m_qpData.CI, m_qpData.ci0,
+                                 m_inequalityRows))
+    m_activeSetValid = false;
 
   EIGEN_MALLOC_NOT_ALLOWED;
 
   // Compute the cost
   if (problemData.size() > 1) {
-    const ConstraintLevel& cl1 = problemData[1];
     m_qpData.H.setZero();
     m_qpData.g.setZero();
+    const bool hessianChanged = addLeastSquaresCost(
+        problemData[1], m_costCache, m_qpData.H, m_qpData.g);
+    // the factor of H is kept if neither the cost nor the regularization
+    // changed
+    const double regularization =
+        hessianRegularization ? m_hessian_regularization : 0.0;
+    if (hessianChanged || regularization != m_appliedRegularization)
+      m_hessianFactorValid = false;
+    m_appliedRegularization = regularization;
 
-    for (ConstraintLevel::const_iterator it = cl1.begin(); it != cl1.end();
-         it++) {
-      const double& w = it->first;
-      auto constr = it->second;
-      if (!constr->isEquality())
-        PINOCCHIO_CHECK_INPUT_ARGUMENT(
-            false, "Inequalities in the cost function are not implemented yet");
-
-      EIGEN_MALLOC_ALLOWED;
-      m_qpData.H.noalias() +=
-          w * constr->matrix().transpose() * constr->matrix();
-      EIGEN_MALLOC_NOT_ALLOWED;
-
-      m_qpData.g.noalias() -=
-          w * constr->matrix().transpose() * constr->vector();
-    }
-
-    if (hessianRegularization) {
-      double m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION);
+    if (hessianRegularization)
       m_qpData.H.diagonal().array() += m_hessian_regularization;
-    }
   }
 }
 
-const HQPOutput& SolverHQuadProgFast::solve(const HQPData& problemData) {
-  SolverHQuadProgFast::retrieveQPData(problemData);
+bool SolverHQuadProgFast::updateHessianFactor() {
+  if (m_hessianFactorValid) return true;
+
+  // H = L L^T, J = L^-T, as computed by eiquadprog
+  m_llt.compute(m_qpData.H);
+  m_hessianFactorValid = m_llt.info() == Eigen::Success;
+  if (!m_hessianFactorValid) return false;
+  m_Jinv.setIdentity();
+  m_llt.matrixU().solveInPlace(m_Jinv);
+  return true;
+}
+
+bool SolverHQuadProgFast::solveWithLastActiveSet(ConstRefMatrix CE) {
+  const Eigen::VectorXi& activeSet = m_activeSet;
+  const Eigen::Index na = activeSet.size();
+  const Eigen::Index m = m_neq + na;
+  if (m > m_n) return false;
+  for (Eigen::Index k = 0; k < na; k++)
+    if (activeSet(k) < 0 || activeSet(k) >= static_cast<int>(m_ninOneSided))
+      return false;
+
+  // With C x + c0 = 0 the active constraints and H^-1 = J J^T, the
+  // stationarity condition H x + g = C^T lambda gives
+  //   (C J) (C J)^T lambda = (C J) J^T g - c0
+  //   x = J ((C J)^T lambda - J^T g)
+  auto M = m_M.topRows(m);
+  auto lambda = m_lambdaWs.head(m);
+  M.topRows(m_neq).noalias() = CE * m_Jinv;
+  lambda.head(m_neq) = -m_qpData.ce0;
+  for (Eigen::Index k = 0; k < na; k++) {
+    M.row(m_neq + k).noalias() = m_qpData.CI.row(activeSet(k)) * m_Jinv;
+    lambda(m_neq + k) = -m_qpData.ci0(activeSet(k));
+  }
+  m_Jtg.noalias() = m_Jinv.transpose() * m_qpData.g;
+  lambda.noalias() += M * m_Jtg;
+
+  Eigen::Ref<Matrix> MMt = m_MMt.topLeftCorner(m, m);
+  MMt.noalias() = M * M.transpose();
+  Eigen::LLT<Eigen::Ref<Matrix> > llt(MMt);
+  if (llt.info() != Eigen::Success) return false;
+  llt.solveInPlace(lambda);
+  if (na > 0 && lambda.tail(na).minCoeff() < -WARM_START_TOLERANCE)
+    return false;
+
+  m_Jtg = -m_Jtg;
+  m_Jtg.noalias() += M.transpose() * lambda;
+  Vector& x = m_output.x;
+  x.noalias() = m_Jinv * m_Jtg;
+
+  // The active constraints may not be satisfied if they are redundant
+  m_CIx = m_qpData.ci0;
+  m_CIx.noalias() += m_qpData.CI * x;
+  if (m_ninOneSided > 0 && m_CIx.minCoeff() < -WARM_START_TOLERANCE)
+    return false;
+  for (Eigen::Index k = 0; k < na; k++)
+    if (m_CIx(activeSet(k)) > WARM_START_TOLERANCE) return false;
+  if (m_neq > 0 && (CE * x + m_qpData.ce0).cwiseAbs().maxCoeff() >
+                       WARM_START_TOLERANCE)
+    return false;
+
+  m_output.status = HQP_STATUS_OPTIMAL;
+  m_output.lambda.setZero();
+  m_output.lambda.head(m) = lambda;
+  m_output.iterations = 0;
+  m_objValue = 0.5 * x.dot(m_qpData.H * x) + m_qpData.g.dot(x);
+  return true;
+}
+
+bool SolverHQuadProgFast::solveEqualityConstrained(
+    const HQPStackedLevel& level0) {
+  if (m_neq > m_n) return false;
+  const bool hessianChanged = !m_hessianFactorValid;
+  if (hessianChanged && !updateHessianFactor()) return false;
+  bool equalitiesChanged, inequalitiesChanged;
+  compareMatrixVersions(level0, m_matrixVersions, equalitiesChanged,
+                        inequalitiesChanged);
+
+  // With H^-1 = J J^T and M = CE J, the KKT conditions
+  //   H x + g = CE^T lambda,  CE x = ce
+  // give (M M^T) lambda = ce + M J^T g and x = J (M^T lambda - J^T g)
+  if (hessianChanged || equalitiesChanged || !m_kktFactorValid) {
+    m_kktM.noalias() = level0.CE * m_Jinv;
+    m_MMt.topLeftCorner(m_neq, m_neq).noalias() =
+        m_kktM * m_kktM.transpose();
+    m_kktLLT.compute(m_MMt.topLeftCorner(m_neq, m_neq));
+    m_kktFactorValid = m_kktLLT.info() == Eigen::Success;
+    if (!m_kktFactorValid) return false;
+  }
+
+  auto lambda = m_lambdaWs.head(m_neq);
+  m_Jtg.noalias() = m_Jinv.transpose() * m_qpData.g;
+  lambda = level0.ce;
+  lambda.noalias() += m_kktM * m_Jtg;
+  m_kktLLT.solveInPlace(lambda);
+  m_Jtg = -m_Jtg;
+  m_Jtg.noalias() += m_kktM.transpose() * lambda;
+  Vector& x = m_output.x;
+  x.noalias() = m_Jinv * m_Jtg;
+
+  m_output.status = HQP_STATUS_OPTIMAL;
+  m_output.lambda.setZero();
+  m_output.lambda.head(m_neq) = lambda;
+  m_output.activeSet.resize(0);
+  m_output.iterations = 0;
+  // J^T H J = I, so that x^T H x = |J^-1 x|^2
+  m_objValue = 0.5 * m_Jtg.squaredNorm() + m_qpData.g.dot(x);
+  m_activeSetValid = false;
+  return true;
+}
+
+const HQPOutput& SolverHQuadProgFast::solve(const HQPStackedData& problemData) {
+  SolverHQuadProgFast::retrieveStackedQPData(problemData);
 
   START_PROFILER_EIQUADPROG_FAST(PROFILE_EIQUADPROG_SOLUTION);
+  EIGEN_MALLOC_ALLOWED
+  if (m_ninOneSided == 0 && solveEqualityConstrained(problemData[0])) {
+    STOP_PROFILER_EIQUADPROG_FAST(PROFILE_EIQUADPROG_SOLUTION);
+    return m_output;
+  }
+
+  m_solver.is_inverse_provided_ =
+      (m_useWarmStart || m_provideHessianFactor) && updateHessianFactor();
+  if (m_useWarmStart && m_solver.is_inverse_provided_ && m_activeSetValid &&
+      solveWithLastActiveSet(problemData[0].CE)) {
+    STOP_PROFILER_EIQUADPROG_FAST(PROFILE_EIQUADPROG_SOLUTION);
+    return m_output;
+  }
+  // eiquadprog modifies the factor, so it works on a copy
+  if (m_solver.is_inverse_provided_) m_solver.m_J = m_Jinv;
+
   //  min 0.5 * x G x + g0 x
   //  s.t.
   //  CE x + ce0 = 0
   //  CI x + ci0 >= 0
-  EIGEN_MALLOC_ALLOWED
-  eiquadprog::solvers::EiquadprogFast_status status =
-      m_solver.solve_quadprog(m_qpData.H, m_qpData.g, m_qpData.CE, m_qpData.ce0,
-                              m_qpData.CI, m_qpData.ci0, m_output.x);
+  eiquadprog::solvers::EiquadprogFast_status status = m_solver.solve_quadprog(
+      m_qpData.H, m_qpData.g, problemData[0].CE, m_qpData.ce0, m_qpData.CI,
+      m_qpData.ci0, m_output.x);
 
   STOP_PROFILER_EIQUADPROG_FAST(PROFILE_EIQUADPROG_SOLUTION);
 
+  m_activeSetValid = status == EIQUADPROG_FAST_OPTIMAL;
   if (status == EIQUADPROG_FAST_OPTIMAL) {
     m_output.status = HQP_STATUS_OPTIMAL;
-    m_output.lambda = m_solver.getLagrangeMultipliers();
+    m_output.lambda.setZero();
+    m_output.lambda.head(m_neq + m_ninOneSided) =
+        m_solver.getLagrangeMultipliers();
     m_output.iterations = m_solver.getIteratios();
-    //    m_output.activeSet =
-    //    m_solver.getActiveSet().tail(2*m_nin).head(m_solver.getActiveSetSize()-m_neq);
-    m_output.activeSet = m_solver.getActiveSet().segment(
-        m_neq, m_solver.getActiveSetSize() - m_neq);
+    m_objValue = m_solver.getObjValue();
+    updateOutputActiveSet();
 #ifndef NDEBUG
-    const Vector& x = m_output.x;
-
-    const ConstraintLevel& cl0 = problemData[0];
-    if (cl0.size() > 0) {
-      for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-           it++) {
-        auto constr = it->second;
-        if (constr->checkConstraint(x) == false) {
-          // m_output.status = HQP_STATUS_ERROR;
-          if (constr->isEquality()) {
-            sendMsg("Equality " + constr->name() + " violated: " +
-                    toString((constr->matrix() * x - constr->vector()).norm()));
-          } else if (constr->isInequality()) {
-            sendMsg(
-                "Inequality " + constr->name() + " violated: " +
-                toString(
-                    (constr->matrix() * x - constr->lowerBound()).minCoeff()) +
-                "\n" +
-                toString(
-                    (constr->upperBound() - constr->matrix() * x).minCoeff()));
-          } else if (constr->isBound()) {
-            sendMsg("Bound " + constr->name() + " violated: " +
-                    toString((x - constr->lowerBound()).minCoeff()) + "\n" +
-                    toString((constr->upperBound() - x).minCoeff()));
-          }
-        }
-      }
-    }
+    const std::string violations =
+        constraintViolationsToString(problemData[0], m_output.x);
+    if (!violations.empty()) sendMsg(violations);
 #endif
   } else if (status == EIQUADPROG_FAST_UNBOUNDED)
     m_output.status = HQP_STATUS_INFEASIBLE;
@@ -229,9 +339,7 @@ const HQPOutput& SolverHQuadProgFast::solve(const HQPData& problemData) {
   return m_output;
 }
 
-double SolverHQuadProgFast::getObjectiveValue() {
-  return m_solver.getObjValue();
-}
+double SolverHQuadProgFast::getObjectiveValue() { return m_objValue; }
 
 bool SolverHQuadProgFast::setMaximumIterations(unsigned int maxIter) {
   SolverHQPBase::setMaximumIterations(maxIter);
@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-eiquadprog-structured.hpp"
+
+#include <algorithm>
+
+namespace tsid {
+namespace solvers {
+
+using namespace math;
+SolverHQuadProgStructured::SolverHQuadProgStructured(const std::string& name)
+    : SolverHQuadProgFast(name), m_border(0) {
+  m_provideHessianFactor = true;
+}
+
+void SolverHQuadProgStructured::updateStructure(
+    const HQPStackedData& problemData) {
+  const unsigned int n = static_cast<unsigned int>(problemData[0].CE.cols());
+
+  // The border gathers the leading variables of the tasks starting at the
+  // first variable. The other tasks are clipped to the variables after the
+  // border, and overlapping tasks belong to the same diagonal block.
+  unsigned int border = 0;
+  m_spans.clear();
+  if (problemData.size() > 1) {
+    const std::vector<HQPStackedBlock>& blocks = problemData[1].blocks;
+    for (const HQPStackedBlock& b : blocks)
+      if (b.col == 0) border = std::max(border, b.cols);
+    for (const HQPStackedBlock& b : blocks) {
+      const unsigned int col = std::max(b.col, border);
+      if (b.col + b.cols > col)
+        m_spans.push_back(ColumnRange(col, b.col + b.cols - col));
+    }
+  }
+  std::sort(m_spans.begin(), m_spans.end(),
+            [](const ColumnRange& a, const ColumnRange& b) {
+              return a.col < b.col;
+            });
+
+  // variables without task form their own blocks, the Hessian being diagonal
+  // there
+  unsigned int end = border;
+  m_newBlocks.clear();
+  for (const ColumnRange& r : m_spans) {
+    if (r.col >= end) {
+      if (r.col > end) m_newBlocks.push_back(ColumnRange(end, r.col - end));
+      m_newBlocks.push_back(r);
+    } else if (r.col + r.cols > end) {
+      m_newBlocks.back().cols = r.col + r.cols - m_newBlocks.back().col;
+    }
+    end = m_newBlocks.empty() ? border
+                              : m_newBlocks.back().col + m_newBlocks.back().cols;
+  }
+  if (n > end) m_newBlocks.push_back(ColumnRange(end, n - end));
+
+  if (border == m_border && m_newBlocks == m_blocks &&
+      static_cast<unsigned int>(m_W.cols()) == n - border)
+    return;
+  m_border = border;
+  m_blocks = m_newBlocks;
+  m_blockLLT.resize(m_blocks.size());
+  m_W.resize(border, n - border);
+  m_S.resize(border, border);
+  m_T.resize(n - border, border);
+  m_hessianFactorValid = false;
+}
+
+bool SolverHQuadProgStructured::updateHessianFactor() {
+  if (m_hessianFactorValid) return true;
+
+  // With H ordered as [D C^T; C A], D = diag(D_i) = L_D L_D^T,
+  // W = C L_D^-T and S = A - W W^T = L_S L_S^T, the factor
+  //   L = [L_D 0; W L_S]
+  // satisfies H = L L^T, so that J = L^-T is
+  //   [L_D^-T  -L_D^-T W^T L_S^-T; 0  L_S^-T]
+  const Matrix& H = m_qpData.H;
+  const Eigen::Index nb = m_border;
+  m_Jinv.setZero();
+  for (std::size_t i = 0; i < m_blocks.size(); i++) {
+    const ColumnRange& r = m_blocks[i];
+    Eigen::LLT<Matrix>& llt = m_blockLLT[i];
+    llt.compute(H.block(r.col, r.col, r.cols, r.cols));
+    if (llt.info() != Eigen::Success) return false;
+    auto Ji = m_Jinv.block(r.col, r.col, r.cols, r.cols);
+    Ji.setIdentity();
+    llt.matrixU().solveInPlace(Ji);
+    m_W.middleCols(r.col - nb, r.cols).noalias() =
+        H.block(0, r.col, nb, r.cols) * Ji.triangularView<Eigen::Upper>();
+  }
+
+  m_S = H.topLeftCorner(nb, nb);
+  m_S.selfadjointView<Eigen::Lower>().rankUpdate(m_W, -1.0);
+  m_schurLLT.compute(m_S);
+  if (m_schurLLT.info() != Eigen::Success) return false;
+  auto JB = m_Jinv.topLeftCorner(nb, nb);
+  JB.setIdentity();
+  m_schurLLT.matrixU().solveInPlace(JB);
+
+  m_T.noalias() = -m_W.transpose() * JB.triangularView<Eigen::Upper>();
+  for (const ColumnRange& r : m_blocks)
+    m_Jinv.block(r.col, 0, r.cols, nb).noalias() =
+        m_Jinv.block(r.col, r.col, r.cols, r.cols)
+            .triangularView<Eigen::Upper>() *
+        m_T.middleRows(r.col - nb, r.cols);
+
+  m_hessianFactorValid = true;
+  return true;
+}
+
+const HQPOutput& SolverHQuadProgStructured::solve(
+    const HQPStackedData& problemData) {
+  updateStructure(problemData);
+  return SolverHQuadProgFast::solve(problemData);
+}
+
+}  // namespace solvers
+}  // namespace tsid
@@ -16,6 +16,7 @@
 //
 
 #include "tsid/solvers/solver-HQP-eiquadprog.hpp"
+#include "tsid/solvers/utils.hpp"
 #include "tsid/math/utils.hpp"
 #include "eiquadprog/eiquadprog.hpp"
 #include "tsid/utils/stop-watch.hpp"
@@ -73,72 +74,33 @@ void SolverHQuadProg::resize(unsigned int n, unsigned int neq,
 }
 
 void SolverHQuadProg::retrieveQPData(const HQPData& problemData,
-                                     const bool /*hessianRegularization*/) {
+                                     const bool hessianRegularization) {
+  stackHQPData(problemData, m_stackedData);
+  retrieveStackedQPData(m_stackedData, hessianRegularization);
+  m_qpData.CE = m_stackedData[0].CE;
+}
+
+void SolverHQuadProg::retrieveStackedQPData(
+    const HQPStackedData& problemData, const bool /*hessianRegularization*/) {
   if (problemData.size() > 2) {
     PINOCCHIO_CHECK_INPUT_ARGUMENT(
         false, "Solver not implemented for more than 2 hierarchical levels.");
   }
 
-  // Compute the constraint matrix sizes
-  unsigned int neq = 0, nin = 0;
-  const ConstraintLevel& cl0 = problemData[0];
-  if (cl0.size() > 0) {
-    const unsigned int n = cl0[0].second->cols();
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      assert(n == constr->cols());
-      if (constr->isEquality())
-        neq += constr->rows();
-      else
-        nin += constr->rows();
-    }
-    // If necessary, resize the constraint matrices
-    resize(n, neq, nin);
+  // If necessary, resize the constraint matrices
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
 
-    int i_eq = 0, i_in = 0;
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      if (constr->isEquality()) {
-        m_qpData.CE.middleRows(i_eq, constr->rows()) = constr->matrix();
-        m_qpData.ce0.segment(i_eq, constr->rows()) = -constr->vector();
-        i_eq += constr->rows();
-      } else if (constr->isInequality()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()) = constr->matrix();
-        m_qpData.ci0.segment(i_in, constr->rows()) = -constr->lowerBound();
-        i_in += constr->rows();
-        m_qpData.CI.middleRows(i_in, constr->rows()) = -constr->matrix();
-        m_qpData.ci0.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      } else if (constr->isBound()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()).setIdentity();
-        m_qpData.ci0.segment(i_in, constr->rows()) = -constr->lowerBound();
-        i_in += constr->rows();
-        m_qpData.CI.middleRows(i_in, constr->rows()) =
-            -Matrix::Identity(m_n, m_n);
-        m_qpData.ci0.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      }
-    }
-  } else
-    resize(m_n, neq, nin);
+  m_qpData.ce0 = -level0.ce;
+  oneSidedInequalities(level0, m_qpData.CI, m_qpData.ci0);
 
   if (problemData.size() > 1) {
-    const ConstraintLevel& cl1 = problemData[1];
     m_qpData.H.setZero();
     m_qpData.g.setZero();
-    for (ConstraintLevel::const_iterator it = cl1.begin(); it != cl1.end();
-         it++) {
-      const double& w = it->first;
-      auto constr = it->second;
-      if (!constr->isEquality())
-        PINOCCHIO_CHECK_INPUT_ARGUMENT(
-            false, "Inequalities in the cost function are not implemented yet");
-
-      m_qpData.H += w * constr->matrix().transpose() * constr->matrix();
-      m_qpData.g -= w * (constr->matrix().transpose() * constr->vector());
-    }
+    addLeastSquaresCost(problemData[1], m_costCache, m_qpData.H,
+                        m_qpData.g);
     m_qpData.H.diagonal() += m_hessian_regularization * Vector::Ones(m_n);
   }
 
@@ -193,21 +155,21 @@ void SolverHQuadProg::retrieveQPData(const HQPData& problemData,
     //	STOP_PROFILER("Eiquadprog project Hessian full");
 
     START_PROFILER("Eiquadprog project Hessian incremental");
-    const ConstraintLevel& cl1 = problemData[1];
+    const HQPStackedLevel& level1 = problemData[1];
     m_ZT_H_Z.setZero();
     // m_qpData.g.setZero();
     Matrix AZ;
-    for (ConstraintLevel::const_iterator it = cl1.begin(); it != cl1.end();
-         it++) {
-      const double& w = it->first;
-      auto constr = it->second;
-      if (!constr->isEquality())
+    for (std::vector<HQPStackedBlock>::const_iterator it =
+             level1.blocks.begin();
+         it != level1.blocks.end(); it++) {
+      const double& w = it->weight;
+      if (!it->isEquality)
         PINOCCHIO_CHECK_INPUT_ARGUMENT(
             false, "Inequalities in the cost function are not implemented yet");
 
-      AZ.noalias() = constr->matrix() * Z.rightCols(m_n - r);
+      AZ.noalias() =
+          level1.CE.middleRows(it->row, it->rows) * Z.rightCols(m_n - r);
       m_ZT_H_Z += w * AZ.transpose() * AZ;
-      // m_qpData.g -= w*(constr->matrix().transpose()*constr->vector());
     }
     // m_ZT_H_Z.diagonal() += 1e-8*Vector::Ones(m_n);
     m_qpData.CI_Z.noalias() = m_qpData.CI * Z.rightCols(m_n - r);
@@ -217,7 +179,7 @@ void SolverHQuadProg::retrieveQPData(const HQPData& problemData,
 #endif
 }
 
-const HQPOutput& SolverHQuadProg::solve(const HQPData& problemData) {
+const HQPOutput& SolverHQuadProg::solve(const HQPStackedData& problemData) {
   // #ifndef NDEBUG
   //   PRINT_MATRIX(m_qpData.H);
   //   PRINT_VECTOR(m_qpData.g);
@@ -226,14 +188,14 @@ const HQPOutput& SolverHQuadProg::solve(const HQPData& problemData) {
   //   PRINT_MATRIX(m_qpData.CI);
   //   PRINT_VECTOR(m_qpData.ci0);
   // #endif
-  SolverHQuadProg::retrieveQPData(problemData);
+  SolverHQuadProg::retrieveStackedQPData(problemData);
 
   //  min 0.5 * x G x + g0 x
   //  s.t.
   //  CE^T x + ce0 = 0
   //  CI^T x + ci0 >= 0
   m_objValue = eiquadprog::solvers::solve_quadprog(
-      m_qpData.H, m_qpData.g, m_qpData.CE.transpose(), m_qpData.ce0,
+      m_qpData.H, m_qpData.g, problemData[0].CE.transpose(), m_qpData.ce0,
       m_qpData.CI.transpose(), m_qpData.ci0, m_output.x, m_activeSet,
       m_activeSetSize);
 
@@ -242,32 +204,9 @@ const HQPOutput& SolverHQuadProg::solve(const HQPData& problemData) {
   else {
     m_output.status = HQP_STATUS_OPTIMAL;
 #ifndef NDEBUG
-    const Vector& x = m_output.x;
-    const ConstraintLevel& cl0 = problemData[0];
-    if (cl0.size() > 0) {
-      for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-           it++) {
-        auto constr = it->second;
-        if (constr->checkConstraint(x) == false) {
-          if (constr->isEquality()) {
-            sendMsg("Equality " + constr->name() + " violated: " +
-                    toString((constr->matrix() * x - constr->vector()).norm()));
-          } else if (constr->isInequality()) {
-            sendMsg(
-                "Inequality " + constr->name() + " violated: " +
-                toString(
-                    (constr->matrix() * x - constr->lowerBound()).minCoeff()) +
-                "\n" +
-                toString(
-                    (constr->upperBound() - constr->matrix() * x).minCoeff()));
-          } else if (constr->isBound()) {
-            sendMsg("Bound " + constr->name() + " violated: " +
-                    toString((x - constr->lowerBound()).minCoeff()) + "\n" +
-                    toString((constr->upperBound() - x).minCoeff()));
-          }
-        }
-      }
-    }
+    const std::string violations =
+        constraintViolationsToString(problemData[0], m_output.x);
+    if (!violations.empty()) sendMsg(violations);
 #endif
   }
 
@@ -18,6 +18,9 @@
 #include <tsid/solvers/solver-HQP-factory.hpp>
 #include <tsid/solvers/solver-HQP-eiquadprog.hpp>
 #include <tsid/solvers/solver-HQP-eiquadprog-fast.hpp>
+#include <tsid/solvers/solver-HQP-eiquadprog-cascade.hpp>
+#include <tsid/solvers/solver-HQP-eiquadprog-structured.hpp>
+#include <tsid/solvers/solver-HQP-autotuner.hpp>
 
 #ifdef TSID_QPMAD_FOUND
 #include <tsid/solvers/solver-HQP-qpmad.hpp>
@@ -45,6 +48,12 @@ SolverHQPBase* SolverHQPFactory::createNewSolver(const SolverHQP solverType,
   if (solverType == SOLVER_HQP_EIQUADPROG_FAST)
     return new SolverHQuadProgFast(name);
 
+  if (solverType == SOLVER_HQP_EIQUADPROG_CASCADE)
+    return new SolverHQuadProgCascade(name);
+
+  if (solverType == SOLVER_HQP_EIQUADPROG_STRUCTURED)
+    return new SolverHQuadProgStructured(name);
+
 #ifdef TSID_QPMAD_FOUND
   if (solverType == SOLVER_HQP_QPMAD) return new SolverHQpmad(name);
 #endif
@@ -61,6 +70,27 @@ SolverHQPBase* SolverHQPFactory::createNewSolver(const SolverHQP solverType,
   if (solverType == SOLVER_HQP_QPOASES) return new Solver_HQP_qpoases(name);
 #endif
 
+  if (solverType == SOLVER_HQP_AUTOTUNER) {
+    // all the solvers compiled in, SolverHQuadProgFast being the reference.
+    // The cascade is left out: with more than two levels it solves a
+    // different problem than the weighted solvers.
+    SolverHQPAutotuner* solver = new SolverHQPAutotuner(name);
+    solver->addSolver(new SolverHQuadProgFast(name + "_eiquadprog_fast"));
+    solver->addSolver(new SolverHQuadProg(name + "_eiquadprog"));
+    solver->addSolver(
+        new SolverHQuadProgStructured(name + "_eiquadprog_structured"));
+#ifdef TSID_QPMAD_FOUND
+    solver->addSolver(new SolverHQpmad(name + "_qpmad"));
+#endif
+#ifdef TSID_WITH_PROXSUITE
+    solver->addSolver(new SolverProxQP(name + "_proxqp"));
+#endif
+#ifdef TSID_WITH_OSQP
+    solver->addSolver(new SolverOSQP(name + "_osqp"));
+#endif
+    return solver;
+  }
+
   PINOCCHIO_CHECK_INPUT_ARGUMENT(false, "Specified solver type not recognized");
   return NULL;
 }
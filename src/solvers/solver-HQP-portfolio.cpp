@@ -0,0 +1,366 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-portfolio.hpp"
+#include "tsid/solvers/utils.hpp"
+#include "tsid/math/utils.hpp"
+#include "tsid/math/constraint-equality.hpp"
+#include "tsid/math/constraint-inequality.hpp"
+#include "tsid/math/constraint-bound.hpp"
+
+#include <pinocchio/macros.hpp>
+
+#include <exception>
+#include <iostream>
+
+namespace tsid {
+namespace solvers {
+
+namespace {
+// Largest violation of the constraints of level 0 accepted for a solution
+// that is not optimal
+const double FEASIBILITY_TOLERANCE = 1e-6;
+
+// Constraint with the type, the size and the column offset of c, the matrix
+// of which is not used (see copyConstraintDescription)
+std::shared_ptr<tsid::math::ConstraintBase> makeConstraintDescription(
+    const tsid::math::ConstraintBase& c) {
+  using namespace tsid::math;
+  std::shared_ptr<ConstraintBase> copy;
+  if (c.isEquality())
+    copy = std::make_shared<ConstraintEquality>(c.name(), c.rows(), c.cols());
+  else if (c.isInequality())
+    copy =
+        std::make_shared<ConstraintInequality>(c.name(), c.rows(), c.cols());
+  else
+    copy = std::make_shared<ConstraintBound>(c.name(), c.rows());
+  copy->setColOffset(c.colOffset());
+  return copy;
+}
+
+// Copy the column support and the matrix structure of c to copy
+void copyConstraintDescription(const tsid::math::ConstraintBase& c,
+                               tsid::math::ConstraintBase& copy) {
+  copy.setColumnSupport(c.columnSupport());
+  copy.copyMatrixStructure(c);
+}
+}  // namespace
+
+using namespace math;
+SolverHQPPortfolio::SolverHQPPortfolio(const std::string& name,
+                                       SolverPortfolioMode mode)
+    : SolverHQPBase(name),
+      m_stop(false),
+      m_request(0),
+      m_settings(0),
+      m_mode(mode),
+      m_solverIndex(-1),
+      m_deadlineReached(false),
+      m_objValue(0.0),
+      m_previousSolutions(0) {
+  m_n = 0;
+  m_neq = 0;
+  m_nin = 0;
+}
+
+SolverHQPPortfolio::~SolverHQPPortfolio() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_requestCondition.notify_all();
+  for (std::unique_ptr<Member>& member : m_members) member->thread.join();
+}
+
+void SolverHQPPortfolio::sendMsg(const std::string& s) {
+  std::cout << "[SolverHQPPortfolio." << m_name << "] " << s << std::endl;
+}
+
+void SolverHQPPortfolio::addSolver(SolverHQPBase* solver) {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(solver != NULL, "The solver cannot be null");
+  m_members.push_back(std::unique_ptr<Member>(new Member()));
+  Member& member = *m_members.back();
+  member.solver.reset(solver);
+  member.thread = std::thread(&SolverHQPPortfolio::work, this,
+                              std::ref(member));
+}
+
+SolverHQPBase& SolverHQPPortfolio::solver(unsigned int i) {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(i < m_members.size(),
+                                 "The index of the solver is out of range");
+  return *m_members[i]->solver;
+}
+
+bool SolverHQPPortfolio::isSolverRunning(unsigned int i) {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(i < m_members.size(),
+                                 "The index of the solver is out of range");
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const Member::State state = m_members[i]->state;
+  return state == Member::REQUESTED || state == Member::RUNNING;
+}
+
+void SolverHQPPortfolio::resize(unsigned int n, unsigned int neq,
+                                unsigned int nin) {
+  if (n != m_n || neq != m_neq || nin != m_nin) {
+#ifndef NDEBUG
+    sendMsg("Resizing problem from (" + toString(m_n) + ", " +
+            toString(m_neq) + ", " + toString(m_nin) + ") to (" + toString(n) +
+            ", " + toString(neq) + ", " + toString(nin) + ")");
+#endif
+    m_output.resize(n, neq, 2 * nin);
+    m_output.x.setZero();
+    m_output.lambda.setZero();
+    m_output.activeSet.resize(0);
+    m_xPrevious.resize(n);
+    // the previous solutions cannot be extrapolated any more
+    m_previousSolutions = 0;
+  }
+
+  m_n = n;
+  m_neq = neq;
+  m_nin = nin;
+}
+
+void SolverHQPPortfolio::retrieveQPData(const HQPData& problemData,
+                                        const bool /*hessianRegularization*/) {
+  stackHQPData(problemData, m_stackedData);
+}
+
+void SolverHQPPortfolio::work(Member& member) {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_requestCondition.wait(
+        lock, [&] { return m_stop || member.state == Member::REQUESTED; });
+    if (m_stop) return;
+
+    member.state = Member::RUNNING;
+    lock.unlock();
+    // an exception must not leave the worker thread, the solver then fails
+    try {
+      member.output = member.solver->solve(member.data);
+      member.objValue = member.solver->getObjectiveValue();
+    } catch (const std::exception& e) {
+#ifndef NDEBUG
+      sendMsg(std::string("A solver threw an exception: ") + e.what());
+#endif
+      member.output.status = HQP_STATUS_ERROR;
+      member.objValue = 0.0;
+    } catch (...) {
+      member.output.status = HQP_STATUS_ERROR;
+      member.objValue = 0.0;
+    }
+    lock.lock();
+    member.state = Member::DONE;
+    m_doneCondition.notify_all();
+  }
+}
+
+void SolverHQPPortfolio::copyProblemData(Member& member,
+                                         const HQPStackedData& problemData) {
+  if (member.data.size() != problemData.size()) {
+    member.data.resize(problemData.size());
+    member.layout.resize(problemData.size());
+  }
+
+  for (std::size_t k = 0; k < problemData.size(); k++) {
+    const HQPStackedLevel& level = problemData[k];
+    HQPStackedLevel& copy = member.data[k];
+    copy.CE = level.CE;
+    copy.ce = level.ce;
+    copy.CI = level.CI;
+    copy.ci_lb = level.ci_lb;
+    copy.ci_ub = level.ci_ub;
+
+    // the worker never reads the constraints of the problem, which may be
+    // modified while it runs, but copies of their description
+    const bool sameLayout = sameBlockLayout(member.layout[k], level.blocks);
+    if (!sameLayout) {
+      member.layout[k] = level.blocks;
+      copy.blocks = level.blocks;
+      for (HQPStackedBlock& cb : copy.blocks)
+        cb.constraint = makeConstraintDescription(*cb.constraint);
+    }
+    for (std::size_t j = 0; j < level.blocks.size(); j++) {
+      const HQPStackedBlock& b = level.blocks[j];
+      HQPStackedBlock& cb = copy.blocks[j];
+      if (!sameLayout || b.matrixVersion == 0 ||
+          b.matrixVersion != cb.matrixVersion)
+        copyConstraintDescription(*b.constraint, *cb.constraint);
+      cb.weight = b.weight;
+      cb.matrixVersion = b.matrixVersion;
+    }
+  }
+}
+
+bool SolverHQPPortfolio::start(Member& member,
+                               const HQPStackedData& problemData,
+                               Clock::time_point deadline) {
+  if (member.state == Member::REQUESTED || member.state == Member::RUNNING)
+    return false;
+
+  // the worker is waiting, so the solver and its data can be modified
+  if (member.settings != m_settings) {
+    member.solver->setUseWarmStart(m_useWarmStart);
+    member.solver->setMaximumIterations(m_maxIter);
+    member.settings = m_settings;
+  }
+  const double remaining =
+      std::chrono::duration<double>(deadline - Clock::now()).count();
+  member.solver->setMaximumTime(std::max(remaining, 0.0));
+  copyProblemData(member, problemData);
+  member.request = m_request;
+  member.state = Member::REQUESTED;
+  m_requestCondition.notify_all();
+  return true;
+}
+
+bool SolverHQPPortfolio::waitFor(std::unique_lock<std::mutex>& lock,
+                                 const Member& member,
+                                 Clock::time_point deadline) {
+  return m_doneCondition.wait_until(lock, deadline, [&] {
+    return member.state == Member::DONE && member.request == m_request;
+  });
+}
+
+bool SolverHQPPortfolio::isUsable(const Member& member,
+                                  const HQPStackedLevel& level0,
+                                  bool optimalOnly) const {
+  if (member.state != Member::DONE || member.request != m_request)
+    return false;
+  const HQPOutput& output = member.output;
+  if (output.status == HQP_STATUS_OPTIMAL) return true;
+  return !optimalOnly && output.status != HQP_STATUS_ERROR && output.x.size() == level0.CE.cols() &&
+         output.x.allFinite() &&
+         maxConstraintViolation(level0, output.x) <= FEASIBILITY_TOLERANCE;
+}
+
+void SolverHQPPortfolio::useOutput(unsigned int i) {
+  m_xPrevious.swap(m_output.x);
+  m_output = m_members[i]->output;
+  m_objValue = m_members[i]->objValue;
+  m_solverIndex = static_cast<int>(i);
+}
+
+void SolverHQPPortfolio::extrapolate() {
+  m_solverIndex = -1;
+  m_objValue = 0.0;
+  m_output.iterations = 0;
+  if (m_previousSolutions == 0) {
+    m_output.status = HQP_STATUS_ERROR;
+    return;
+  }
+
+  m_output.status = HQP_STATUS_MAX_ITER_REACHED;
+  if (m_previousSolutions == 1) {
+    m_xPrevious = m_output.x;
+  } else {
+    // x = x_{k-1} + (x_{k-1} - x_{k-2})
+    m_xPrevious = 2.0 * m_output.x - m_xPrevious;
+    m_xPrevious.swap(m_output.x);
+  }
+}
+
+const HQPOutput& SolverHQPPortfolio::solve(const HQPStackedData& problemData) {
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(m_maxTime));
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(m_members.size() > 0,
+                                 "The portfolio does not contain any solver");
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_request++;
+  m_deadlineReached = false;
+  const unsigned int nSolvers = static_cast<unsigned int>(m_members.size());
+  int solverIndex = -1;
+
+  if (m_mode == PORTFOLIO_MODE_FALLBACK) {
+    for (unsigned int i = 0; i < nSolvers && solverIndex < 0; i++) {
+      if (Clock::now() >= deadline) {
+        m_deadlineReached = true;
+        break;
+      }
+      // a solver still running past a previous deadline is skipped
+      if (!start(*m_members[i], problemData, deadline)) continue;
+      if (!waitFor(lock, *m_members[i], deadline)) {
+        m_deadlineReached = true;
+        break;
+      }
+      if (isUsable(*m_members[i], level0, true))
+        solverIndex = static_cast<int>(i);
+    }
+  } else {
+    for (unsigned int i = 0; i < nSolvers; i++)
+      start(*m_members[i], problemData, deadline);
+    // wait for the first optimal solution, or until all the solvers are done
+    const bool done = m_doneCondition.wait_until(lock, deadline, [&] {
+      bool allDone = true;
+      for (unsigned int i = 0; i < nSolvers; i++) {
+        if (isUsable(*m_members[i], level0, true)) {
+          solverIndex = static_cast<int>(i);
+          return true;
+        }
+        allDone = allDone && (m_members[i]->state == Member::DONE ||
+                              m_members[i]->state == Member::IDLE);
+      }
+      return allDone;
+    });
+    m_deadlineReached = !done;
+  }
+
+  // otherwise the first solver that stopped at a feasible point is used
+  for (unsigned int i = 0; i < nSolvers && solverIndex < 0; i++)
+    if (isUsable(*m_members[i], level0, false))
+      solverIndex = static_cast<int>(i);
+
+  if (solverIndex >= 0) {
+    useOutput(static_cast<unsigned int>(solverIndex));
+  } else {
+#ifndef NDEBUG
+    sendMsg(m_deadlineReached ? "Deadline reached, extrapolating the solution"
+                              : "No solver succeeded, extrapolating the "
+                                "solution");
+#endif
+    extrapolate();
+  }
+  lock.unlock();
+
+  if (m_output.status != HQP_STATUS_ERROR)
+    m_previousSolutions = std::min(m_previousSolutions + 1, 2u);
+  return m_output;
+}
+
+double SolverHQPPortfolio::getObjectiveValue() { return m_objValue; }
+
+void SolverHQPPortfolio::setUseWarmStart(bool useWarmStart) {
+  SolverHQPBase::setUseWarmStart(useWarmStart);
+  // the solvers are updated when they are started, as they may be running
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_settings++;
+}
+
+bool SolverHQPPortfolio::setMaximumIterations(unsigned int maxIter) {
+  if (!SolverHQPBase::setMaximumIterations(maxIter)) return false;
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_settings++;
+  return true;
+}
+}  // namespace solvers
+}  // namespace tsid
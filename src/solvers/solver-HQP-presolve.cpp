@@ -0,0 +1,476 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-presolve.hpp"
+#include "tsid/solvers/utils.hpp"
+#include "tsid/math/utils.hpp"
+#include "tsid/math/constraint-equality.hpp"
+#include "tsid/math/constraint-inequality.hpp"
+
+#include <pinocchio/macros.hpp>
+
+#include <algorithm>
+
+namespace tsid {
+namespace solvers {
+
+namespace {
+// Tolerance on the residual of the level-0 equalities, relative to ce
+const double EQUALITY_TOLERANCE = 1e-6;
+
+// New constraint with the name and the type of the rows of block, for the
+// blocks whose rows are not those of the original constraint
+std::shared_ptr<math::ConstraintBase> copyConstraintType(
+    const HQPStackedBlock& block) {
+  if (block.isEquality)
+    return std::make_shared<math::ConstraintEquality>(
+        block.constraint->name());
+  return std::make_shared<math::ConstraintInequality>(
+      block.constraint->name());
+}
+}  // namespace
+
+using namespace math;
+SolverHQPPresolve::SolverHQPPresolve(const std::string& name,
+                                     SolverHQPBase* solver)
+    : SolverHQPStage("SolverHQPPresolve", name, solver),
+      m_eliminateEqualities(true),
+      m_nullSpaceValid(false),
+      m_rankThreshold(1e-8),
+      m_objOffset(0.0) {}
+
+void SolverHQPPresolve::resizeStage(unsigned int n, unsigned int /*neq*/,
+                                    unsigned int /*nin*/) {
+  if (n != m_n) {
+    m_nullSpaceValid = false;
+    m_selectionBlocks.clear();
+  }
+}
+
+void SolverHQPPresolve::setEliminateEqualities(bool eliminate) {
+  m_eliminateEqualities = eliminate;
+  m_blockSources.clear();
+}
+
+bool SolverHQPPresolve::updateRowSelection(const HQPStackedLevel& level0,
+                                           bool force) {
+  bool valid = !force && m_selectionBlocks.size() == level0.blocks.size();
+  for (std::size_t j = 0; valid && j < level0.blocks.size(); j++) {
+    const HQPStackedBlock& a = m_selectionBlocks[j];
+    const HQPStackedBlock& b = level0.blocks[j];
+    valid = a.constraint == b.constraint && a.isEquality == b.isEquality &&
+            a.row == b.row && a.rows == b.rows;
+  }
+  for (std::size_t j = 0; valid && j < m_duplicates.size(); j++) {
+    const Duplicate& d = m_duplicates[j];
+    const auto ci = level0.CI.row(d.row);
+    valid = (ci - d.scale * level0.CI.row(m_inequalityRows(d.kept)))
+                .squaredNorm() <=
+            m_rankThreshold * m_rankThreshold * ci.squaredNorm();
+  }
+  if (valid) return false;
+
+  m_selectionBlocks = level0.blocks;
+  m_nullSpaceValid = false;
+
+  // The independent equalities are the first columns of CE^T selected by the
+  // pivoting of its QR decomposition
+  if (level0.CE.rows() > 0) {
+    m_qr.setThreshold(m_rankThreshold);
+    m_qr.compute(level0.CE.transpose());
+    m_equalityRows = m_qr.colsPermutation().indices().head(m_qr.rank());
+    std::sort(m_equalityRows.data(),
+              m_equalityRows.data() + m_equalityRows.size());
+  } else {
+    m_equalityRows.resize(0);
+  }
+
+  // An inequality is merged in the first row it is a positive multiple of
+  const Eigen::Index nin = level0.CI.rows();
+  std::vector<int> kept;
+  m_duplicates.clear();
+  for (Eigen::Index i = 0; i < nin; i++) {
+    const auto ci = level0.CI.row(i);
+    const double ni = ci.squaredNorm();
+    bool duplicate = false;
+    for (std::size_t k = 0; ni > 0.0 && k < kept.size(); k++) {
+      const auto ck = level0.CI.row(kept[k]);
+      const double nk = ck.squaredNorm();
+      const double scale = nk > 0.0 ? ci.dot(ck) / nk : 0.0;
+      if (scale > 0.0 && (ci - scale * ck).squaredNorm() <=
+                             m_rankThreshold * m_rankThreshold * ni) {
+        const Duplicate d = {static_cast<unsigned int>(i),
+                             static_cast<unsigned int>(k), scale};
+        m_duplicates.push_back(d);
+        duplicate = true;
+        break;
+      }
+    }
+    if (!duplicate) kept.push_back(static_cast<int>(i));
+  }
+  m_inequalityRows =
+      Eigen::Map<const VectorXi>(kept.data(), static_cast<Eigen::Index>(kept.size()));
+
+#ifndef NDEBUG
+  if (m_equalityRows.size() < level0.CE.rows() || !m_duplicates.empty())
+    sendMsg("Removing " + toString(level0.CE.rows() - m_equalityRows.size()) +
+            " redundant equalities and " + toString(m_duplicates.size()) +
+            " duplicate inequalities");
+#endif
+
+  // Blocks of the kept rows. The blocks whose rows are not all kept get new
+  // constraints, since their rows differ from those of the original ones.
+  m_level0.resize(static_cast<unsigned int>(level0.CE.cols()),
+                  static_cast<unsigned int>(m_equalityRows.size()),
+                  static_cast<unsigned int>(m_inequalityRows.size()));
+  m_level0.blocks.clear();
+  m_level0Blocks.clear();
+  m_level0Versions.clear();
+  m_lowerSides.resize(m_inequalityRows.size());
+  m_upperSides.resize(m_inequalityRows.size());
+  for (std::size_t j = 0; j < level0.blocks.size(); j++) {
+    const HQPStackedBlock& b = level0.blocks[j];
+    const VectorXi& rows = b.isEquality ? m_equalityRows : m_inequalityRows;
+    const int* begin = std::lower_bound(rows.data(), rows.data() + rows.size(),
+                                        static_cast<int>(b.row));
+    const int* end = std::lower_bound(begin, rows.data() + rows.size(),
+                                      static_cast<int>(b.row + b.rows));
+    const unsigned int first = static_cast<unsigned int>(begin - rows.data());
+    const unsigned int count = static_cast<unsigned int>(end - begin);
+    if (count == 0) continue;
+
+    if (!b.isEquality) {
+      for (unsigned int k = first; k < first + count; k++) {
+        const int i = rows(k) - static_cast<int>(b.row);
+        m_lowerSides(k) = static_cast<int>(2 * b.row) + i;
+        m_upperSides(k) = static_cast<int>(2 * b.row + b.rows) + i;
+      }
+    }
+    m_level0.blocks.push_back(HQPStackedBlock(
+        b.weight, count == b.rows ? b.constraint : copyConstraintType(b),
+        b.isEquality, first, count, b.col, b.cols));
+    m_level0Blocks.push_back(j);
+    m_level0Versions.push_back(0);
+  }
+  return true;
+}
+
+void SolverHQPPresolve::updateLevel0(const HQPStackedLevel& level0) {
+  for (std::size_t j = 0; j < m_level0.blocks.size(); j++) {
+    const HQPStackedBlock& source = level0.blocks[m_level0Blocks[j]];
+    HQPStackedBlock& b = m_level0.blocks[j];
+    b.weight = source.weight;
+    const bool copyMatrix =
+        source.matrixVersion == 0 || source.matrixVersion != m_level0Versions[j];
+    m_level0Versions[j] = source.matrixVersion;
+    if (b.constraint == source.constraint) {
+      b.matrixVersion = source.matrixVersion;
+    } else if (copyMatrix) {
+      b.constraint->markMatrixChanged();
+      b.matrixVersion = b.constraint->matrixVersion();
+    }
+
+    for (unsigned int k = b.row; k < b.row + b.rows; k++) {
+      if (b.isEquality) {
+        const int i = m_equalityRows(k);
+        if (copyMatrix) m_level0.CE.row(k) = level0.CE.row(i);
+        m_level0.ce(k) = level0.ce(i);
+      } else {
+        const int i = m_inequalityRows(k);
+        if (copyMatrix) m_level0.CI.row(k) = level0.CI.row(i);
+        m_level0.ci_lb(k) = level0.ci_lb(i);
+        m_level0.ci_ub(k) = level0.ci_ub(i);
+      }
+    }
+  }
+
+  // CI.row(d.row) x >= lb is equivalent to CI.row(kept) x >= lb / d.scale
+  for (std::vector<Duplicate>::const_iterator d = m_duplicates.begin();
+       d != m_duplicates.end(); d++) {
+    if (level0.ci_lb(d->row) > -INFINITE_BOUND)
+      m_level0.ci_lb(d->kept) =
+          std::max(m_level0.ci_lb(d->kept), level0.ci_lb(d->row) / d->scale);
+    if (level0.ci_ub(d->row) < INFINITE_BOUND)
+      m_level0.ci_ub(d->kept) =
+          std::min(m_level0.ci_ub(d->kept), level0.ci_ub(d->row) / d->scale);
+  }
+}
+
+void SolverHQPPresolve::updateNullSpace(const HQPStackedLevel& level0) {
+  // The null space of CE is spanned by the last columns of Q, where
+  // CE^T P = Q R
+  m_qr.setThreshold(m_rankThreshold);
+  m_qr.compute(level0.CE.transpose());
+  const Eigen::Index rank = m_qr.rank();
+#ifndef NDEBUG
+  if (m_Z.cols() != static_cast<Eigen::Index>(m_n) - rank)
+    sendMsg("Size of the null space of the equalities changed from " +
+            toString(m_Z.cols()) + " to " + toString(m_n - rank));
+#endif
+  // Q is not formed: Z = Q [0; I] is obtained by applying the Householder
+  // reflections of Q to the last columns of the identity
+  m_Z.setZero(m_n, m_n - rank);
+  m_Z.bottomRows(m_n - rank).setIdentity();
+  m_Z.applyOnTheLeft(m_qr.householderQ());
+  m_nullSpaceValid = true;
+}
+
+void SolverHQPPresolve::updateParticularSolution(
+    const HQPStackedLevel& level0) {
+  // With x0 = Q y, CE x0 = ce gives R^T y = P^T ce
+  const Eigen::Index rank = m_qr.rank();
+  m_y.noalias() = m_qr.colsPermutation().transpose() * level0.ce;
+  m_qr.matrixR()
+      .topLeftCorner(rank, rank)
+      .triangularView<Eigen::Upper>()
+      .transpose()
+      .solveInPlace(m_y.head(rank));
+  m_x0.setZero(m_n);
+  m_x0.head(rank) = m_y.head(rank);
+  m_x0.applyOnTheLeft(m_qr.householderQ());
+}
+
+void SolverHQPPresolve::updateReducedData(const HQPStackedData& problemData,
+                                          bool nullSpaceChanged) {
+  const unsigned int nz = static_cast<unsigned int>(m_Z.cols());
+  if (m_reducedData.size() != problemData.size())
+    m_reducedData.resize(problemData.size());
+  if (m_blockSources.size() != problemData.size())
+    m_blockSources.resize(problemData.size());
+
+  m_objOffset = 0.0;
+  for (std::size_t k = 0; k < problemData.size(); k++) {
+    const HQPStackedLevel& level = k == 0 ? m_level0 : problemData[k];
+    HQPStackedLevel& reduced = m_reducedData[k];
+    std::vector<BlockSource>& sources = m_blockSources[k];
+
+    // The equalities of level 0 are eliminated, the other rows are kept
+    const Eigen::Index neq = k == 0 ? 0 : level.CE.rows();
+    if (reduced.CE.rows() != neq || reduced.CE.cols() != nz ||
+        reduced.CI.rows() != level.CI.rows()) {
+      reduced.resize(nz, static_cast<unsigned int>(neq),
+                     static_cast<unsigned int>(level.CI.rows()));
+      sources.clear();
+    }
+
+    std::size_t j = 0;
+    for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+         it != level.blocks.end(); it++) {
+      if (k == 0 && it->isEquality) continue;
+
+      // The reduced blocks are dense, so they get new constraints holding
+      // only the name and the type of the original ones
+      if (j >= sources.size() || j >= reduced.blocks.size() ||
+          sources[j].constraint != it->constraint.get() ||
+          reduced.blocks[j].isEquality != it->isEquality ||
+          reduced.blocks[j].row != it->row ||
+          reduced.blocks[j].rows != it->rows) {
+        reduced.blocks.erase(
+            reduced.blocks.begin() + std::min(j, reduced.blocks.size()),
+            reduced.blocks.end());
+        sources.erase(sources.begin() + std::min(j, sources.size()),
+                      sources.end());
+        reduced.blocks.push_back(HQPStackedBlock(it->weight,
+                                                 copyConstraintType(*it),
+                                                 it->isEquality, it->row,
+                                                 it->rows, 0, nz));
+        const BlockSource source = {it->constraint.get(), 0};
+        sources.push_back(source);
+      }
+
+      HQPStackedBlock& b = reduced.blocks[j];
+      BlockSource& source = sources[j];
+      b.weight = it->weight;
+      const bool project = nullSpaceChanged || it->matrixVersion == 0 ||
+                           it->matrixVersion != source.matrixVersion;
+      const auto Z = m_Z.middleRows(it->col, it->cols);
+      const auto x0 = m_x0.segment(it->col, it->cols);
+
+      if (it->isEquality) {
+        const auto A = level.CE.block(it->row, it->col, it->rows, it->cols);
+        if (project) reduced.CE.middleRows(it->row, it->rows).noalias() = A * Z;
+        auto r = reduced.ce.segment(it->row, it->rows);
+        r = level.ce.segment(it->row, it->rows);
+        r.noalias() -= A * x0;
+        // 0.5 |A x - b|^2 - 0.5 |b|^2, i.e. the cost minimized at level 1,
+        // differs by this constant when expressed in u
+        if (k == 1)
+          m_objOffset +=
+              0.5 * it->weight *
+              (r.squaredNorm() -
+               level.ce.segment(it->row, it->rows).squaredNorm());
+      } else {
+        const auto A = level.CI.block(it->row, it->col, it->rows, it->cols);
+        if (project) reduced.CI.middleRows(it->row, it->rows).noalias() = A * Z;
+        for (unsigned int i = it->row; i < it->row + it->rows; i++) {
+          const double Ax0 = A.row(i - it->row).dot(x0);
+          reduced.ci_lb(i) = level.ci_lb(i) > -INFINITE_BOUND
+                                 ? level.ci_lb(i) - Ax0
+                                 : level.ci_lb(i);
+          reduced.ci_ub(i) = level.ci_ub(i) < INFINITE_BOUND
+                                 ? level.ci_ub(i) - Ax0
+                                 : level.ci_ub(i);
+        }
+      }
+
+      if (project) {
+        source.matrixVersion = it->matrixVersion;
+        b.constraint->markMatrixChanged();
+        b.matrixVersion = b.constraint->matrixVersion();
+      }
+      j++;
+    }
+    reduced.blocks.erase(reduced.blocks.begin() + j, reduced.blocks.end());
+    sources.erase(sources.begin() + j, sources.end());
+  }
+}
+
+void SolverHQPPresolve::updateOutputActiveSet(const VectorXi& activeSet) {
+  m_output.activeSet.resize(activeSet.size());
+  for (Eigen::Index k = 0; k < activeSet.size(); k++) {
+    unsigned int row;
+    bool lower;
+    PINOCCHIO_CHECK_INPUT_ARGUMENT(
+        findInequalitySide(m_level0, activeSet(k), row, lower),
+        "The active set of the wrapped solver is not in the layout with "
+        "both sides of every inequality");
+    m_output.activeSet(k) = lower ? m_lowerSides(row) : m_upperSides(row);
+  }
+}
+
+void SolverHQPPresolve::updateMultipliers(const HQPStackedData& problemData) {
+  m_output.lambda.setZero();
+  m_stationarity.qr.setThreshold(m_rankThreshold);
+  if (!computeStationarityMultipliers(problemData, m_level0.CE,
+                                      m_output.activeSet, m_output.x,
+                                      m_stationarity))
+    return;
+
+  const Vector& multipliers = m_stationarity.multipliers;
+  const Eigen::Index neq = m_level0.CE.rows();
+  for (Eigen::Index i = 0; i < neq; i++)
+    m_output.lambda(m_equalityRows(i)) = multipliers(i);
+  for (Eigen::Index k = 0; k < m_output.activeSet.size(); k++)
+    m_output.lambda(m_neq + m_output.activeSet(k)) = multipliers(neq + k);
+}
+
+void SolverHQPPresolve::solveReduced(const HQPStackedData& problemData) {
+  Vector& x = m_output.x;
+  m_output.activeSet.resize(0);
+  m_output.iterations = 0;
+
+  // Only the redundant rows are removed
+  if (!m_eliminateEqualities || m_level0.CE.rows() == 0) {
+    m_blockSources.clear();
+    if (m_reducedData.size() != problemData.size())
+      m_reducedData.resize(problemData.size());
+    m_reducedData[0] = m_level0;
+    for (std::size_t k = 1; k < problemData.size(); k++)
+      m_reducedData[k] = problemData[k];
+
+    const HQPOutput& output = m_solver->solve(m_reducedData);
+    m_output.status = output.status;
+    m_output.iterations = output.iterations;
+    if (output.status != HQP_STATUS_OPTIMAL) return;
+    x = output.x;
+    updateOutputActiveSet(output.activeSet);
+    m_objValue = m_solver->getObjectiveValue();
+    updateMultipliers(problemData);
+    return;
+  }
+
+  bool equalitiesChanged, inequalitiesChanged;
+  compareMatrixVersions(m_level0, m_matrixVersions, equalitiesChanged,
+                        inequalitiesChanged);
+  const bool nullSpaceChanged = equalitiesChanged || !m_nullSpaceValid;
+  if (nullSpaceChanged) updateNullSpace(m_level0);
+  updateParticularSolution(m_level0);
+
+  x = m_x0;
+  if ((m_level0.CE * x - m_level0.ce).norm() >
+      EQUALITY_TOLERANCE * (1.0 + m_level0.ce.norm())) {
+    m_output.status = HQP_STATUS_INFEASIBLE;
+    return;
+  }
+
+  updateReducedData(problemData, nullSpaceChanged);
+
+  if (m_Z.cols() == 0) {
+    // x is fully determined by the equalities
+    const HQPStackedLevel& level0 = problemData[0];
+    m_output.status = HQP_STATUS_OPTIMAL;
+    if (m_nin > 0 && ((level0.CI * x - level0.ci_lb).minCoeff() < -1e-6 ||
+                      (level0.ci_ub - level0.CI * x).minCoeff() < -1e-6))
+      m_output.status = HQP_STATUS_INFEASIBLE;
+    m_objValue = m_objOffset;
+  } else {
+    const HQPOutput& output = m_solver->solve(m_reducedData);
+    m_output.status = output.status;
+    m_output.iterations = output.iterations;
+    if (output.status != HQP_STATUS_OPTIMAL) return;
+    x.noalias() += m_Z * output.x;
+    updateOutputActiveSet(output.activeSet);
+    m_objValue = m_solver->getObjectiveValue() + m_objOffset;
+  }
+  updateMultipliers(problemData);
+}
+
+bool SolverHQPPresolve::equalitiesSatisfied(
+    const HQPStackedLevel& level0) const {
+  return m_neq == 0 || (level0.CE * m_output.x - level0.ce).norm() <=
+                           EQUALITY_TOLERANCE * (1.0 + level0.ce.norm());
+}
+
+const HQPOutput& SolverHQPPresolve::solve(const HQPStackedData& problemData) {
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  const bool selectionChanged = updateRowSelection(level0, false);
+  updateLevel0(level0);
+  solveReduced(problemData);
+
+  // With the selection of a previous call, the removed equalities may no
+  // longer be implied by the kept ones, or the kept ones may have become
+  // dependent (e.g. in a singular configuration)
+  if (!selectionChanged &&
+      (m_output.status == HQP_STATUS_ERROR ||
+       (m_output.status == HQP_STATUS_OPTIMAL &&
+        !equalitiesSatisfied(level0)))) {
+#ifndef NDEBUG
+    sendMsg("The redundant rows changed, solving again");
+#endif
+    updateRowSelection(level0, true);
+    updateLevel0(level0);
+    solveReduced(problemData);
+  }
+  if (m_output.status == HQP_STATUS_OPTIMAL && !equalitiesSatisfied(level0))
+    m_output.status = HQP_STATUS_INFEASIBLE;
+
+#ifndef NDEBUG
+  if (m_output.status == HQP_STATUS_OPTIMAL) {
+    const std::string violations =
+        constraintViolationsToString(level0, m_output.x);
+    if (!violations.empty()) sendMsg(violations);
+  }
+#endif
+
+  return m_output;
+}
+}  // namespace solvers
+}  // namespace tsid
@@ -17,6 +17,7 @@
 
 #include "tsid/solvers/solver-HQP-qpmad.hpp"
 #include "tsid/math/utils.hpp"
+#include "tsid/solvers/utils.hpp"
 #include "tsid/utils/stop-watch.hpp"
 
 #include <limits>
@@ -30,6 +31,7 @@ namespace solvers {
 
 SolverHQpmad::SolverHQpmad(const std::string& name)
     : SolverHQPBase(name),
+      m_has_bounds(false),
       m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION) {
   m_n = 0;
   m_nc = 0;
@@ -73,81 +75,45 @@ void SolverHQpmad::resize(unsigned int n, unsigned int neq, unsigned int nin) {
 }
 
 void SolverHQpmad::retrieveQPData(const HQPData& problemData,
-                                  const bool /*hessianRegularization*/) {
+                                  const bool hessianRegularization) {
+  stackHQPData(problemData, m_stackedData);
+  retrieveStackedQPData(m_stackedData, hessianRegularization);
+}
+
+void SolverHQpmad::retrieveStackedQPData(const HQPStackedData& problemData,
+                                         const bool /*hessianRegularization*/) {
   if (problemData.size() > 2) {
     PINOCCHIO_CHECK_INPUT_ARGUMENT(
         false, "Solver not implemented for more than 2 hierarchical levels.");
   }
 
-  // Compute the constraint matrix sizes
-  m_has_bounds = false;
-  unsigned int nin = 0, neq = 0;
-  const ConstraintLevel& cl0 = problemData[0];
-  if (cl0.size() > 0) {
-    const unsigned int n = cl0[0].second->cols();
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      assert(n == constr->cols());
-      if (constr->isEquality())
-        neq += constr->rows();
-      else if (constr->isInequality())
-        nin += constr->rows();
-      else if (constr->isBound())
-        m_has_bounds = true;
-    }
-    // If necessary, resize the constraint matrices
-    resize(n, neq, nin);
+  // Compute the constraint matrix sizes, bounds are handled natively by qpmad
+  const HQPStackedLevel& level0 = problemData[0];
+  const unsigned int neq = static_cast<unsigned int>(level0.CE.rows());
+  const unsigned int nin = countGeneralInequalities(level0);
+  // If necessary, resize the constraint matrices
+  resize(static_cast<unsigned int>(level0.CE.cols()), neq, nin);
 
-    if (m_has_bounds) {
-      m_lb.setConstant(std::numeric_limits<double>::min());
-      m_ub.setConstant(std::numeric_limits<double>::max());
-    }
+  m_lb.resize(m_n);
+  m_ub.resize(m_n);
+  m_has_bounds = boundsToBox(level0, m_lb, m_ub);
 
-    int i_eq_in = 0;
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      if (constr->isEquality()) {
-        m_C.middleRows(i_eq_in, constr->rows()) = constr->matrix();
-        m_cl.segment(i_eq_in, constr->rows()) = constr->vector();
-        m_cu.segment(i_eq_in, constr->rows()) = constr->vector();
-        i_eq_in += constr->rows();
-      } else if (constr->isInequality()) {
-        m_C.middleRows(i_eq_in, constr->rows()) = constr->matrix();
-        m_cl.segment(i_eq_in, constr->rows()) = constr->lowerBound();
-        m_cu.segment(i_eq_in, constr->rows()) = constr->upperBound();
-        i_eq_in += constr->rows();
-      } else if (constr->isBound()) {
-        // not considering masks
-        m_lb = m_lb.cwiseMax(constr->lowerBound());
-        m_ub = m_ub.cwiseMin(constr->upperBound());
-      }
-    }
-  } else
-    resize(m_n, neq, nin);
+  m_C.topRows(neq) = level0.CE;
+  m_cl.head(neq) = level0.ce;
+  m_cu.head(neq) = level0.ce;
+  generalInequalities(level0, m_C.bottomRows(nin), m_cl.tail(nin),
+                      m_cu.tail(nin));
 
   if (problemData.size() > 1) {
-    const ConstraintLevel& cl1 = problemData[1];
     m_H.setZero();
     m_g.setZero();
-    for (ConstraintLevel::const_iterator it = cl1.begin(); it != cl1.end();
-         it++) {
-      const double& w = it->first;
-      auto constr = it->second;
-      if (!constr->isEquality())
-        PINOCCHIO_CHECK_INPUT_ARGUMENT(
-            false, "Inequalities in the cost function are not implemented yet");
-
-      m_H.noalias() += w * constr->matrix().transpose() * constr->matrix();
-      m_g.noalias() -= w * (constr->matrix().transpose() * constr->vector());
-    }
+    addLeastSquaresCost(problemData[1], m_costCache, m_H, m_g);
     m_H.diagonal().array() += m_hessian_regularization;
   }
 }
 
-const HQPOutput& SolverHQpmad::solve(const HQPData& problemData) {
-  SolverHQpmad::retrieveQPData(problemData);
+const HQPOutput& SolverHQpmad::solve(const HQPStackedData& problemData) {
+  SolverHQpmad::retrieveStackedQPData(problemData);
 
   //  min 0.5 * x H x + g x
   //  s.t.
@@ -170,33 +136,9 @@ const HQPOutput& SolverHQpmad::solve(const HQPData& problemData) {
     m_output.status = HQP_STATUS_OPTIMAL;
 
 #ifndef NDEBUG
-    const Vector& x = m_output.x;
-
-    const ConstraintLevel& cl0 = problemData[0];
-    if (cl0.size() > 0) {
-      for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-           it++) {
-        auto constr = it->second;
-        if (constr->checkConstraint(x) == false) {
-          if (constr->isEquality()) {
-            sendMsg("Equality " + constr->name() + " violated: " +
-                    toString((constr->matrix() * x - constr->vector()).norm()));
-          } else if (constr->isInequality()) {
-            sendMsg(
-                "Inequality " + constr->name() + " violated: " +
-                toString(
-                    (constr->matrix() * x - constr->lowerBound()).minCoeff()) +
-                "\n" +
-                toString(
-                    (constr->upperBound() - constr->matrix() * x).minCoeff()));
-          } else if (constr->isBound()) {
-            sendMsg("Bound " + constr->name() + " violated: " +
-                    toString((x - constr->lowerBound()).minCoeff()) + "\n" +
-                    toString((constr->upperBound() - x).minCoeff()));
-          }
-        }
-      }
-    }
+    const std::string violations =
+        constraintViolationsToString(problemData[0], m_output.x);
+    if (!violations.empty()) sendMsg(violations);
 #endif
   }
 
@@ -0,0 +1,373 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-scaling.hpp"
+#include "tsid/solvers/utils.hpp"
+#include "tsid/math/utils.hpp"
+#include "tsid/math/constraint-bound.hpp"
+#include "tsid/math/constraint-equality.hpp"
+#include "tsid/math/constraint-inequality.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tsid {
+namespace solvers {
+
+namespace {
+// Range of the factors, so that rows or columns that are almost zero do not
+// get huge factors
+const double MIN_SCALING = 1e-4;
+const double MAX_SCALING = 1e4;
+// The equilibration stops when all the norms are 1 up to this tolerance
+const double RUIZ_TOLERANCE = 1e-2;
+// Largest scaled slack of the inequalities considered active at the solution
+const double ACTIVE_TOLERANCE = 1e-6;
+
+// New constraint with the name, the type and the size of the rows of block.
+// Its matrix is only used to store the selection matrices.
+std::shared_ptr<math::ConstraintBase> createScaledConstraint(
+    const HQPStackedBlock& block) {
+  const std::string& name = block.constraint->name();
+  if (block.isEquality)
+    return std::make_shared<math::ConstraintEquality>(name, block.rows,
+                                                      block.cols);
+  if (block.constraint->isBound())
+    return std::make_shared<math::ConstraintBound>(name, block.rows);
+  return std::make_shared<math::ConstraintInequality>(name, block.rows,
+                                                      block.cols);
+}
+
+// Divide the factors by the square root of the norms, which are left
+// unchanged where the norm is zero. Return the largest distance between a
+// nonzero norm and 1.
+double ruizStep(math::ConstRefVector norms, math::RefVector factors) {
+  double error = 0.0;
+  for (Eigen::Index i = 0; i < norms.size(); i++) {
+    if (norms(i) <= 0.0) continue;
+    error = std::max(error, std::abs(1.0 - norms(i)));
+    factors(i) = std::min(std::max(factors(i) / std::sqrt(norms(i)),
+                                   MIN_SCALING),
+                          MAX_SCALING);
+  }
+  return error;
+}
+}  // namespace
+
+using namespace math;
+SolverHQPScaling::SolverHQPScaling(const std::string& name,
+                                   SolverHQPBase* solver)
+    : SolverHQPStage("SolverHQPScaling", name, solver),
+      m_useScaling(true),
+      m_scalingIterations(10),
+      m_updatePeriod(0),
+      m_callsSinceUpdate(0),
+      m_scalingValid(false),
+      m_costScaling(1.0) {}
+
+void SolverHQPScaling::resizeStage(unsigned int /*n*/, unsigned int /*neq*/,
+                                   unsigned int /*nin*/) {
+  m_scalingValid = false;
+}
+
+void SolverHQPScaling::setUseScaling(bool useScaling) {
+  m_useScaling = useScaling;
+  m_scalingValid = false;
+}
+
+void SolverHQPScaling::setScalingIterations(unsigned int iterations) {
+  m_scalingIterations = iterations;
+  m_scalingValid = false;
+}
+
+bool SolverHQPScaling::sameLayout(const HQPStackedData& problemData) const {
+  if (m_scaledData.size() != problemData.size()) return false;
+  for (std::size_t k = 0; k < problemData.size(); k++) {
+    const HQPStackedLevel& level = problemData[k];
+    const HQPStackedLevel& scaled = m_scaledData[k];
+    const std::vector<BlockSource>& sources = m_blockSources[k];
+    if (scaled.CE.cols() != level.CE.cols() ||
+        scaled.CE.rows() != level.CE.rows() ||
+        scaled.CI.rows() != level.CI.rows() ||
+        scaled.blocks.size() != level.blocks.size())
+      return false;
+    for (std::size_t j = 0; j < level.blocks.size(); j++) {
+      const HQPStackedBlock& a = level.blocks[j];
+      const HQPStackedBlock& b = scaled.blocks[j];
+      if (sources[j].constraint != a.constraint.get() ||
+          a.isEquality != b.isEquality || a.row != b.row ||
+          a.rows != b.rows || a.col != b.col || a.cols != b.cols)
+        return false;
+    }
+  }
+  return true;
+}
+
+void SolverHQPScaling::updateLayout(const HQPStackedData& problemData) {
+  m_scaledData.resize(problemData.size());
+  m_blockSources.resize(problemData.size());
+  for (std::size_t k = 0; k < problemData.size(); k++) {
+    const HQPStackedLevel& level = problemData[k];
+    HQPStackedLevel& scaled = m_scaledData[k];
+    std::vector<BlockSource>& sources = m_blockSources[k];
+    scaled.resize(static_cast<unsigned int>(level.CE.cols()),
+                  static_cast<unsigned int>(level.CE.rows()),
+                  static_cast<unsigned int>(level.CI.rows()));
+    scaled.blocks.clear();
+    sources.clear();
+    for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+         it != level.blocks.end(); it++) {
+      scaled.blocks.push_back(HQPStackedBlock(
+          it->weight, createScaledConstraint(*it), it->isEquality, it->row,
+          it->rows, it->col, it->cols));
+      const BlockSource source = {it->constraint.get(), 0};
+      sources.push_back(source);
+    }
+  }
+}
+
+void SolverHQPScaling::updateScaling(const HQPStackedData& problemData) {
+  const HQPStackedLevel& level0 = problemData[0];
+  m_D.setOnes(m_n);
+  m_Eeq.setOnes(m_neq);
+  m_Ein.setOnes(m_nin);
+  double costFactor = 1.0;  // sqrt(c)
+
+  // The rows of the bounds are not equilibrated, their factors are set below
+  // so that their matrix stays the identity
+  for (unsigned int iter = 0; iter < m_scalingIterations; iter++) {
+    m_colNorms.setZero(m_n);
+    m_eqNorms.setZero(m_neq);
+    m_inNorms.setZero(m_nin);
+    double costNorm = 0.0;
+    for (std::size_t k = 0; k < problemData.size(); k++) {
+      const HQPStackedLevel& level = problemData[k];
+      for (std::vector<HQPStackedBlock>::const_iterator it =
+               level.blocks.begin();
+           it != level.blocks.end(); it++) {
+        if (it->rows == 0) continue;
+        const auto D = m_D.segment(it->col, it->cols).asDiagonal();
+        if (k == 0 && it->isEquality) {
+          m_M.noalias() =
+              m_Eeq.segment(it->row, it->rows).asDiagonal() *
+              level.CE.block(it->row, it->col, it->rows, it->cols) * D;
+          m_M = m_M.cwiseAbs();
+          m_eqNorms.segment(it->row, it->rows) = m_M.rowwise().maxCoeff();
+        } else if (k == 0 && !it->constraint->isBound()) {
+          m_M.noalias() =
+              m_Ein.segment(it->row, it->rows).asDiagonal() *
+              level.CI.block(it->row, it->col, it->rows, it->cols) * D;
+          m_M = m_M.cwiseAbs();
+          m_inNorms.segment(it->row, it->rows) = m_M.rowwise().maxCoeff();
+        } else if (k > 0 && it->isEquality) {
+          m_M.noalias() =
+              level.CE.block(it->row, it->col, it->rows, it->cols) * D;
+          m_M = (costFactor * std::sqrt(it->weight)) * m_M.cwiseAbs();
+          costNorm = std::max(costNorm, m_M.maxCoeff());
+        } else {
+          continue;
+        }
+        m_colNorms.segment(it->col, it->cols) =
+            m_colNorms.segment(it->col, it->cols).cwiseMax(
+                m_M.colwise().maxCoeff().transpose());
+      }
+    }
+
+    double error = ruizStep(m_colNorms, m_D);
+    error = std::max(error, ruizStep(m_eqNorms, m_Eeq));
+    error = std::max(error, ruizStep(m_inNorms, m_Ein));
+    if (costNorm > 0.0)
+      costFactor = std::min(
+          std::max(costFactor / std::sqrt(costNorm), MIN_SCALING),
+          MAX_SCALING);
+    if (error < RUIZ_TOLERANCE) break;
+  }
+
+  // Each row of a bound is divided by the factor of its variable
+  for (std::vector<HQPStackedBlock>::const_iterator it =
+           level0.blocks.begin();
+       it != level0.blocks.end(); it++) {
+    if (it->isEquality || !it->constraint->isBound() || it->rows == 0)
+      continue;
+    m_M.noalias() = level0.CI.block(it->row, it->col, it->rows, it->cols) *
+                    m_D.segment(it->col, it->cols).asDiagonal();
+    for (unsigned int i = 0; i < it->rows; i++) {
+      const double norm = m_M.row(i).cwiseAbs().maxCoeff();
+      if (norm > 0.0) m_Ein(it->row + i) = 1.0 / norm;
+    }
+  }
+
+  m_costScaling = costFactor * costFactor;
+  m_scalingValid = true;
+  m_callsSinceUpdate = 0;
+}
+
+void SolverHQPScaling::updateScaledData(const HQPStackedData& problemData,
+                                        bool scalingChanged) {
+  for (std::size_t k = 0; k < problemData.size(); k++) {
+    const HQPStackedLevel& level = problemData[k];
+    HQPStackedLevel& scaled = m_scaledData[k];
+    std::vector<BlockSource>& sources = m_blockSources[k];
+
+    for (std::size_t j = 0; j < level.blocks.size(); j++) {
+      const HQPStackedBlock& src = level.blocks[j];
+      HQPStackedBlock& b = scaled.blocks[j];
+      BlockSource& source = sources[j];
+      b.weight = k == 0 ? src.weight : m_costScaling * src.weight;
+
+      const bool scale = scalingChanged || src.matrixVersion == 0 ||
+                         src.matrixVersion != source.matrixVersion;
+      const auto D = m_D.segment(src.col, src.cols).asDiagonal();
+      // The rows of the costs are not scaled, c is applied to their weight
+      const Vector& rowFactors = src.isEquality ? m_Eeq : m_Ein;
+      const bool scaleRows = k == 0;
+
+      if (src.isEquality) {
+        const auto A = level.CE.block(src.row, src.col, src.rows, src.cols);
+        auto As = scaled.CE.block(src.row, src.col, src.rows, src.cols);
+        if (scale && scaleRows)
+          As.noalias() =
+              rowFactors.segment(src.row, src.rows).asDiagonal() * A * D;
+        else if (scale)
+          As.noalias() = A * D;
+        if (scaleRows)
+          scaled.ce.segment(src.row, src.rows) =
+              rowFactors.segment(src.row, src.rows)
+                  .cwiseProduct(level.ce.segment(src.row, src.rows));
+        else
+          scaled.ce.segment(src.row, src.rows) =
+              level.ce.segment(src.row, src.rows);
+      } else {
+        const auto A = level.CI.block(src.row, src.col, src.rows, src.cols);
+        auto As = scaled.CI.block(src.row, src.col, src.rows, src.cols);
+        if (scale && scaleRows)
+          As.noalias() =
+              rowFactors.segment(src.row, src.rows).asDiagonal() * A * D;
+        else if (scale)
+          As.noalias() = A * D;
+        for (unsigned int i = src.row; i < src.row + src.rows; i++) {
+          const double e = scaleRows ? rowFactors(i) : 1.0;
+          scaled.ci_lb(i) = level.ci_lb(i) > -INFINITE_BOUND
+                                ? e * level.ci_lb(i)
+                                : level.ci_lb(i);
+          scaled.ci_ub(i) = level.ci_ub(i) < INFINITE_BOUND
+                                ? e * level.ci_ub(i)
+                                : level.ci_ub(i);
+        }
+      }
+
+      if (!scale) continue;
+      // The scaled matrix keeps the structure of the original one
+      const ConstraintBase& c = *src.constraint;
+      ConstraintBase& cs = *b.constraint;
+      cs.setColumnSupport(c.columnSupport());
+      if (c.matrixStructure() != CONSTRAINT_MATRIX_DENSE) {
+        const VectorXi& cols = c.selectedColumns();
+        m_weights = c.selectionWeights();
+        for (Eigen::Index i = 0; i < cols.size(); i++) {
+          m_weights(i) *= m_D(src.col + cols(i));
+          if (scaleRows) m_weights(i) *= rowFactors(src.row + i);
+        }
+        cs.setSelectionMatrix(cols, m_weights);
+      } else if (cs.matrixStructure() != CONSTRAINT_MATRIX_DENSE) {
+        if (src.isEquality)
+          cs.setMatrix(scaled.CE.block(src.row, src.col, src.rows, src.cols));
+        else
+          cs.setMatrix(scaled.CI.block(src.row, src.col, src.rows, src.cols));
+      }
+      cs.markMatrixChanged();
+      b.matrixVersion = cs.matrixVersion();
+      source.matrixVersion = src.matrixVersion;
+    }
+  }
+}
+
+void SolverHQPScaling::unscaleOutput(const HQPOutput& output) {
+  m_output.status = output.status;
+  m_output.iterations = output.iterations;
+  m_output.activeSet = output.activeSet;
+  m_output.x = m_D.cwiseProduct(output.x);
+  m_objValue = m_solver->getObjectiveValue() / m_costScaling;
+}
+
+void SolverHQPScaling::updateMultipliers(const HQPStackedData& problemData) {
+  const HQPStackedLevel& level0 = problemData[0];
+  const Vector& x = m_output.x;
+  m_output.lambda.setZero();
+
+  // Only the inequalities active at x among those of the active set of the
+  // wrapped solver are used
+  const VectorXi& activeSet = m_output.activeSet;
+  m_activeSides.resize(activeSet.size());
+  Eigen::Index na = 0;
+  for (Eigen::Index k = 0; k < activeSet.size(); k++) {
+    unsigned int row;
+    bool lower;
+    if (!findInequalitySide(level0, activeSet(k), row, lower)) continue;
+    const double CIx = level0.CI.row(row).dot(x);
+    const double slack =
+        lower ? CIx - level0.ci_lb(row) : level0.ci_ub(row) - CIx;
+    if (m_Ein(row) * std::abs(slack) > ACTIVE_TOLERANCE) continue;
+    m_activeSides(na++) = activeSet(k);
+  }
+  if (!computeStationarityMultipliers(problemData, level0.CE,
+                                      m_activeSides.head(na), x,
+                                      m_stationarity))
+    return;
+
+  const Vector& multipliers = m_stationarity.multipliers;
+  m_output.lambda.head(m_neq) = multipliers.head(m_neq);
+  for (Eigen::Index k = 0; k < na; k++)
+    m_output.lambda(m_neq + m_activeSides(k)) = multipliers(m_neq + k);
+}
+
+const HQPOutput& SolverHQPScaling::solve(const HQPStackedData& problemData) {
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  if (!m_useScaling) {
+    m_output = m_solver->solve(problemData);
+    m_objValue = m_solver->getObjectiveValue();
+    return m_output;
+  }
+
+  const bool layoutChanged = !sameLayout(problemData);
+  if (layoutChanged) updateLayout(problemData);
+  m_callsSinceUpdate++;
+  const bool scalingChanged =
+      layoutChanged || !m_scalingValid ||
+      (m_updatePeriod > 0 && m_callsSinceUpdate >= m_updatePeriod);
+  if (scalingChanged) updateScaling(problemData);
+  updateScaledData(problemData, scalingChanged);
+
+  unscaleOutput(m_solver->solve(m_scaledData));
+  if (m_output.status == HQP_STATUS_OPTIMAL) updateMultipliers(problemData);
+
+#ifndef NDEBUG
+  if (m_output.status == HQP_STATUS_OPTIMAL) {
+    const std::string violations =
+        constraintViolationsToString(level0, m_output.x);
+    if (!violations.empty()) sendMsg(violations);
+  }
+#endif
+
+  return m_output;
+}
+}  // namespace solvers
+}  // namespace tsid
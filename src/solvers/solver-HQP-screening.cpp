@@ -0,0 +1,204 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-screening.hpp"
+#include "tsid/solvers/utils.hpp"
+#include "tsid/math/utils.hpp"
+
+namespace tsid {
+namespace solvers {
+
+namespace {
+// Largest violation of a dropped side accepted at the solution
+const double VIOLATION_TOLERANCE = 1e-6;
+
+bool sameLayout(const HQPStackedLevel& a, const HQPStackedLevel& b) {
+  return a.CE.cols() == b.CE.cols() && a.CE.rows() == b.CE.rows() &&
+         a.CI.rows() == b.CI.rows() && sameBlockLayout(a.blocks, b.blocks);
+}
+}  // namespace
+
+using namespace math;
+SolverHQPScreening::SolverHQPScreening(const std::string& name,
+                                       SolverHQPBase* solver)
+    : SolverHQPStage("SolverHQPScreening", name, solver),
+      m_useScreening(true),
+      m_margin(1.0),
+      m_keptSidesValid(false),
+      m_droppedSides(0),
+      m_fullSolves(0) {}
+
+void SolverHQPScreening::resizeStage(unsigned int /*n*/, unsigned int /*neq*/,
+                                     unsigned int nin) {
+  m_CIx.resize(nin);
+  m_keepLower.assign(nin, true);
+  m_keepUpper.assign(nin, true);
+  m_keptSidesValid = false;
+}
+
+void SolverHQPScreening::setUseScreening(bool useScreening) {
+  m_useScreening = useScreening;
+  m_keptSidesValid = false;
+}
+
+bool SolverHQPScreening::copyProblemData(const HQPStackedData& problemData) {
+  bool layoutChanged = m_screenedData.size() != problemData.size();
+  if (layoutChanged) {
+    m_screenedData.resize(problemData.size());
+    m_matrixVersions.resize(problemData.size());
+  }
+
+  for (std::size_t k = 0; k < problemData.size(); k++) {
+    const HQPStackedLevel& level = problemData[k];
+    HQPStackedLevel& screened = m_screenedData[k];
+    std::vector<std::uint64_t>& versions = m_matrixVersions[k];
+    if (!sameLayout(level, screened)) {
+      screened = level;
+      versions.resize(level.blocks.size());
+      for (std::size_t j = 0; j < level.blocks.size(); j++)
+        versions[j] = level.blocks[j].matrixVersion;
+      layoutChanged = true;
+      continue;
+    }
+
+    // the matrices are only copied if they changed since the last call
+    for (std::size_t j = 0; j < level.blocks.size(); j++) {
+      const HQPStackedBlock& b = level.blocks[j];
+      if (b.matrixVersion == 0 || b.matrixVersion != versions[j]) {
+        if (b.isEquality)
+          screened.CE.middleRows(b.row, b.rows) =
+              level.CE.middleRows(b.row, b.rows);
+        else
+          screened.CI.middleRows(b.row, b.rows) =
+              level.CI.middleRows(b.row, b.rows);
+        versions[j] = b.matrixVersion;
+      }
+      screened.blocks[j].weight = b.weight;
+      screened.blocks[j].matrixVersion = b.matrixVersion;
+    }
+    screened.ce = level.ce;
+    screened.ci_lb = level.ci_lb;
+    screened.ci_ub = level.ci_ub;
+  }
+  return layoutChanged;
+}
+
+void SolverHQPScreening::dropSides() {
+  HQPStackedLevel& level0 = m_screenedData[0];
+  for (unsigned int i = 0; i < m_nin; i++) {
+    if (!m_keepLower[i] && level0.ci_lb(i) > -INFINITE_BOUND) {
+      level0.ci_lb(i) = -INFINITE_BOUND;
+      m_droppedSides++;
+    }
+    if (!m_keepUpper[i] && level0.ci_ub(i) < INFINITE_BOUND) {
+      level0.ci_ub(i) = INFINITE_BOUND;
+      m_droppedSides++;
+    }
+  }
+}
+
+void SolverHQPScreening::restoreBounds(const HQPStackedLevel& level0) {
+  m_screenedData[0].ci_lb = level0.ci_lb;
+  m_screenedData[0].ci_ub = level0.ci_ub;
+}
+
+bool SolverHQPScreening::droppedSidesSatisfied(
+    const HQPStackedLevel& level0) const {
+  for (unsigned int i = 0; i < m_nin; i++) {
+    if (!m_keepLower[i] && level0.ci_lb(i) > -INFINITE_BOUND &&
+        m_CIx(i) < level0.ci_lb(i) - VIOLATION_TOLERANCE)
+      return false;
+    if (!m_keepUpper[i] && level0.ci_ub(i) < INFINITE_BOUND &&
+        m_CIx(i) > level0.ci_ub(i) + VIOLATION_TOLERANCE)
+      return false;
+  }
+  return true;
+}
+
+void SolverHQPScreening::updateKeptSides(const HQPStackedLevel& level0) {
+  for (unsigned int i = 0; i < m_nin; i++) {
+    const double margin = m_margin * level0.CI.row(i).norm();
+    m_keepLower[i] = m_CIx(i) - level0.ci_lb(i) < margin;
+    m_keepUpper[i] = level0.ci_ub(i) - m_CIx(i) < margin;
+  }
+
+  // the sides of the active set are kept even if their bound moved away
+  const VectorXi& activeSet = m_output.activeSet;
+  for (Eigen::Index k = 0; k < activeSet.size(); k++) {
+    unsigned int row;
+    bool lower;
+    if (!findInequalitySide(level0, activeSet(k), row, lower)) continue;
+    if (lower)
+      m_keepLower[row] = true;
+    else
+      m_keepUpper[row] = true;
+  }
+}
+
+const HQPOutput& SolverHQPScreening::solve(const HQPStackedData& problemData) {
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  m_droppedSides = 0;
+  if (!m_useScreening) {
+    m_output = m_solver->solve(problemData);
+    m_objValue = m_solver->getObjectiveValue();
+    return m_output;
+  }
+
+  if (copyProblemData(problemData)) m_keptSidesValid = false;
+  if (m_keptSidesValid) dropSides();
+
+  const HQPOutput* output = &m_solver->solve(m_screenedData);
+  int iterations = output->iterations;
+  bool CIxValid = false;
+  if (m_droppedSides > 0) {
+    bool satisfied = output->status == HQP_STATUS_OPTIMAL;
+    if (satisfied) {
+      m_CIx.noalias() = level0.CI * output->x;
+      satisfied = droppedSidesSatisfied(level0);
+      CIxValid = true;
+    }
+    if (!satisfied) {
+#ifndef NDEBUG
+      sendMsg("A dropped inequality is violated, solving again");
+#endif
+      restoreBounds(level0);
+      m_droppedSides = 0;
+      m_fullSolves++;
+      output = &m_solver->solve(m_screenedData);
+      iterations += output->iterations;
+      CIxValid = false;
+    }
+  }
+
+  m_output = *output;
+  m_output.iterations = iterations;
+  m_objValue = m_solver->getObjectiveValue();
+
+  m_keptSidesValid = m_output.status == HQP_STATUS_OPTIMAL;
+  if (m_keptSidesValid) {
+    if (!CIxValid) m_CIx.noalias() = level0.CI * m_output.x;
+    updateKeptSides(level0);
+  }
+
+  return m_output;
+}
+}  // namespace solvers
+}  // namespace tsid
@@ -0,0 +1,243 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-slack.hpp"
+#include "tsid/solvers/utils.hpp"
+#include "tsid/math/utils.hpp"
+#include "tsid/math/constraint-equality.hpp"
+#include "tsid/math/constraint-inequality.hpp"
+
+namespace tsid {
+namespace solvers {
+
+using namespace math;
+SolverHQPSlack::SolverHQPSlack(const std::string& name, SolverHQPBase* solver)
+    : SolverHQPStage("SolverHQPSlack", name, solver),
+      m_useSlacks(false),
+      m_ns(0) {}
+
+void SolverHQPSlack::resizeStage(unsigned int /*n*/, unsigned int /*neq*/,
+                                 unsigned int /*nin*/) {
+  // the augmented problem is rebuilt with the new number of variables
+  m_layout.clear();
+}
+
+bool SolverHQPSlack::layoutChanged(const HQPStackedData& problemData) const {
+  if (m_layout.size() != problemData.size()) return true;
+  for (std::size_t k = 0; k < problemData.size(); k++)
+    if (!sameBlockLayout(m_layout[k], problemData[k].blocks)) return true;
+  return false;
+}
+
+void SolverHQPSlack::buildLayout(const HQPStackedData& problemData) {
+  const std::size_t nLevels = problemData.size();
+  m_layout.resize(nLevels);
+  m_blockIndex.resize(nLevels);
+  m_softBlocks.clear();
+  m_slackConstraints.clear();
+  m_ns = 0;
+  for (std::size_t k = 0; k < nLevels; k++) {
+    const std::vector<HQPStackedBlock>& blocks = problemData[k].blocks;
+    m_layout[k] = blocks;
+    m_blockIndex[k].assign(blocks.size(), -1);
+    for (unsigned int j = 0; j < blocks.size(); j++) {
+      if (k == 0 || blocks[j].isEquality) continue;
+      SoftBlock sb;
+      sb.level = static_cast<unsigned int>(k);
+      sb.block = j;
+      sb.slack = m_ns;
+      sb.rowBlock = 0;
+      sb.costBlock = 0;
+      m_softBlocks.push_back(sb);
+      m_ns += blocks[j].rows;
+    }
+  }
+
+  m_useSlacks = m_ns > 0;
+  if (!m_useSlacks) {
+    m_slackData.clear();
+    m_slacks.resize(0);
+#ifndef NDEBUG
+    sendMsg("No inequality in the cost levels, the problem is not changed");
+#endif
+    return;
+  }
+
+#ifndef NDEBUG
+  sendMsg("Adding " + toString(m_ns) + " slack variables");
+#endif
+  const unsigned int N = m_n + m_ns;
+  m_slackData.resize(nLevels);
+  m_slacks.setZero(m_ns);
+
+  // level 0: the hard constraints, followed by the soft inequalities
+  //   lb <= A x - s <= ub
+  const HQPStackedLevel& level0 = problemData[0];
+  HQPStackedLevel& slack0 = m_slackData[0];
+  slack0.resize(N, static_cast<unsigned int>(level0.CE.rows()),
+                static_cast<unsigned int>(level0.CI.rows()) + m_ns);
+  slack0.blocks = level0.blocks;
+  for (unsigned int j = 0; j < slack0.blocks.size(); j++) {
+    slack0.blocks[j].matrixVersion = 0;
+    m_blockIndex[0][j] = static_cast<int>(j);
+  }
+  for (std::vector<SoftBlock>::iterator it = m_softBlocks.begin();
+       it != m_softBlocks.end(); it++) {
+    const HQPStackedBlock& b = problemData[it->level].blocks[it->block];
+    // the rows span the columns of the inequality and of its slack variables
+    ColumnSupport support = b.constraint->columnSupport();
+    if (support.empty()) support.push_back(ColumnRange(0, b.cols));
+    support.push_back(ColumnRange(m_n + it->slack - b.col, b.rows));
+    std::shared_ptr<ConstraintBase> c = std::make_shared<ConstraintInequality>(
+        b.constraint->name(), b.rows, N - b.col);
+    c->setColOffset(b.col);
+    c->setColumnSupport(support);
+    m_slackConstraints.push_back(c);
+
+    const unsigned int row =
+        static_cast<unsigned int>(level0.CI.rows()) + it->slack;
+    it->rowBlock = static_cast<unsigned int>(slack0.blocks.size());
+    slack0.blocks.push_back(
+        HQPStackedBlock(b.weight, c, false, row, b.rows, b.col, N - b.col));
+    slack0.CI.block(row, m_n + it->slack, b.rows, b.rows) =
+        -Matrix::Identity(b.rows, b.rows);
+  }
+
+  // cost levels: the equalities, followed by the slack costs w || s ||^2
+  for (std::size_t k = 1; k < nLevels; k++) {
+    const HQPStackedLevel& level = problemData[k];
+    HQPStackedLevel& slackLevel = m_slackData[k];
+    unsigned int neq = static_cast<unsigned int>(level.CE.rows());
+    for (std::vector<SoftBlock>::const_iterator it = m_softBlocks.begin();
+         it != m_softBlocks.end(); it++)
+      if (it->level == k) neq += level.blocks[it->block].rows;
+    slackLevel.resize(N, neq, 0);
+    slackLevel.blocks.clear();
+    for (unsigned int j = 0; j < level.blocks.size(); j++) {
+      if (!level.blocks[j].isEquality) continue;
+      m_blockIndex[k][j] = static_cast<int>(slackLevel.blocks.size());
+      slackLevel.blocks.push_back(level.blocks[j]);
+      slackLevel.blocks.back().matrixVersion = 0;
+    }
+
+    unsigned int row = static_cast<unsigned int>(level.CE.rows());
+    for (std::vector<SoftBlock>::iterator it = m_softBlocks.begin();
+         it != m_softBlocks.end(); it++) {
+      if (it->level != k) continue;
+      const HQPStackedBlock& b = level.blocks[it->block];
+      std::shared_ptr<ConstraintBase> c =
+          std::make_shared<ConstraintEquality>(b.constraint->name(), b.rows,
+                                               b.rows);
+      c->setColOffset(m_n + it->slack);
+      c->setSelectionMatrix(VectorXi::LinSpaced(b.rows, 0, b.rows - 1),
+                            Vector::Ones(b.rows));
+      m_slackConstraints.push_back(c);
+
+      it->costBlock = static_cast<unsigned int>(slackLevel.blocks.size());
+      slackLevel.blocks.push_back(HQPStackedBlock(
+          b.weight, c, true, row, b.rows, m_n + it->slack, b.rows));
+      slackLevel.blocks.back().matrixVersion = c->matrixVersion();
+      slackLevel.CE.block(row, m_n + it->slack, b.rows, b.rows).setIdentity();
+      row += b.rows;
+    }
+  }
+}
+
+void SolverHQPSlack::copyProblemData(const HQPStackedData& problemData) {
+  for (std::size_t k = 0; k < problemData.size(); k++) {
+    const HQPStackedLevel& level = problemData[k];
+    HQPStackedLevel& slackLevel = m_slackData[k];
+    for (unsigned int j = 0; j < level.blocks.size(); j++) {
+      const int i = m_blockIndex[k][j];
+      if (i < 0) continue;
+      const HQPStackedBlock& b = level.blocks[j];
+      HQPStackedBlock& sb = slackLevel.blocks[i];
+      const bool copyMatrix =
+          b.matrixVersion == 0 || b.matrixVersion != sb.matrixVersion;
+      sb.weight = b.weight;
+      sb.matrixVersion = b.matrixVersion;
+      if (b.isEquality) {
+        if (copyMatrix)
+          slackLevel.CE.block(b.row, b.col, b.rows, b.cols) =
+              level.CE.block(b.row, b.col, b.rows, b.cols);
+        slackLevel.ce.segment(b.row, b.rows) = level.ce.segment(b.row, b.rows);
+      } else {
+        if (copyMatrix)
+          slackLevel.CI.block(b.row, b.col, b.rows, b.cols) =
+              level.CI.block(b.row, b.col, b.rows, b.cols);
+        slackLevel.ci_lb.segment(b.row, b.rows) =
+            level.ci_lb.segment(b.row, b.rows);
+        slackLevel.ci_ub.segment(b.row, b.rows) =
+            level.ci_ub.segment(b.row, b.rows);
+      }
+    }
+  }
+
+  HQPStackedLevel& slack0 = m_slackData[0];
+  for (std::vector<SoftBlock>::const_iterator it = m_softBlocks.begin();
+       it != m_softBlocks.end(); it++) {
+    const HQPStackedLevel& level = problemData[it->level];
+    const HQPStackedBlock& b = level.blocks[it->block];
+    HQPStackedBlock& rb = slack0.blocks[it->rowBlock];
+    if (b.matrixVersion == 0 || b.matrixVersion != rb.matrixVersion)
+      slack0.CI.block(rb.row, b.col, b.rows, b.cols) =
+          level.CI.block(b.row, b.col, b.rows, b.cols);
+    rb.weight = b.weight;
+    rb.matrixVersion = b.matrixVersion;
+    slack0.ci_lb.segment(rb.row, b.rows) = level.ci_lb.segment(b.row, b.rows);
+    slack0.ci_ub.segment(rb.row, b.rows) = level.ci_ub.segment(b.row, b.rows);
+    m_slackData[it->level].blocks[it->costBlock].weight = b.weight;
+  }
+}
+
+const HQPOutput& SolverHQPSlack::solve(const HQPStackedData& problemData) {
+  const HQPStackedLevel& level0 = problemData[0];
+  resize(static_cast<unsigned int>(level0.CE.cols()),
+         static_cast<unsigned int>(level0.CE.rows()),
+         static_cast<unsigned int>(level0.CI.rows()));
+
+  if (layoutChanged(problemData)) buildLayout(problemData);
+  if (!m_useSlacks) {
+    m_output = m_solver->solve(problemData);
+    m_objValue = m_solver->getObjectiveValue();
+    return m_output;
+  }
+
+  copyProblemData(problemData);
+  const HQPOutput& output = m_solver->solve(m_slackData);
+  m_objValue = m_solver->getObjectiveValue();
+  m_output.status = output.status;
+  m_output.iterations = output.iterations;
+  m_output.lambda = output.lambda;
+  if (output.x.size() == m_n + m_ns) {
+    m_output.x = output.x.head(m_n);
+    m_slacks = output.x.tail(m_ns);
+  }
+
+  // the sides of the soft inequalities come after the ones of level 0
+  m_output.activeSet.resize(output.activeSet.size());
+  Eigen::Index nActive = 0;
+  for (Eigen::Index i = 0; i < output.activeSet.size(); i++)
+    if (output.activeSet(i) >= 0 &&
+        output.activeSet(i) < static_cast<int>(2 * m_nin))
+      m_output.activeSet(nActive++) = output.activeSet(i);
+  m_output.activeSet.conservativeResize(nActive);
+
+  return m_output;
+}
+}  // namespace solvers
+}  // namespace tsid
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+#include "tsid/solvers/solver-HQP-stage.hpp"
+#include "tsid/solvers/utils.hpp"
+#include "tsid/math/utils.hpp"
+
+#include <pinocchio/macros.hpp>
+
+#include <iostream>
+
+namespace tsid {
+namespace solvers {
+
+SolverHQPStage::SolverHQPStage(const std::string& className,
+                               const std::string& name, SolverHQPBase* solver)
+    : SolverHQPBase(name),
+      m_solver(solver),
+      m_className(className),
+      m_objValue(0.0) {
+  PINOCCHIO_CHECK_INPUT_ARGUMENT(solver != NULL,
+                                 "The wrapped solver cannot be null");
+  m_useWarmStart = solver->getUseWarmStart();
+  m_maxIter = solver->getMaximumIterations();
+  m_maxTime = solver->getMaximumTime();
+  m_n = 0;
+  m_neq = 0;
+  m_nin = 0;
+}
+
+void SolverHQPStage::sendMsg(const std::string& s) {
+  std::cout << "[" << m_className << "." << m_name << "] " << s << std::endl;
+}
+
+void SolverHQPStage::resize(unsigned int n, unsigned int neq,
+                            unsigned int nin) {
+  if (n != m_n || neq != m_neq || nin != m_nin) {
+#ifndef NDEBUG
+    sendMsg("Resizing problem from (" + toString(m_n) + ", " +
+            toString(m_neq) + ", " + toString(m_nin) + ") to (" + toString(n) +
+            ", " + toString(neq) + ", " + toString(nin) + ")");
+#endif
+    m_output.resize(n, neq, 2 * nin);
+    resizeStage(n, neq, nin);
+  }
+
+  m_n = n;
+  m_neq = neq;
+  m_nin = nin;
+}
+
+void SolverHQPStage::retrieveQPData(const HQPData& problemData,
+                                    const bool /*hessianRegularization*/) {
+  stackHQPData(problemData, m_stackedData);
+}
+
+double SolverHQPStage::getObjectiveValue() { return m_objValue; }
+
+void SolverHQPStage::setUseWarmStart(bool useWarmStart) {
+  SolverHQPBase::setUseWarmStart(useWarmStart);
+  m_solver->setUseWarmStart(useWarmStart);
+}
+
+bool SolverHQPStage::setMaximumIterations(unsigned int maxIter) {
+  if (!SolverHQPBase::setMaximumIterations(maxIter)) return false;
+  return m_solver->setMaximumIterations(maxIter);
+}
+
+bool SolverHQPStage::setMaximumTime(double seconds) {
+  if (!SolverHQPBase::setMaximumTime(seconds)) return false;
+  return m_solver->setMaximumTime(seconds);
+}
+}  // namespace solvers
+}  // namespace tsid
@@ -17,15 +17,73 @@
 
 #include "tsid/solvers/solver-osqp.hpp"
 #include "tsid/math/utils.hpp"
+#include "tsid/solvers/utils.hpp"
 #include "tsid/utils/stop-watch.hpp"
 
 namespace tsid {
 namespace solvers {
 
+namespace {
+/// Write dense into sparse (its upper triangle only if upper is true). The
+/// sparsity pattern of sparse is only extended if dense has nonzero entries
+/// outside of it, in which case true is returned. Entries of the pattern that
+/// are zero in dense are stored as explicit zeros.
+bool updateSparseMatrix(const math::Matrix& dense, SolverOSQP::SpMat& sparse,
+                        bool upper) {
+  typedef SolverOSQP::SpMat SpMat;
+  bool inPattern =
+      sparse.rows() == dense.rows() && sparse.cols() == dense.cols();
+  for (Eigen::Index c = 0; inPattern && c < dense.cols(); c++) {
+    const Eigen::Index nRows = upper ? c + 1 : dense.rows();
+    SpMat::InnerIterator it(sparse, c);
+    for (Eigen::Index r = 0; r < nRows; r++) {
+      if (dense(r, c) == 0.0) continue;
+      while (it && it.row() < r) ++it;
+      if (!it || it.row() != r) {
+        inPattern = false;
+        break;
+      }
+    }
+  }
+
+  if (inPattern) {
+    for (Eigen::Index c = 0; c < sparse.outerSize(); c++)
+      for (SpMat::InnerIterator it(sparse, c); it; ++it)
+        it.valueRef() = dense(it.row(), c);
+    return false;
+  }
+
+  // New pattern: union of the previous one and of the nonzeros of dense
+  const bool samePatternSize =
+      sparse.rows() == dense.rows() && sparse.cols() == dense.cols();
+  std::vector<Eigen::Triplet<double> > triplets;
+  for (Eigen::Index c = 0; c < dense.cols(); c++) {
+    const Eigen::Index nRows = upper ? c + 1 : dense.rows();
+    if (samePatternSize) {
+      SpMat::InnerIterator it(sparse, c);
+      for (Eigen::Index r = 0; r < nRows; r++) {
+        while (it && it.row() < r) ++it;
+        if (dense(r, c) != 0.0 || (it && it.row() == r))
+          triplets.push_back(Eigen::Triplet<double>(r, c, dense(r, c)));
+      }
+    } else {
+      for (Eigen::Index r = 0; r < nRows; r++)
+        if (dense(r, c) != 0.0)
+          triplets.push_back(Eigen::Triplet<double>(r, c, dense(r, c)));
+    }
+  }
+  SpMat extended(dense.rows(), dense.cols());
+  extended.setFromTriplets(triplets.begin(), triplets.end());
+  sparse.swap(extended);
+  return true;
+}
+}  // namespace
+
 using namespace math;
 SolverOSQP::SolverOSQP(const std::string& name)
     : SolverHQPBase(name),
-      m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION) {
+      m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION),
+      m_appliedRegularization(0.0) {
   m_n = 0;
   m_neq = 0;
   m_nin = 0;
@@ -36,11 +94,16 @@ SolverOSQP::SolverOSQP(const std::string& name)
   m_epsRel = 0.;
   m_isVerbose = false;
   m_isDataInitialized = false;
+  m_isLastSolutionValid = false;
+  m_hessianChanged = true;
+  m_equalitiesChanged = true;
+  m_inequalitiesChanged = true;
 }
 
 SolverOSQP::SolverOSQP(const SolverOSQP& other)
     : SolverHQPBase(other.name()),
-      m_hessian_regularization(other.m_hessian_regularization) {
+      m_hessian_regularization(other.m_hessian_regularization),
+      m_appliedRegularization(0.0) {
   m_n = other.m_n;
   m_neq = other.m_neq;
   m_nin = other.m_nin;
@@ -51,6 +114,10 @@ SolverOSQP::SolverOSQP(const SolverOSQP& other)
   m_epsRel = other.m_epsRel;
   m_isVerbose = other.m_isVerbose;
   m_isDataInitialized = other.m_isDataInitialized;
+  m_isLastSolutionValid = false;
+  m_hessianChanged = true;
+  m_equalitiesChanged = true;
+  m_inequalitiesChanged = true;
 }
 
 void SolverOSQP::sendMsg(const std::string& s) {
@@ -91,6 +158,10 @@ void SolverOSQP::resize(unsigned int n, unsigned int neq, unsigned int nin) {
     m_solver.data()->setNumberOfConstraints(int(m_neq + m_nin));
 
     m_isDataInitialized = false;
+    m_isLastSolutionValid = false;
+    m_hessianChanged = true;
+    m_equalitiesChanged = true;
+    m_inequalitiesChanged = true;
 #ifndef NDEBUG
     setVerbose(true);
 #endif
@@ -106,90 +177,62 @@ void SolverOSQP::resize(unsigned int n, unsigned int neq, unsigned int nin) {
 
 void SolverOSQP::retrieveQPData(const HQPData& problemData,
                                 const bool hessianRegularization) {
+  stackHQPData(problemData, m_stackedData);
+  retrieveStackedQPData(m_stackedData, hessianRegularization);
+}
+
+void SolverOSQP::retrieveStackedQPData(const HQPStackedData& problemData,
+                                       const bool hessianRegularization) {
   if (problemData.size() > 2) {
     PINOCCHIO_CHECK_INPUT_ARGUMENT(
         false, "Solver not implemented for more than 2 hierarchical levels.");
   }
 
-  // Compute the constraint matrix sizes
-  unsigned int neq = 0, nin = 0;
-  const ConstraintLevel& cl0 = problemData[0];
-
-  if (cl0.size() > 0) {
-    const unsigned int n = cl0[0].second->cols();
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      assert(n == constr->cols());
-      if (constr->isEquality())
-        neq += constr->rows();
-      else
-        nin += constr->rows();
-    }
-    // If necessary, resize the constraint matrices
-    resize(n, neq, nin);
-
-    unsigned int i_in = 0;
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      if (constr->isEquality()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()) = constr->matrix();
-        m_qpData.ci_lb.segment(i_in, constr->rows()) = constr->vector();
-        m_qpData.ci_ub.segment(i_in, constr->rows()) = constr->vector();
-        i_in += constr->rows();
-      } else if (constr->isInequality()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()) = constr->matrix();
-        m_qpData.ci_lb.segment(i_in, constr->rows()) = constr->lowerBound();
-        m_qpData.ci_ub.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      } else if (constr->isBound()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()).setIdentity();
-        m_qpData.ci_lb.segment(i_in, constr->rows()) = constr->lowerBound();
-        m_qpData.ci_ub.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      }
-    }
-  } else {
-    resize(m_n, neq, nin);
-  }
+  // OSQP handles equalities as inequalities with equal bounds, so the
+  // equality rows are stacked on top of the inequality rows
+  const HQPStackedLevel& level0 = problemData[0];
+  const unsigned int neq = static_cast<unsigned int>(level0.CE.rows());
+  const unsigned int nin = static_cast<unsigned int>(level0.CI.rows());
+  resize(static_cast<unsigned int>(level0.CE.cols()), neq, nin);
+
+  // The flags are only reset by solve, once the changes have been passed to
+  // the OSQP workspace
+  bool equalitiesChanged, inequalitiesChanged;
+  compareMatrixVersions(level0, m_matrixVersions, equalitiesChanged,
+                        inequalitiesChanged);
+  m_equalitiesChanged |= equalitiesChanged;
+  m_inequalitiesChanged |= inequalitiesChanged;
+
+  if (m_equalitiesChanged) m_qpData.CI.topRows(neq) = level0.CE;
+  m_qpData.ci_lb.head(neq) = level0.ce;
+  m_qpData.ci_ub.head(neq) = level0.ce;
+  if (m_inequalitiesChanged) m_qpData.CI.bottomRows(nin) = level0.CI;
+  m_qpData.ci_lb.tail(nin) = level0.ci_lb;
+  m_qpData.ci_ub.tail(nin) = level0.ci_ub;
 
   EIGEN_MALLOC_NOT_ALLOWED;
 
   // Compute the cost
   if (problemData.size() > 1) {
-    const ConstraintLevel& cl1 = problemData[1];
     m_qpData.H.setZero();
     m_qpData.g.setZero();
-
-    for (ConstraintLevel::const_iterator it = cl1.begin(); it != cl1.end();
-         it++) {
-      const double& w = it->first;
-      auto constr = it->second;
-      if (!constr->isEquality())
-        PINOCCHIO_CHECK_INPUT_ARGUMENT(
-            false, "Inequalities in the cost function are not implemented yet");
-
-      EIGEN_MALLOC_ALLOWED;
-      m_qpData.H.noalias() +=
-          w * constr->matrix().transpose() * constr->matrix();
-      EIGEN_MALLOC_NOT_ALLOWED;
-
-      m_qpData.g.noalias() -=
-          w * constr->matrix().transpose() * constr->vector();
-    }
-
-    if (hessianRegularization) {
-      double m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION);
+    const bool hessianChanged = addLeastSquaresCost(
+        problemData[1], m_costCache, m_qpData.H, m_qpData.g);
+    // H is the same as at the last call if neither the cost nor the
+    // regularization changed
+    const double regularization =
+        hessianRegularization ? m_hessian_regularization : 0.0;
+    m_hessianChanged |=
+        hessianChanged || regularization != m_appliedRegularization;
+    m_appliedRegularization = regularization;
+
+    if (hessianRegularization)
       m_qpData.H.diagonal().array() += m_hessian_regularization;
-    }
   }
 }
 
-const HQPOutput& SolverOSQP::solve(const HQPData& problemData) {
-  typedef Eigen::SparseMatrix<double> SpMat;
-
-  SolverOSQP::retrieveQPData(problemData);
+const HQPOutput& SolverOSQP::solve(const HQPStackedData& problemData) {
+  SolverOSQP::retrieveStackedQPData(problemData);
 
   START_PROFILER_OSQP("PROFILE_OSQP_SOLUTION");
   //  min 0.5 * x G x + g0 x
@@ -199,28 +242,41 @@ const HQPOutput& SolverOSQP::solve(const HQPData& problemData) {
   EIGEN_MALLOC_ALLOWED
 
   if (!m_isDataInitialized) {
-    m_solver.data()->setHessianMatrix(
-        static_cast<SpMat>(m_qpData.H.sparseView()));
+    updateSparseMatrix(m_qpData.H, m_Hsparse, true);
+    updateSparseMatrix(m_qpData.CI, m_CIsparse, false);
+    m_solver.data()->setHessianMatrix(m_Hsparse);
     m_solver.data()->setGradient(m_qpData.g);
-    m_solver.data()->setLinearConstraintsMatrix(
-        static_cast<SpMat>(m_qpData.CI.sparseView()));
+    m_solver.data()->setLinearConstraintsMatrix(m_CIsparse);
     m_solver.data()->setBounds(m_qpData.ci_lb, m_qpData.ci_ub);
     m_isDataInitialized = true;
   } else {
-    m_solver.updateHessianMatrix(static_cast<SpMat>(m_qpData.H.sparseView()));
+    // OSQP is set up again only if a sparsity pattern had to be extended
+    if (m_hessianChanged) {
+      updateSparseMatrix(m_qpData.H, m_Hsparse, true);
+      m_solver.updateHessianMatrix(m_Hsparse);
+    }
     m_solver.updateGradient(m_qpData.g);
-    m_solver.updateLinearConstraintsMatrix(
-        static_cast<SpMat>(m_qpData.CI.sparseView()));
+    if (m_equalitiesChanged || m_inequalitiesChanged) {
+      updateSparseMatrix(m_qpData.CI, m_CIsparse, false);
+      m_solver.updateLinearConstraintsMatrix(m_CIsparse);
+    }
     m_solver.updateBounds(m_qpData.ci_lb, m_qpData.ci_ub);
   }
+  m_hessianChanged = false;
+  m_equalitiesChanged = false;
+  m_inequalitiesChanged = false;
 
   if (!m_solver.isInitialized()) {
+    m_solver.settings()->setWarmStart(m_useWarmStart);
     m_solver.initSolver();
   }
+  if (m_useWarmStart && m_isLastSolutionValid)
+    m_solver.setWarmStart(m_output.x, m_output.lambda);
   m_solver.solveProblem();
   STOP_PROFILER_OSQP("PROFILE_OSQP_SOLUTION");
 
   OsqpEigen::Status status = m_solver.getStatus();
+  m_isLastSolutionValid = status == OsqpEigen::Status::Solved;
 
   if (status == OsqpEigen::Status::Solved) {
     m_output.x = m_solver.getSolution();
@@ -228,35 +284,9 @@ const HQPOutput& SolverOSQP::solve(const HQPData& problemData) {
     m_output.lambda = m_solver.getDualSolution();
 
 #ifndef NDEBUG
-    const Vector& x = m_solver.getSolution();
-
-    const ConstraintLevel& cl0 = problemData[0];
-
-    if (cl0.size() > 0) {
-      for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-           it++) {
-        auto constr = it->second;
-        if (constr->checkConstraint(x) == false) {
-          // m_output.status = HQP_STATUS_ERROR;
-          if (constr->isEquality()) {
-            sendMsg("Equality " + constr->name() + " violated: " +
-                    toString((constr->matrix() * x - constr->vector()).norm()));
-          } else if (constr->isInequality()) {
-            sendMsg(
-                "Inequality " + constr->name() + " violated: " +
-                toString(
-                    (constr->matrix() * x - constr->lowerBound()).minCoeff()) +
-                "\n" +
-                toString(
-                    (constr->upperBound() - constr->matrix() * x).minCoeff()));
-          } else if (constr->isBound()) {
-            sendMsg("Bound " + constr->name() + " violated: " +
-                    toString((x - constr->lowerBound()).minCoeff()) + "\n" +
-                    toString((constr->upperBound() - x).minCoeff()));
-          }
-        }
-      }
-    }
+    const std::string violations =
+        constraintViolationsToString(problemData[0], m_output.x);
+    if (!violations.empty()) sendMsg(violations);
 #endif
   } else if (status == OsqpEigen::Status::PrimalInfeasible)
     m_output.status = HQP_STATUS_INFEASIBLE;
@@ -16,6 +16,7 @@
 //
 
 #include "tsid/solvers/solver-proxqp.hpp"
+#include "tsid/solvers/utils.hpp"
 #include "tsid/math/utils.hpp"
 #include "tsid/utils/stop-watch.hpp"
 
@@ -26,6 +27,7 @@ using namespace math;
 SolverProxQP::SolverProxQP(const std::string& name)
     : SolverHQPBase(name),
       m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION),
+      m_appliedRegularization(0.0),
       m_solver(1, 0, 0)  // dim of primal var needs to be strictly positiv
 {
   m_n = 0;
@@ -37,6 +39,13 @@ SolverProxQP::SolverProxQP(const std::string& name)
   m_epsAbs = 1e-5;
   m_epsRel = 0.;
   m_isVerbose = false;
+  m_isInitialized = false;
+  m_isLastSolutionValid = false;
+  m_hessianChanged = true;
+  m_equalitiesChanged = true;
+  m_inequalitiesChanged = true;
+  m_hasBounds = false;
+  m_solverHasBox = false;
 }
 
 void SolverProxQP::sendMsg(const std::string& s) {
@@ -78,8 +87,9 @@ void SolverProxQP::resize(unsigned int n, unsigned int neq, unsigned int nin) {
   m_neq = neq;
   m_nin = nin;
 
-  if (resizeVar || resizeEq || resizeIn) {
-    m_solver = dense::QP<double>(m_n, m_neq, m_nin);
+  if (resizeVar || resizeEq || resizeIn || m_solverHasBox != m_hasBounds) {
+    m_solver = dense::QP<double>(m_n, m_neq, m_nin, m_hasBounds);
+    m_solverHasBox = m_hasBounds;
     setMaximumIterations(m_maxIter);
     setMuInequality(m_muIn);
     setMuEquality(m_muEq);
@@ -90,109 +100,129 @@ void SolverProxQP::resize(unsigned int n, unsigned int neq, unsigned int nin) {
 #ifndef NDEBUG
     setVerbose(true);
 #endif
+    m_isInitialized = false;
+    m_isLastSolutionValid = false;
   }
 }
 
 void SolverProxQP::retrieveQPData(const HQPData& problemData,
                                   const bool hessianRegularization) {
+  stackHQPData(problemData, m_stackedData);
+  retrieveStackedQPData(m_stackedData, hessianRegularization);
+  const HQPStackedLevel& level0 = m_stackedData[0];
+  m_qpData.CE = level0.CE;
+  m_qpData.ce0 = level0.ce;
+  if (!m_hasBounds) {
+    m_qpData.CI = level0.CI;
+    m_qpData.ci_lb = level0.ci_lb;
+    m_qpData.ci_ub = level0.ci_ub;
+  }
+}
+
+void SolverProxQP::retrieveStackedQPData(const HQPStackedData& problemData,
+                                         const bool hessianRegularization) {
   if (problemData.size() > 2) {
     PINOCCHIO_CHECK_INPUT_ARGUMENT(
         false, "Solver not implemented for more than 2 hierarchical levels.");
   }
 
-  // Compute the constraint matrix sizes
-  unsigned int neq = 0, nin = 0;
-  const ConstraintLevel& cl0 = problemData[0];
-
-  if (cl0.size() > 0) {
-    const unsigned int n = cl0[0].second->cols();
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      assert(n == constr->cols());
-      if (constr->isEquality())
-        neq += constr->rows();
-      else
-        nin += constr->rows();
-    }
-    // If necessary, resize the constraint matrices
-    resize(n, neq, nin);
-
-    unsigned int i_eq = 0, i_in = 0;
-    for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-         it++) {
-      auto constr = it->second;
-      if (constr->isEquality()) {
-        m_qpData.CE.middleRows(i_eq, constr->rows()) = constr->matrix();
-        m_qpData.ce0.segment(i_eq, constr->rows()) = constr->vector();
-        i_eq += constr->rows();
-      } else if (constr->isInequality()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()) = constr->matrix();
-        m_qpData.ci_lb.segment(i_in, constr->rows()) = constr->lowerBound();
-        m_qpData.ci_ub.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      } else if (constr->isBound()) {
-        m_qpData.CI.middleRows(i_in, constr->rows()).setIdentity();
-        m_qpData.ci_lb.segment(i_in, constr->rows()) = constr->lowerBound();
-        m_qpData.ci_ub.segment(i_in, constr->rows()) = constr->upperBound();
-        i_in += constr->rows();
-      }
-    }
-  } else {
-    resize(m_n, neq, nin);
-  }
+  // Bounds are passed to ProxQP as a box, so their rows are removed from the
+  // inequalities
+  const HQPStackedLevel& level0 = problemData[0];
+  const unsigned int n = static_cast<unsigned int>(level0.CE.cols());
+  m_lb.resize(n);
+  m_ub.resize(n);
+  m_hasBounds = boundsToBox(level0, m_lb, m_ub);
+
+  // If necessary, resize the constraint matrices
+  resize(n, static_cast<unsigned int>(level0.CE.rows()),
+         m_hasBounds ? countGeneralInequalities(level0)
+                     : static_cast<unsigned int>(level0.CI.rows()));
+
+  // The flags are only reset by solve, once the changes have been passed to
+  // the ProxQP workspace
+  bool equalitiesChanged, inequalitiesChanged;
+  compareMatrixVersions(level0, m_matrixVersions, equalitiesChanged,
+                        inequalitiesChanged);
+  m_equalitiesChanged |= equalitiesChanged;
+  m_inequalitiesChanged |= inequalitiesChanged;
+
+  if (m_hasBounds)
+    generalInequalities(level0, m_qpData.CI, m_qpData.ci_lb, m_qpData.ci_ub,
+                        m_inequalitiesChanged || !m_isInitialized);
 
   EIGEN_MALLOC_NOT_ALLOWED;
 
   // Compute the cost
   if (problemData.size() > 1) {
-    const ConstraintLevel& cl1 = problemData[1];
     m_qpData.H.setZero();
     m_qpData.g.setZero();
-
-    for (ConstraintLevel::const_iterator it = cl1.begin(); it != cl1.end();
-         it++) {
-      const double& w = it->first;
-      auto constr = it->second;
-      if (!constr->isEquality())
-        PINOCCHIO_CHECK_INPUT_ARGUMENT(
-            false, "Inequalities in the cost function are not implemented yet");
-
-      EIGEN_MALLOC_ALLOWED;
-      m_qpData.H.noalias() +=
-          w * constr->matrix().transpose() * constr->matrix();
-      EIGEN_MALLOC_NOT_ALLOWED;
-
-      m_qpData.g.noalias() -=
-          w * constr->matrix().transpose() * constr->vector();
-    }
-
-    if (hessianRegularization) {
-      double m_hessian_regularization(DEFAULT_HESSIAN_REGULARIZATION);
+    const bool hessianChanged = addLeastSquaresCost(
+        problemData[1], m_costCache, m_qpData.H, m_qpData.g);
+    // H is the same as at the last call if neither the cost nor the
+    // regularization changed
+    const double regularization =
+        hessianRegularization ? m_hessian_regularization : 0.0;
+    m_hessianChanged |=
+        hessianChanged || regularization != m_appliedRegularization;
+    m_appliedRegularization = regularization;
+
+    if (hessianRegularization)
       m_qpData.H.diagonal().array() += m_hessian_regularization;
-    }
   }
 }
 
-const HQPOutput& SolverProxQP::solve(const HQPData& problemData) {
-  SolverProxQP::retrieveQPData(problemData);
+const HQPOutput& SolverProxQP::solve(const HQPStackedData& problemData) {
+  SolverProxQP::retrieveStackedQPData(problemData);
+  const HQPStackedLevel& level0 = problemData[0];
 
   START_PROFILER_PROXQP("PROFILE_PROXQP_SOLUTION");
   //  min 0.5 * x^T H x + g^T x
   //  s.t.
-  //  CE x + ce0 = 0
+  //  CE x = ce
   //  ci_lb <= CI x <= ci_ub
 
   EIGEN_MALLOC_ALLOWED
 
-  m_solver.init(m_qpData.H, m_qpData.g, m_qpData.CE, m_qpData.ce0, m_qpData.CI,
-                m_qpData.ci_lb, m_qpData.ci_ub);
+  m_solver.settings.initial_guess =
+      m_useWarmStart && m_isLastSolutionValid
+          ? InitialGuessStatus::WARM_START_WITH_PREVIOUS_RESULT
+          : InitialGuessStatus::EQUALITY_CONSTRAINED_INITIAL_GUESS;
+  const Matrix& CI = m_hasBounds ? m_qpData.CI : level0.CI;
+  const Vector& ci_lb = m_hasBounds ? m_qpData.ci_lb : level0.ci_lb;
+  const Vector& ci_ub = m_hasBounds ? m_qpData.ci_ub : level0.ci_ub;
+  if (!m_isInitialized) {
+    if (m_hasBounds)
+      m_solver.init(m_qpData.H, m_qpData.g, level0.CE, level0.ce, CI, ci_lb,
+                    ci_ub, m_lb, m_ub);
+    else
+      m_solver.init(m_qpData.H, m_qpData.g, level0.CE, level0.ce, CI, ci_lb,
+                    ci_ub);
+    m_isInitialized = true;
+  } else {
+    typedef optional<dense::MatRef<double> > OptionalMatRef;
+    const OptionalMatRef H =
+        m_hessianChanged ? OptionalMatRef(m_qpData.H) : nullopt;
+    const OptionalMatRef CE =
+        m_equalitiesChanged ? OptionalMatRef(level0.CE) : nullopt;
+    const OptionalMatRef C =
+        m_inequalitiesChanged ? OptionalMatRef(CI) : nullopt;
+    if (m_hasBounds)
+      m_solver.update(H, m_qpData.g, CE, level0.ce, C, ci_lb, ci_ub, m_lb,
+                      m_ub, false);
+    else
+      m_solver.update(H, m_qpData.g, CE, level0.ce, C, ci_lb, ci_ub, false);
+  }
+  m_hessianChanged = false;
+  m_equalitiesChanged = false;
+  m_inequalitiesChanged = false;
 
   m_solver.solve();
   STOP_PROFILER_PROXQP("PROFILE_PROXQP_SOLUTION");
 
   QPSolverOutput status = m_solver.results.info.status;
 
+  m_isLastSolutionValid = status == QPSolverOutput::PROXQP_SOLVED;
   if (status == QPSolverOutput::PROXQP_SOLVED) {
     m_output.x = m_solver.results.x;
     m_output.status = HQP_STATUS_OPTIMAL;
@@ -201,34 +231,9 @@ const HQPOutput& SolverProxQP::solve(const HQPData& problemData) {
     m_output.activeSet.setZero();
 
 #ifndef NDEBUG
-    const Vector& x = m_solver.results.x;
-
-    const ConstraintLevel& cl0 = problemData[0];
-
-    if (cl0.size() > 0) {
-      for (ConstraintLevel::const_iterator it = cl0.begin(); it != cl0.end();
-           it++) {
-        auto constr = it->second;
-        if (constr->checkConstraint(x) == false) {
-          if (constr->isEquality()) {
-            sendMsg("Equality " + constr->name() + " violated: " +
-                    toString((constr->matrix() * x - constr->vector()).norm()));
-          } else if (constr->isInequality()) {
-            sendMsg(
-                "Inequality " + constr->name() + " violated: " +
-                toString(
-                    (constr->matrix() * x - constr->lowerBound()).minCoeff()) +
-                "\n" +
-                toString(
-                    (constr->upperBound() - constr->matrix() * x).minCoeff()));
-          } else if (constr->isBound()) {
-            sendMsg("Bound " + constr->name() + " violated: " +
-                    toString((x - constr->lowerBound()).minCoeff()) + "\n" +
-                    toString((constr->upperBound() - x).minCoeff()));
-          }
-        }
-      }
-    }
+    const std::string violations =
+        constraintViolationsToString(level0, m_output.x);
+    if (!violations.empty()) sendMsg(violations);
 #endif
   } else if (status == QPSolverOutput::PROXQP_PRIMAL_INFEASIBLE)
     m_output.status = HQP_STATUS_INFEASIBLE;
@@ -17,8 +17,12 @@
 
 #include "tsid/solvers/utils.hpp"
 #include "tsid/math/constraint-base.hpp"
+#include "tsid/math/utils.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
 namespace tsid {
 namespace solvers {
@@ -50,7 +54,7 @@ std::string HQPDataToString(const HQPData& data, bool printMatrices) {
     for (HQPData::const_iterator it = data.begin(); it != data.end(); it++) {
       for (ConstraintLevel::const_iterator iit = it->begin(); iit != it->end();
            iit++) {
-        auto c = iit->second;
+        std::shared_ptr<const math::ConstraintBase> c = iit->second;
         ss << "*** " << c->name() << " *** ";
         if (c->isEquality()) {
           ss << "(equality)" << endl;
@@ -73,5 +77,516 @@ std::string HQPDataToString(const HQPData& data, bool printMatrices) {
   return ss.str();
 }
 
+void stackHQPData(const HQPData& problemData, HQPStackedData& stackedData) {
+  // the number of variables is the last column spanned by the constraints
+  unsigned int n = 0;
+  for (HQPData::const_iterator it = problemData.begin();
+       it != problemData.end(); it++)
+    for (ConstraintLevel::const_iterator itt = it->begin(); itt != it->end();
+         itt++)
+      n = std::max(n, itt->second->colOffset() + itt->second->cols());
+
+  if (stackedData.size() != problemData.size())
+    stackedData.resize(problemData.size());
+
+  for (unsigned int i = 0; i < problemData.size(); i++) {
+    const ConstraintLevel& cl = problemData[i];
+    HQPStackedLevel& level = stackedData[i];
+
+    bool sameLayout =
+        level.blocks.size() == cl.size() && level.CE.cols() == n;
+    for (unsigned int j = 0; sameLayout && j < cl.size(); j++)
+      sameLayout = level.blocks[j].constraint == cl[j].second &&
+                   level.blocks[j].rows == cl[j].second->rows() &&
+                   level.blocks[j].col == cl[j].second->colOffset() &&
+                   level.blocks[j].cols == cl[j].second->cols();
+
+    if (!sameLayout) {
+      level.blocks.clear();
+      unsigned int neq = 0, nin = 0;
+      for (ConstraintLevel::const_iterator it = cl.begin(); it != cl.end();
+           it++) {
+        const unsigned int m = it->second->rows();
+        const unsigned int col = it->second->colOffset();
+        const unsigned int cols = it->second->cols();
+        if (it->second->isEquality()) {
+          level.blocks.push_back(
+              HQPStackedBlock(it->first, it->second, true, neq, m, col, cols));
+          neq += m;
+        } else {
+          level.blocks.push_back(HQPStackedBlock(it->first, it->second, false,
+                                                 nin, m, col, cols));
+          nin += m;
+        }
+      }
+      level.resize(n, neq, nin);
+    }
+
+    for (unsigned int j = 0; j < cl.size(); j++) {
+      HQPStackedBlock& b = level.blocks[j];
+      const math::ConstraintBase& c = *cl[j].second;
+      b.weight = cl[j].first;
+      // the matrix is copied only if it changed since the last call
+      const bool copyMatrix = c.matrixVersion() != b.matrixVersion;
+      b.matrixVersion = c.matrixVersion();
+      if (c.isEquality()) {
+        if (copyMatrix)
+          level.CE.block(b.row, b.col, b.rows, b.cols) = c.matrix();
+        level.ce.segment(b.row, b.rows) = c.vector();
+      } else {
+        if (copyMatrix) {
+          if (c.isInequality())
+            level.CI.block(b.row, b.col, b.rows, b.cols) = c.matrix();
+          else
+            level.CI.block(b.row, b.col, b.rows, b.cols).setIdentity();
+        }
+        level.ci_lb.segment(b.row, b.rows) = c.lowerBound();
+        level.ci_ub.segment(b.row, b.rows) = c.upperBound();
+      }
+    }
+  }
+}
+
+void oneSidedInequalities(const HQPStackedLevel& level, math::RefMatrix CI,
+                          math::RefVector ci0) {
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++) {
+    if (it->isEquality) continue;
+    const unsigned int i_in = 2 * it->row;
+    CI.middleRows(i_in, it->rows) = level.CI.middleRows(it->row, it->rows);
+    ci0.segment(i_in, it->rows) = -level.ci_lb.segment(it->row, it->rows);
+    CI.middleRows(i_in + it->rows, it->rows) =
+        -level.CI.middleRows(it->row, it->rows);
+    ci0.segment(i_in + it->rows, it->rows) =
+        level.ci_ub.segment(it->row, it->rows);
+  }
+}
+
+unsigned int countFiniteInequalities(const HQPStackedLevel& level) {
+  unsigned int n = 0;
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++) {
+    if (it->isEquality) continue;
+    for (unsigned int i = it->row; i < it->row + it->rows; i++) {
+      if (level.ci_lb(i) > -INFINITE_BOUND) n++;
+      if (level.ci_ub(i) < INFINITE_BOUND) n++;
+    }
+  }
+  return n;
+}
+
+bool finiteOneSidedInequalities(const HQPStackedLevel& level,
+                                math::RefMatrix CI, math::RefVector ci0,
+                                math::VectorXi& rows) {
+  bool rowsChanged = false;
+  int k = 0;
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++) {
+    if (it->isEquality) continue;
+    for (unsigned int j = 0; j < it->rows; j++) {
+      const unsigned int i = it->row + j;
+      if (level.ci_lb(i) > -INFINITE_BOUND) {
+        const int row = static_cast<int>(2 * it->row + j);
+        rowsChanged |= rows(k) != row;
+        rows(k) = row;
+        CI.row(k) = level.CI.row(i);
+        ci0(k) = -level.ci_lb(i);
+        k++;
+      }
+      if (level.ci_ub(i) < INFINITE_BOUND) {
+        const int row = static_cast<int>(2 * it->row + it->rows + j);
+        rowsChanged |= rows(k) != row;
+        rows(k) = row;
+        CI.row(k) = -level.CI.row(i);
+        ci0(k) = level.ci_ub(i);
+        k++;
+      }
+    }
+  }
+  return rowsChanged;
+}
+
+bool findInequalitySide(const HQPStackedLevel& level, int a, unsigned int& row,
+                        bool& lower) {
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++) {
+    const int i = a - static_cast<int>(2 * it->row);
+    if (it->isEquality || i < 0 || i >= static_cast<int>(2 * it->rows))
+      continue;
+    lower = i < static_cast<int>(it->rows);
+    row = it->row + (lower ? i : i - it->rows);
+    return true;
+  }
+  return false;
+}
+
+unsigned int countGeneralInequalities(const HQPStackedLevel& level) {
+  unsigned int n = 0;
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++)
+    if (!it->isEquality && !it->constraint->isBound()) n += it->rows;
+  return n;
+}
+
+void generalInequalities(const HQPStackedLevel& level, math::RefMatrix CI,
+                         math::RefVector ci_lb, math::RefVector ci_ub,
+                         bool copyMatrix) {
+  unsigned int i_in = 0;
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++) {
+    if (it->isEquality || it->constraint->isBound()) continue;
+    if (copyMatrix)
+      CI.middleRows(i_in, it->rows) = level.CI.middleRows(it->row, it->rows);
+    ci_lb.segment(i_in, it->rows) = level.ci_lb.segment(it->row, it->rows);
+    ci_ub.segment(i_in, it->rows) = level.ci_ub.segment(it->row, it->rows);
+    i_in += it->rows;
+  }
+}
+
+bool boundsToBox(const HQPStackedLevel& level, math::RefVector lb,
+                 math::RefVector ub) {
+  bool hasBounds = false;
+  lb.setConstant(-std::numeric_limits<double>::infinity());
+  ub.setConstant(std::numeric_limits<double>::infinity());
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++) {
+    if (it->isEquality || !it->constraint->isBound()) continue;
+    // a bound only spans the columns of its block
+    lb.segment(it->col, it->cols) = lb.segment(it->col, it->cols).cwiseMax(
+        level.ci_lb.segment(it->row, it->rows));
+    ub.segment(it->col, it->cols) = ub.segment(it->col, it->cols).cwiseMin(
+        level.ci_ub.segment(it->row, it->rows));
+    hasBounds = true;
+  }
+  return hasBounds;
+}
+
+namespace {
+// The kernels below only read the columns of A in its support, the other
+// columns being zero, or all the columns if the support is empty. They only
+// write the lower triangle of H: the diagonal block of each range is a
+// symmetric rank update (SYRK) and the blocks below it are matrix products,
+// which Eigen evaluates with its vectorized kernels. Eigen only allocates
+// memory for their blocking buffers when these exceed its stack allocation
+// limit, which does not happen at the sizes of TSID problems (see
+// test_least_squares_cost_no_malloc).
+
+// Ranges of the support, or a single range covering A if it is empty
+struct SupportRanges {
+  SupportRanges(const math::ColumnSupport& support, Eigen::Index cols)
+      : all(0, static_cast<unsigned int>(cols)),
+        first(support.empty() ? &all : support.data()),
+        last(support.empty() ? &all + 1 : support.data() + support.size()) {}
+
+  const math::ColumnRange all;
+  const math::ColumnRange* first;
+  const math::ColumnRange* last;
+};
+
+// Lower triangle of the columns of H += w * A^T * A in the range ri
+inline void addGramColumns(math::ConstRefMatrix A, const SupportRanges& ranges,
+                           const math::ColumnRange* ri, double w,
+                           math::RefMatrix H) {
+  const auto Ai = A.middleCols(ri->col, ri->cols);
+  H.block(ri->col, ri->col, ri->cols, ri->cols)
+      .selfadjointView<Eigen::Lower>()
+      .rankUpdate(Ai.transpose(), w);
+  for (const math::ColumnRange* rk = ri + 1; rk != ranges.last; rk++)
+    H.block(rk->col, ri->col, rk->cols, ri->cols).noalias() +=
+        w * A.middleCols(rk->col, rk->cols).transpose() * Ai;
+}
+
+// Lower triangle of H += w * A^T * A
+void addGramMatrix(math::ConstRefMatrix A, const math::ColumnSupport& support,
+                   double w, math::RefMatrix H) {
+  const SupportRanges ranges(support, A.cols());
+  for (const math::ColumnRange* ri = ranges.first; ri != ranges.last; ri++)
+    addGramColumns(A, ranges, ri, w, H);
+}
+
+// g -= w * A^T * b
+void subtractGradient(math::ConstRefMatrix A,
+                      const math::ColumnSupport& support, double w,
+                      math::ConstRefVector b, math::RefVector g) {
+  const SupportRanges ranges(support, A.cols());
+  for (const math::ColumnRange* r = ranges.first; r != ranges.last; r++)
+    g.segment(r->col, r->cols).noalias() -=
+        w * A.middleCols(r->col, r->cols).transpose() * b;
+}
+
+// Lower triangle of H += w * M, with M = A^T * A
+void addGramBlocks(math::ConstRefMatrix M, const math::ColumnSupport& support,
+                   double w, math::RefMatrix H) {
+  const SupportRanges ranges(support, M.cols());
+  for (const math::ColumnRange* ri = ranges.first; ri != ranges.last; ri++) {
+    H.block(ri->col, ri->col, ri->cols, ri->cols)
+        .triangularView<Eigen::Lower>() +=
+        w * M.block(ri->col, ri->col, ri->cols, ri->cols);
+    for (const math::ColumnRange* rk = ri + 1; rk != ranges.last; rk++)
+      H.block(rk->col, ri->col, rk->cols, ri->cols) +=
+          w * M.block(rk->col, ri->col, rk->cols, ri->cols);
+  }
+}
+
+// H += w * A^T * A for a constraint whose matrix A is a selection. A^T * A is
+// then diagonal, so the squared weights are added to the diagonal of H.
+void addSelectionGram(const math::ConstraintBase& c, double w,
+                      math::RefMatrix H) {
+  const math::VectorXi& cols = c.selectedColumns();
+  const math::Vector& s = c.selectionWeights();
+  for (Eigen::Index i = 0; i < cols.size(); i++)
+    H(cols(i), cols(i)) += w * s(i) * s(i);
+}
+
+// g -= w * A^T * b for a constraint whose matrix A is a selection, scattering
+// the weighted entries of b into g
+void subtractSelectionGradient(const math::ConstraintBase& c, double w,
+                               math::ConstRefVector b, math::RefVector g) {
+  const math::VectorXi& cols = c.selectedColumns();
+  const math::Vector& s = c.selectionWeights();
+  for (Eigen::Index i = 0; i < cols.size(); i++)
+    g(cols(i)) -= w * s(i) * b(i);
+}
+}  // namespace
+
+void addLeastSquaresTerms(math::ConstRefMatrix A, math::ConstRefVector b,
+                          const math::ColumnSupport& support, double w,
+                          math::RefMatrix H, math::RefVector g) {
+  const SupportRanges ranges(support, A.cols());
+  for (const math::ColumnRange* ri = ranges.first; ri != ranges.last; ri++) {
+    addGramColumns(A, ranges, ri, w, H);
+    g.segment(ri->col, ri->cols).noalias() -=
+        w * A.middleCols(ri->col, ri->cols).transpose() * b;
+  }
+}
+
+void copyLowerToUpper(math::RefMatrix H) {
+  for (Eigen::Index j = 1; j < H.cols(); j++)
+    H.col(j).head(j) = H.row(j).head(j).transpose();
+}
+
+void addLeastSquaresCost(const HQPStackedLevel& level, math::RefMatrix H,
+                         math::RefVector g) {
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++) {
+    if (!it->isEquality)
+      PINOCCHIO_CHECK_INPUT_ARGUMENT(
+          false, "Inequalities in the cost function are not implemented yet");
+
+    const math::ConstraintBase& c = *it->constraint;
+    if (c.matrixStructure() != math::CONSTRAINT_MATRIX_DENSE) {
+      addSelectionGram(c, it->weight,
+                       H.block(it->col, it->col, it->cols, it->cols));
+      subtractSelectionGradient(c, it->weight,
+                                level.ce.segment(it->row, it->rows),
+                                g.segment(it->col, it->cols));
+      continue;
+    }
+
+    // only the columns spanned by the constraint contribute
+    addLeastSquaresTerms(
+        level.CE.block(it->row, it->col, it->rows, it->cols),
+        level.ce.segment(it->row, it->rows), c.columnSupport(),
+        it->weight, H.block(it->col, it->col, it->cols, it->cols),
+        g.segment(it->col, it->cols));
+  }
+  copyLowerToUpper(H);
+}
+
+bool addLeastSquaresCost(const HQPStackedLevel& level,
+                         LeastSquaresCostCache& cache, math::RefMatrix H,
+                         math::RefVector g) {
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+  const bool mallocAllowed = Eigen::internal::is_malloc_allowed();
+#endif
+  const Eigen::Index n = level.CE.cols();
+  bool changed = cache.H.cols() != n;
+  if (cache.entries.size() != level.blocks.size()) {
+    cache.entries.resize(level.blocks.size());
+    changed = true;
+  }
+
+  for (unsigned int j = 0; j < level.blocks.size(); j++) {
+    const HQPStackedBlock& b = level.blocks[j];
+    LeastSquaresCostCache::Entry& e = cache.entries[j];
+    if (!b.isEquality)
+      PINOCCHIO_CHECK_INPUT_ARGUMENT(
+          false, "Inequalities in the cost function are not implemented yet");
+
+    const auto A = level.CE.block(b.row, b.col, b.rows, b.cols);
+    const math::ConstraintBase& c = *b.constraint;
+    const math::ColumnSupport& support = c.columnSupport();
+    const bool selection =
+        c.matrixStructure() != math::CONSTRAINT_MATRIX_DENSE;
+    if (b.matrixVersion == 0 || b.matrixVersion != e.matrixVersion ||
+        e.col != b.col || e.AtA.cols() != b.cols) {
+      // the cache only allocates memory when the layout of the level changes
+      if (e.AtA.cols() != b.cols) {
+        EIGEN_MALLOC_ALLOWED
+        e.AtA.resize(b.cols, b.cols);
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+        Eigen::internal::set_is_malloc_allowed(mallocAllowed);
+#endif
+      }
+      e.AtA.setZero();
+      if (selection)
+        addSelectionGram(c, 1.0, e.AtA);
+      else
+        addGramMatrix(A, support, 1.0, e.AtA);
+      e.support = support;
+      e.matrixVersion = b.matrixVersion;
+      e.col = b.col;
+      changed = true;
+    }
+    if (e.weight != b.weight) {
+      e.weight = b.weight;
+      changed = true;
+    }
+    if (selection)
+      subtractSelectionGradient(c, b.weight, level.ce.segment(b.row, b.rows),
+                                g.segment(b.col, b.cols));
+    else
+      subtractGradient(A, support, b.weight, level.ce.segment(b.row, b.rows),
+                       g.segment(b.col, b.cols));
+  }
+
+  if (changed) {
+    if (cache.H.cols() != n) {
+      EIGEN_MALLOC_ALLOWED
+      cache.H.resize(n, n);
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+      Eigen::internal::set_is_malloc_allowed(mallocAllowed);
+#endif
+    }
+    cache.H.setZero();
+    for (const LeastSquaresCostCache::Entry& e : cache.entries)
+      addGramBlocks(e.AtA, e.support, e.weight,
+                    cache.H.block(e.col, e.col, e.AtA.rows(), e.AtA.cols()));
+    copyLowerToUpper(cache.H);
+  }
+  H += cache.H;
+  return changed;
+}
+
+void compareMatrixVersions(const HQPStackedLevel& level,
+                           std::vector<std::uint64_t>& versions,
+                           bool& equalitiesChanged, bool& inequalitiesChanged) {
+  const bool sameBlocks = versions.size() == level.blocks.size();
+  equalitiesChanged = !sameBlocks;
+  inequalitiesChanged = !sameBlocks;
+  if (!sameBlocks) versions.resize(level.blocks.size());
+  for (unsigned int j = 0; j < level.blocks.size(); j++) {
+    const HQPStackedBlock& b = level.blocks[j];
+    if (b.matrixVersion == 0 || b.matrixVersion != versions[j]) {
+      if (b.isEquality)
+        equalitiesChanged = true;
+      else
+        inequalitiesChanged = true;
+    }
+    versions[j] = b.matrixVersion;
+  }
+}
+
+bool sameBlockLayout(const std::vector<HQPStackedBlock>& a,
+                     const std::vector<HQPStackedBlock>& b) {
+  if (a.size() != b.size()) return false;
+  for (std::size_t j = 0; j < a.size(); j++) {
+    if (a[j].constraint != b[j].constraint ||
+        a[j].isEquality != b[j].isEquality || a[j].row != b[j].row ||
+        a[j].rows != b[j].rows || a[j].col != b[j].col ||
+        a[j].cols != b[j].cols)
+      return false;
+  }
+  return true;
+}
+
+std::string constraintViolationsToString(const HQPStackedLevel& level,
+                                         math::ConstRefVector x, double tol) {
+  std::string s;
+  for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+       it != level.blocks.end(); it++) {
+    const std::string& name = it->constraint->name();
+    if (it->isEquality) {
+      const double err = (level.CE.middleRows(it->row, it->rows) * x -
+                          level.ce.segment(it->row, it->rows))
+                             .norm();
+      if (err >= tol) {
+        if (!s.empty()) s += "\n";
+        s += "Equality " + name + " violated: " + toString(err);
+      }
+    } else {
+      const math::Vector Ax = level.CI.middleRows(it->row, it->rows) * x;
+      const double lbErr =
+          (Ax - level.ci_lb.segment(it->row, it->rows)).minCoeff();
+      const double ubErr =
+          (level.ci_ub.segment(it->row, it->rows) - Ax).minCoeff();
+      if (lbErr < -tol || ubErr < -tol) {
+        if (!s.empty()) s += "\n";
+        s += (it->constraint->isBound() ? "Bound " : "Inequality ") + name +
+             " violated: " + toString(lbErr) + "\n" + toString(ubErr);
+      }
+    }
+  }
+  return s;
+}
+
+double maxConstraintViolation(const HQPStackedLevel& level,
+                              math::ConstRefVector x) {
+  double violation = 0.0;
+  for (Eigen::Index i = 0; i < level.CE.rows(); i++)
+    violation =
+        std::max(violation, std::abs(level.CE.row(i).dot(x) - level.ce(i)));
+  for (Eigen::Index i = 0; i < level.CI.rows(); i++) {
+    const double Ax = level.CI.row(i).dot(x);
+    violation = std::max(violation, level.ci_lb(i) - Ax);
+    violation = std::max(violation, Ax - level.ci_ub(i));
+  }
+  return violation;
+}
+
+bool computeStationarityMultipliers(
+    const HQPStackedData& problemData, math::ConstRefMatrix CE,
+    const Eigen::Ref<const math::VectorXi>& activeSet, math::ConstRefVector x,
+    StationarityMultipliers& ws) {
+  const HQPStackedLevel& level0 = problemData[0];
+  const Eigen::Index n = x.size();
+
+  // Gradient of the cost of level 1: sum of w A^T (A x - b)
+  ws.grad.setZero(n);
+  if (problemData.size() > 1) {
+    const HQPStackedLevel& level = problemData[1];
+    for (std::vector<HQPStackedBlock>::const_iterator it = level.blocks.begin();
+         it != level.blocks.end(); it++) {
+      if (!it->isEquality) continue;
+      const auto A = level.CE.block(it->row, it->col, it->rows, it->cols);
+      ws.grad.segment(it->col, it->cols).noalias() +=
+          it->weight * A.transpose() *
+          (A * x.segment(it->col, it->cols) -
+           level.ce.segment(it->row, it->rows));
+    }
+  }
+
+  const Eigen::Index neq = CE.rows();
+  const Eigen::Index na = activeSet.size();
+  if (neq + na == 0) return false;
+  ws.Ct.resize(n, neq + na);
+  ws.Ct.leftCols(neq) = CE.transpose();
+  for (Eigen::Index k = 0; k < na; k++) {
+    unsigned int row;
+    bool lower;
+    PINOCCHIO_CHECK_INPUT_ARGUMENT(
+        findInequalitySide(level0, activeSet(k), row, lower),
+        "The active set is not in the layout with both sides of every "
+        "inequality");
+    if (lower)
+      ws.Ct.col(neq + k) = level0.CI.row(row).transpose();
+    else
+      ws.Ct.col(neq + k) = -level0.CI.row(row).transpose();
+  }
+  ws.qr.compute(ws.Ct);
+  ws.multipliers = ws.qr.solve(ws.grad);
+  return true;
+}
+
 }  // namespace solvers
 }  // namespace tsid
@@ -39,19 +39,19 @@ void TaskActuationBounds::mask(const Vector& m) {
       "The size of the mask needs to equal " + std::to_string(m_robot.na()));
   m_mask = m;
   const Vector::Index dim = static_cast<Vector::Index>(m.sum());
-  Matrix S = Matrix::Zero(dim, m_robot.na());
   m_activeAxes.resize(dim);
   unsigned int j = 0;
   for (unsigned int i = 0; i < m.size(); i++)
     if (m(i) != 0.0) {
       PINOCCHIO_CHECK_INPUT_ARGUMENT(
           m(i) == 1.0, "The mask entries need to equal either 0.0 or 1.0");
-      S(j, i) = 1.0;
       m_activeAxes(j) = i;
       j++;
     }
+  // the matrix selects the active axes, so that the formulation gathers the
+  // rows of the dynamics instead of multiplying them
   m_constraint.resize((unsigned int)dim, m_robot.na());
-  m_constraint.setMatrix(S);
+  m_constraint.setSelectionMatrix(m_activeAxes, Vector::Ones(dim));
 }
 
 int TaskActuationBounds::dim() const { return (int)m_mask.sum(); }
@@ -41,7 +41,6 @@ void TaskActuationEquality::mask(const Vector& m) {
   m_mask = m;
 
   const Vector::Index dim = static_cast<Vector::Index>(m.sum());
-  Matrix S = Matrix::Zero(dim, m_robot.na());
   m_activeAxes.resize(dim);
   unsigned int j = 0;
   for (unsigned int i = 0; i < m.size(); i++)
@@ -49,16 +48,23 @@ void TaskActuationEquality::mask(const Vector& m) {
       PINOCCHIO_CHECK_INPUT_ARGUMENT(
           m(i) == 1.0,
           "Entries in the mask vector need to be either 0.0 or 1.0");
-      S(j, i) = m_weights(i);
       m_activeAxes(j) = i;
       j++;
     }
   m_constraint.resize((unsigned int)dim, m_robot.na());
-  m_constraint.setMatrix(S);
+  updateConstraint();
+}
 
+void TaskActuationEquality::updateConstraint() {
+  // the matrix selects and weights the active axes, so that the formulation
+  // gathers and scales the rows of the dynamics instead of multiplying them
+  Vector w(m_activeAxes.size());
   for (unsigned int i = 0; i < m_activeAxes.size(); i++)
-    m_constraint.vector()(i) =
-        m_ref(m_activeAxes(i)) * m_weights(m_activeAxes(i));
+    w(i) = m_weights(m_activeAxes(i));
+  m_constraint.setSelectionMatrix(m_activeAxes, w);
+
+  for (unsigned int i = 0; i < m_activeAxes.size(); i++)
+    m_constraint.vector()(i) = m_ref(m_activeAxes(i)) * w(i);
 }
 
 int TaskActuationEquality::dim() const { return (int)m_mask.sum(); }
@@ -87,12 +93,7 @@ void TaskActuationEquality::setWeightVector(ConstRefVector weights) {
       "The size of the weight vector needs to equal " +
           std::to_string(m_robot.na()));
   m_weights = weights;
-
-  for (unsigned int i = 0; i < m_activeAxes.size(); i++) {
-    m_constraint.matrix()(i, m_activeAxes(i)) = m_weights(m_activeAxes(i));
-    m_constraint.vector()(i) =
-        m_ref(m_activeAxes(i)) * m_weights(m_activeAxes(i));
-  }
+  updateConstraint();
 }
 
 const Vector& TaskActuationEquality::getWeightVector() const {
@@ -124,11 +124,12 @@ const ConstraintBase& TaskComEquality::compute(const double, ConstRefVector,
   // Get CoM jacobian
   const Matrix3x& Jcom = m_robot.Jcom(data);
 
+  Matrix& A = m_constraint.matrixForWrite();
   int idx = 0;
   for (int i = 0; i < 3; i++) {
     if (m_mask(i) != 1.) continue;
 
-    m_constraint.matrix().row(idx) = Jcom.row(i);
+    A.row(idx) = Jcom.row(i);
     m_constraint.vector().row(idx) = (m_a_des - m_drift).row(i);
 
     m_a_des_masked(idx) = m_a_des(i);
@@ -80,6 +80,7 @@ void TaskContactForceEquality::setAssociatedContact(
     contacts::ContactBase& contact) {
   m_contact = &contact;
   m_contact_name = m_contact->name();
+  markAssociationChanged();
 }
 
 void TaskContactForceEquality::setReference(TrajectorySample& ref) {
@@ -130,7 +131,7 @@ const ConstraintBase& TaskContactForceEquality::compute(const double,
                                                         ConstRefVector,
                                                         ConstRefVector,
                                                         Data& /*data*/) {
-  auto& M = m_constraint.matrix();
+  auto& M = m_constraint.matrixForWrite();
   M = m_contact->getForceGeneratorMatrix();  // 6x12 for a 6d contact
 
   Vector forceError = m_ref.getValue() - m_fext.getValue();
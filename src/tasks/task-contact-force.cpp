@@ -22,7 +22,7 @@ namespace tasks {
 using namespace tsid;
 
 TaskContactForce::TaskContactForce(const std::string& name, RobotWrapper& robot)
-    : TaskBase(name, robot) {}
+    : TaskBase(name, robot), m_associationVersion(0) {}
 
 }  // namespace tasks
 }  // namespace tsid
@@ -59,7 +59,7 @@ const ConstraintBase& TaskCopEquality::compute(const double, ConstRefVector,
   // fill constraint matrix
   SE3 oMi;
   Vector3 p_local, p_world;
-  auto& M = m_constraint.matrix();
+  auto& M = m_constraint.matrixForWrite();
   M.resize(3, n);
   for (auto& cl : *m_contacts) {
     unsigned int i = cl->index;
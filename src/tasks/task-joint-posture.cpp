@@ -50,7 +50,6 @@ void TaskJointPosture::setMask(ConstRefVector m) {
       "The size of the mask needs to equal " + std::to_string(m_robot.na()));
   m_mask = m;
   const Vector::Index dim = static_cast<Vector::Index>(m.sum());
-  Matrix S = Matrix::Zero(dim, m_robot.nv());
   m_activeAxes.resize(dim);
   unsigned int j = 0;
   for (unsigned int i = 0; i < m.size(); i++)
@@ -58,12 +57,15 @@ void TaskJointPosture::setMask(ConstRefVector m) {
       PINOCCHIO_CHECK_INPUT_ARGUMENT(
           m(i) == 1.0, "Valid mask values are either 0.0 or 1.0 received: " +
                            std::to_string(m(i)));
-      S(j, m_robot.nv() - m_robot.na() + i) = 1.0;
       m_activeAxes(j) = i;
       j++;
     }
+  // the matrix selects the velocities of the active axes, so that the solvers
+  // add the Hessian of the task to its diagonal
+  const VectorXi cols =
+      m_activeAxes.array() + (int)(m_robot.nv() - m_robot.na());
   m_constraint.resize((unsigned int)dim, m_robot.nv());
-  m_constraint.setMatrix(S);
+  m_constraint.setSelectionMatrix(cols, Vector::Ones(dim));
 }
 
 int TaskJointPosture::dim() const { return (int)m_mask.sum(); }
@@ -36,6 +36,7 @@ TaskSE3Equality::TaskSE3Equality(const std::string& name, RobotWrapper& robot,
       m_robot.model().existFrame(frameName),
       "The frame with name '" + frameName + "' does not exist");
   m_frame_id = m_robot.model().getFrameId(frameName);
+  m_J_support = m_robot.frameJacobianSupport(m_frame_id);
 
   m_v_ref.setZero();
   m_a_ref.setZero();
@@ -64,6 +65,7 @@ void TaskSE3Equality::setMask(math::ConstRefVector mask) {
   TaskMotion::setMask(mask);
   int n = dim();
   m_constraint.resize(n, (unsigned int)m_J.cols());
+  m_constraint.setColumnSupport(m_J_support);
   m_p_error_masked_vec.resize(n);
   m_v_error_masked_vec.resize(n);
   m_drift_masked.resize(n);
@@ -192,8 +194,13 @@ const ConstraintBase& TaskSE3Equality::compute(const double, ConstRefVector,
               m_Kd.cwiseProduct(m_v_error.toVector()) + m_a_ref.toVector();
 
     // Use an explicit temporary `m_J_rotated` here to avoid allocations.
-    m_J_rotated.noalias() = m_wMl.toActionMatrix() * m_J;
-    m_J = m_J_rotated;
+    // Only the columns of the joints supporting the frame are nonzero.
+    const SE3::ActionMatrixType wMl = m_wMl.toActionMatrix();
+    for (const ColumnRange& r : m_J_support) {
+      m_J_rotated.middleCols(r.col, r.cols).noalias() =
+          wMl * m_J.middleCols(r.col, r.cols);
+      m_J.middleCols(r.col, r.cols) = m_J_rotated.middleCols(r.col, r.cols);
+    }
   }
 
   m_v_error_vec = m_v_error.toVector();
@@ -201,10 +208,12 @@ const ConstraintBase& TaskSE3Equality::compute(const double, ConstRefVector,
   m_v = v_frame.toVector();
 
   int idx = 0;
+  Matrix& A = m_constraint.matrixForWrite();
   for (int i = 0; i < 6; i++) {
     if (m_mask(i) != 1.) continue;
 
-    m_constraint.matrix().row(idx) = m_J.row(i);
+    for (const ColumnRange& r : m_J_support)
+      A.row(idx).segment(r.col, r.cols) = m_J.row(i).segment(r.col, r.cols);
     m_constraint.vector().row(idx) = (m_a_des - m_drift.toVector()).row(i);
     m_a_des_masked(idx) = m_a_des(i);
     m_drift_masked(idx) = m_drift.toVector()(i);
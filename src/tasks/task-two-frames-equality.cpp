@@ -38,6 +38,11 @@ TaskTwoFramesEquality::TaskTwoFramesEquality(const std::string& name,
   assert(m_robot.model().existFrame(frameName2));
   m_frame_id1 = m_robot.model().getFrameId(frameName1);
   m_frame_id2 = m_robot.model().getFrameId(frameName2);
+  m_J1_support = m_robot.frameJacobianSupport(m_frame_id1);
+  m_J2_support = m_robot.frameJacobianSupport(m_frame_id2);
+  m_J_support = m_J1_support;
+  for (const ColumnRange& r : m_J2_support)
+    addColumnRange(m_J_support, r.col, r.cols);
 
   m_v_ref.setZero();
   m_a_ref.setZero();
@@ -66,6 +71,7 @@ void TaskTwoFramesEquality::setMask(math::ConstRefVector mask) {
   TaskMotion::setMask(mask);
   int n = dim();
   m_constraint.resize(n, (unsigned int)m_J1.cols());
+  m_constraint.setColumnSupport(m_J_support);
   m_p_error_masked_vec.resize(n);
   m_v_error_masked_vec.resize(n);
   m_drift_masked.resize(n);
@@ -153,19 +159,32 @@ const ConstraintBase& TaskTwoFramesEquality::compute(const double,
 
   m_drift = (m_wMl1.act(m_drift1) - m_wMl2.act(m_drift2));
 
-  m_J1_rotated.noalias() =
-      m_wMl1.toActionMatrix() *
-      m_J1;  // Use an explicit temporary m_J_rotated to avoid allocations
-  m_J1 = m_J1_rotated;
+  // Use explicit temporaries m_J1_rotated and m_J2_rotated to avoid
+  // allocations. Only the columns of the joints supporting each frame are
+  // nonzero.
+  const SE3::ActionMatrixType wMl1 = m_wMl1.toActionMatrix();
+  for (const ColumnRange& r : m_J1_support) {
+    m_J1_rotated.middleCols(r.col, r.cols).noalias() =
+        wMl1 * m_J1.middleCols(r.col, r.cols);
+    m_J1.middleCols(r.col, r.cols) = m_J1_rotated.middleCols(r.col, r.cols);
+  }
 
-  m_J2_rotated.noalias() = m_wMl2.toActionMatrix() * m_J2;
-  m_J2 = m_J2_rotated;
+  const SE3::ActionMatrixType wMl2 = m_wMl2.toActionMatrix();
+  for (const ColumnRange& r : m_J2_support) {
+    m_J2_rotated.middleCols(r.col, r.cols).noalias() =
+        wMl2 * m_J2.middleCols(r.col, r.cols);
+    m_J2.middleCols(r.col, r.cols) = m_J2_rotated.middleCols(r.col, r.cols);
+  }
 
   int idx = 0;
+  Matrix& A = m_constraint.matrixForWrite();
   for (int i = 0; i < 6; i++) {
     if (m_mask(i) != 1.) continue;
 
-    m_constraint.matrix().row(idx) = m_J1.row(i) - m_J2.row(i);
+    for (const ColumnRange& r : m_J_support)
+      A.row(idx).segment(r.col, r.cols) =
+          m_J1.row(i).segment(r.col, r.cols) -
+          m_J2.row(i).segment(r.col, r.cols);
     m_constraint.vector().row(idx) = (m_a_des - m_drift.toVector()).row(i);
     m_a_des_masked(idx) = m_a_des(i);
     m_drift_masked(idx) = m_drift.toVector()(i);
@@ -125,4 +125,148 @@ BOOST_AUTO_TEST_CASE(test_constraint_inequality) {
   BOOST_CHECK(A.isApprox(inequality.matrix()));
 }
 
+BOOST_AUTO_TEST_CASE(test_constraint_matrix_version) {
+  std::cout << "test_constraint_matrix_version\n";
+  using namespace tsid::math;
+  using namespace Eigen;
+
+  const unsigned int n = 5;
+  const unsigned int m = 2;
+
+  MatrixXd A = MatrixXd::Ones(m, n);
+  VectorXd b = VectorXd::Ones(m);
+  ConstraintEquality equality("equality", A, b);
+  ConstraintInequality inequality("inequality", A, -b, b);
+  BOOST_CHECK(equality.matrixVersion() != inequality.matrixVersion());
+
+  // reading the matrix or writing the vectors does not change the version
+  std::uint64_t version = equality.matrixVersion();
+  const ConstraintEquality& constEquality = equality;
+  BOOST_CHECK(A.isApprox(constEquality.matrix()));
+  equality.setVector(2.0 * b);
+  BOOST_CHECK(equality.matrixVersion() == version);
+
+  equality.setMatrix(2.0 * A);
+  BOOST_CHECK(equality.matrixVersion() != version);
+  version = equality.matrixVersion();
+
+  // the non-const accesses to the matrix assume that it is modified
+  equality.matrix()(0, 0) = 3.0;
+  BOOST_CHECK(equality.matrixVersion() != version);
+  version = equality.matrixVersion();
+
+  equality.matrixForWrite()(0, 1) = 3.0;
+  BOOST_CHECK(equality.matrixVersion() != version);
+  version = equality.matrixVersion();
+
+  MatrixXd& kept = equality.matrixForWrite();
+  version = equality.matrixVersion();
+  kept(1, 0) = 3.0;
+  equality.markMatrixChanged();
+  BOOST_CHECK(equality.matrixVersion() != version);
+  version = equality.matrixVersion();
+
+  VectorXi cols(2);
+  cols << 1, 3;
+  equality.setSelectionMatrix(cols, VectorXd::Ones(2));
+  BOOST_CHECK(constEquality.matrix().row(0).isApprox(
+      VectorXd::Unit(n, 1).transpose()));
+  BOOST_CHECK(equality.matrixStructure() == CONSTRAINT_MATRIX_SELECTION);
+  version = equality.matrixVersion();
+  equality.matrix()(0, 0) = 1.0;
+  BOOST_CHECK(equality.matrixStructure() == CONSTRAINT_MATRIX_DENSE);
+  BOOST_CHECK(equality.matrixVersion() != version);
+  version = equality.matrixVersion();
+
+  equality.resize(m + 1, n);
+  BOOST_CHECK(equality.matrixVersion() != version);
+
+  ConstraintBound bounds("bounds", -VectorXd::Ones(n), VectorXd::Ones(n));
+  version = bounds.matrixVersion();
+  bounds.setLowerBound(-2.0 * VectorXd::Ones(n));
+  BOOST_CHECK(bounds.matrixVersion() == version);
+}
+
+BOOST_AUTO_TEST_CASE(test_constraint_column_offset) {
+  std::cout << "test_constraint_column_offset\n";
+  using namespace tsid::math;
+  using namespace Eigen;
+
+  const unsigned int n = 3;
+  const unsigned int m = 2;
+
+  MatrixXd A = MatrixXd::Ones(m, n);
+  VectorXd b = VectorXd::Ones(m);
+  ConstraintEquality equality("equality", A, b);
+  BOOST_CHECK(equality.colOffset() == 0);
+
+  std::uint64_t version = equality.matrixVersion();
+  equality.setColOffset(2);
+  BOOST_CHECK(equality.colOffset() == 2);
+  BOOST_CHECK(equality.matrixVersion() != version);
+  version = equality.matrixVersion();
+  equality.setColOffset(2);
+  BOOST_CHECK(equality.matrixVersion() == version);
+
+  // the constraint applies to x.segment(2, n) of all the variables
+  VectorXd x = VectorXd::Zero(n + 2);
+  x.segment(2, n) << 1.0, 0.0, 0.0;
+  BOOST_CHECK(equality.checkConstraint(x));
+  BOOST_CHECK(equality.checkConstraint(x.segment(2, n)));
+  x(0) = 1.0;
+  BOOST_CHECK(equality.checkConstraint(x));
+  x(3) = 1.0;
+  BOOST_CHECK(!equality.checkConstraint(x));
+  BOOST_CHECK_THROW(equality.checkConstraint(VectorXd::Zero(n + 1)),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(test_constraint_selection_matrix) {
+  std::cout << "test_constraint_selection_matrix\n";
+  using namespace tsid::math;
+  using namespace Eigen;
+
+  const unsigned int n = 3;
+  ConstraintEquality equality("equality", n, n);
+  BOOST_CHECK(equality.matrixStructure() == CONSTRAINT_MATRIX_DENSE);
+
+  VectorXi cols(n);
+  cols << 0, 1, 2;
+  std::uint64_t version = equality.matrixVersion();
+  equality.setSelectionMatrix(cols, VectorXd::Constant(n, 2.0));
+  BOOST_CHECK(equality.matrixStructure() == CONSTRAINT_MATRIX_SCALED_IDENTITY);
+  BOOST_CHECK(equality.matrix().isApprox(2.0 * MatrixXd::Identity(n, n)));
+  BOOST_CHECK(equality.matrixVersion() != version);
+
+  VectorXd w(n);
+  w << 1.0, 2.0, 3.0;
+  equality.setSelectionMatrix(cols, w);
+  BOOST_CHECK(equality.matrixStructure() == CONSTRAINT_MATRIX_DIAGONAL);
+  BOOST_CHECK(equality.matrix().isApprox(MatrixXd(w.asDiagonal())));
+
+  // two rows selecting the last and the first variables
+  equality.resize(2, n);
+  BOOST_CHECK(equality.matrixStructure() == CONSTRAINT_MATRIX_DENSE);
+  VectorXi selected(2);
+  selected << 2, 0;
+  equality.setSelectionMatrix(selected, w.head(2));
+  BOOST_CHECK(equality.matrixStructure() == CONSTRAINT_MATRIX_SELECTION);
+  MatrixXd A = MatrixXd::Zero(2, n);
+  A(0, 2) = 1.0;
+  A(1, 0) = 2.0;
+  BOOST_CHECK(equality.matrix().isApprox(A));
+  BOOST_CHECK(equality.selectedColumns() == selected);
+  BOOST_CHECK(equality.selectionWeights().isApprox(w.head(2)));
+
+  selected(0) = n;
+  BOOST_CHECK_THROW(equality.setSelectionMatrix(selected, w.head(2)),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(equality.setSelectionMatrix(cols, w),
+                    std::invalid_argument);
+
+  // a matrix that may have been modified is dense
+  equality.setMatrix(A);
+  BOOST_CHECK(equality.matrixStructure() == CONSTRAINT_MATRIX_DENSE);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -15,7 +15,12 @@
 // <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
 #include <iostream>
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/utility/binary.hpp>
@@ -23,6 +28,16 @@
 #include <tsid/solvers/solver-HQP-factory.hxx>
 #include <tsid/solvers/solver-HQP-eiquadprog.hpp>
 #include <tsid/solvers/solver-HQP-eiquadprog-rt.hpp>
+#include <tsid/solvers/solver-HQP-eiquadprog-fast.hpp>
+#include <tsid/solvers/solver-HQP-eiquadprog-cascade.hpp>
+#include <tsid/solvers/solver-HQP-eiquadprog-structured.hpp>
+#include <tsid/solvers/solver-HQP-presolve.hpp>
+#include <tsid/solvers/solver-HQP-scaling.hpp>
+#include <tsid/solvers/solver-HQP-screening.hpp>
+#include <tsid/solvers/solver-HQP-portfolio.hpp>
+#include <tsid/solvers/solver-HQP-autotuner.hpp>
+#include <tsid/solvers/solver-HQP-slack.hpp>
+#include <tsid/solvers/utils.hpp>
 
 #ifdef TSID_WITH_PROXSUITE
 #include <tsid/solvers/solver-proxqp.hpp>
@@ -45,6 +60,62 @@
   BOOST_CHECK_MESSAGE(A < B, #A << ": " << A << ">" << B)
 #define REQUIRE_FINITE(A) BOOST_REQUIRE_MESSAGE(isFinite(A), #A << ": " << A)
 
+void addConstraint(tsid::solvers::HQPData& hqpData, const unsigned int level,
+                   const double weight,
+                   std::shared_ptr<tsid::math::ConstraintBase> constraint) {
+  hqpData[level].push_back(
+      tsid::solvers::make_pair<double,
+                               std::shared_ptr<tsid::math::ConstraintBase>>(
+          weight, constraint));
+}
+
+// Random problem with n variables: neq equalities and nin inequalities
+// -1 <= CI x <= 1 at level 0, and a task of n rows at level 1
+struct RandomHQP {
+  tsid::solvers::HQPData hqpData;
+  std::shared_ptr<tsid::math::ConstraintEquality> equality;
+  std::shared_ptr<tsid::math::ConstraintInequality> inequality;
+  std::shared_ptr<tsid::math::ConstraintEquality> task;
+};
+
+RandomHQP makeRandomHQP(const unsigned int n, const unsigned int neq,
+                        const unsigned int nin) {
+  using namespace tsid::math;
+  RandomHQP problem;
+  problem.hqpData.resize(2);
+  problem.equality = std::make_shared<ConstraintEquality>(
+      "eq", Matrix::Random(neq, n), Vector::Random(neq));
+  addConstraint(problem.hqpData, 0, 1.0, problem.equality);
+  problem.inequality = std::make_shared<ConstraintInequality>(
+      "in", Matrix::Random(nin, n), -Vector::Ones(nin), Vector::Ones(nin));
+  addConstraint(problem.hqpData, 0, 1.0, problem.inequality);
+  problem.task = std::make_shared<ConstraintEquality>(
+      "task", Matrix::Random(n, n), Vector::Random(n));
+  addConstraint(problem.hqpData, 1, 1.0, problem.task);
+  return problem;
+}
+
+// Check that output has the status of the output of SolverHQuadProgFast and,
+// if both are optimal, the same solution and the same active set. Return true
+// if both are optimal.
+bool compareWithFast(const tsid::solvers::HQPOutput& output,
+                     const tsid::solvers::HQPOutput& output_fast,
+                     const double eps, const bool compareActiveSets = true) {
+  BOOST_REQUIRE(output.status == output_fast.status);
+  if (output.status != tsid::solvers::HQP_STATUS_OPTIMAL) return false;
+  BOOST_CHECK_MESSAGE(
+      output.x.isApprox(output_fast.x, eps),
+      "Diff with fast: " + tsid::toString((output.x - output_fast.x).norm()));
+  if (!compareActiveSets) return true;
+  tsid::math::VectorXi activeSet = output.activeSet;
+  tsid::math::VectorXi activeSet_fast = output_fast.activeSet;
+  std::sort(activeSet.data(), activeSet.data() + activeSet.size());
+  std::sort(activeSet_fast.data(),
+            activeSet_fast.data() + activeSet_fast.size());
+  BOOST_CHECK(activeSet == activeSet_fast);
+  return true;
+}
+
 BOOST_AUTO_TEST_SUITE(BOOST_TEST_MODULE)
 
 // BOOST_AUTO_TEST_CASE ( test_eiquadprog_unconstrained)
@@ -462,4 +533,1422 @@ BOOST_AUTO_TEST_CASE(test_eiquadprog_classic_vs_rt_vs_fast_vs_proxqp) {
 #endif
 }
 
+BOOST_AUTO_TEST_CASE(test_stacked_problem_data) {
+  std::cout << "test_stacked_problem_data\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-8;
+  const unsigned int n = 20;
+  const unsigned int neq = 6;
+  const unsigned int nin = 8;
+
+  HQPData HQPData(2);
+  Matrix A1 = Matrix::Random(n, n);
+  Vector b1 = Vector::Random(n);
+  auto cost = std::make_shared<ConstraintEquality>("c1", A1, b1);
+  HQPData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0, cost));
+
+  Matrix A_eq = Matrix::Random(neq, n);
+  Vector b_eq = Vector::Random(neq);
+  auto eq_constraint = std::make_shared<ConstraintEquality>("eq1", A_eq, b_eq);
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          1.0, eq_constraint));
+
+  Matrix A_in = Matrix::Random(nin, n);
+  Vector A_lb = -Vector::Ones(nin);
+  Vector A_ub = Vector::Ones(nin);
+  auto in_constraint =
+      std::make_shared<ConstraintInequality>("in1", A_in, A_lb, A_ub);
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          1.0, in_constraint));
+
+  auto bound = std::make_shared<ConstraintBound>(
+      "bound", -10.0 * Vector::Ones(n), 10.0 * Vector::Ones(n));
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0, bound));
+
+  HQPStackedData stackedData;
+  stackHQPData(HQPData, stackedData);
+  BOOST_REQUIRE(stackedData.size() == 2);
+  BOOST_CHECK(stackedData[0].CE.rows() == neq);
+  BOOST_CHECK(stackedData[0].CI.rows() == nin + n);
+  BOOST_CHECK(stackedData[0].CE.isApprox(A_eq));
+  BOOST_CHECK(stackedData[0].CI.topRows(nin).isApprox(A_in));
+  BOOST_CHECK(stackedData[0].CI.bottomRows(n).isIdentity());
+  BOOST_CHECK(stackedData[1].CE.isApprox(A1));
+
+  // unchanged matrices are not copied again, modified ones are
+  stackedData[0].CE.setZero();
+  cost->matrix() *= 2.0;
+  stackHQPData(HQPData, stackedData);
+  BOOST_CHECK(stackedData[0].CE.isZero());
+  BOOST_CHECK(stackedData[1].CE.isApprox(2.0 * A1));
+  stackedData[0].CE = A_eq;
+  cost->setMatrix(A1);
+  stackHQPData(HQPData, stackedData);
+  BOOST_CHECK(stackedData[1].CE.isApprox(A1));
+
+  std::vector<SolverHQPBase*> solvers;
+  solvers.push_back(SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast"));
+  solvers.push_back(
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_EIQUADPROG, "eiquadprog"));
+#ifdef TSID_WITH_PROXSUITE
+  solvers.push_back(
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_PROXQP, "proxqp"));
+#endif
+#ifdef TSID_QPMAD_FOUND
+  solvers.push_back(
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_QPMAD, "qpmad"));
+#endif
+
+  for (SolverHQPBase* solver : solvers) {
+    solver->resize(n, neq, nin + n);
+    const Vector x = solver->solve(HQPData).x;
+    const HQPOutput& output = solver->solve(stackedData);
+    BOOST_REQUIRE_MESSAGE(output.status == HQP_STATUS_OPTIMAL,
+                          solver->name() + " status " +
+                              SolverHQPBase::HQP_status_string[output.status]);
+    BOOST_CHECK_MESSAGE(
+        x.isApprox(output.x, EPS),
+        solver->name() + " diff: " + toString((x - output.x).norm()));
+    CHECK_LESS_THAN((A_eq * output.x - b_eq).norm(), EPS);
+    delete solver;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_eiquadprog_fast_warm_start) {
+  std::cout << "test_eiquadprog_fast_warm_start\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int nTest = 50;
+  const unsigned int n = 30;
+  const unsigned int neq = 6;
+  const unsigned int nin = 20;
+  // each cycle the task vector is perturbed by a Gaussian random variable with
+  // this covariance
+  const double TASK_PERTURBATION_VARIANCE = 1e-4;
+
+  HQPData HQPData(2);
+  Matrix A1 = Matrix::Random(n, n);
+  Vector b1 = 10.0 * Vector::Random(n);
+  auto cost = std::make_shared<ConstraintEquality>("c1", A1, b1);
+  HQPData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0, cost));
+
+  auto eq_constraint = std::make_shared<ConstraintEquality>(
+      "eq1", Matrix::Random(neq, n), Vector::Random(neq));
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          1.0, eq_constraint));
+
+  auto in_constraint = std::make_shared<ConstraintInequality>(
+      "in1", Matrix::Random(nin, n), -Vector::Ones(nin), Vector::Ones(nin));
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          1.0, in_constraint));
+
+  SolverHQPBase* solver_cold = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_cold");
+  solver_cold->setUseWarmStart(false);
+  SolverHQPBase* solver_warm = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_warm");
+  BOOST_CHECK(solver_warm->getUseWarmStart());
+
+  unsigned int nWarmStarts = 0;
+  for (unsigned int i = 0; i < nTest; i++) {
+    if (i > 0) {
+      b1 += TASK_PERTURBATION_VARIANCE * Vector::Random(n);
+      cost->setVector(b1);
+    }
+    const HQPOutput& output_cold = solver_cold->solve(HQPData);
+    const HQPOutput& output_warm = solver_warm->solve(HQPData);
+    BOOST_REQUIRE(output_cold.status == HQP_STATUS_OPTIMAL);
+    BOOST_REQUIRE(output_warm.status == HQP_STATUS_OPTIMAL);
+    BOOST_CHECK_MESSAGE(
+        output_cold.x.isApprox(output_warm.x, EPS),
+        "Warm start diff: " + toString((output_cold.x - output_warm.x).norm()));
+    BOOST_CHECK_MESSAGE(
+        std::abs(solver_cold->getObjectiveValue() -
+                 solver_warm->getObjectiveValue()) < EPS,
+        "Objective value diff: " +
+            toString(solver_cold->getObjectiveValue() -
+                     solver_warm->getObjectiveValue()));
+    if (output_warm.iterations == 0) nWarmStarts++;
+  }
+  std::cout << "Solutions found from the last active set: " << nWarmStarts
+            << " / " << nTest << "\n";
+  BOOST_CHECK(nWarmStarts > 0);
+
+  delete solver_cold;
+  delete solver_warm;
+}
+
+BOOST_AUTO_TEST_CASE(test_eiquadprog_fast_infinite_bounds) {
+  std::cout << "test_eiquadprog_fast_infinite_bounds\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int n = 20;
+  const unsigned int neq = 4;
+  const unsigned int nin = 12;
+
+  HQPData HQPData(2);
+  auto cost = std::make_shared<ConstraintEquality>(
+      "c1", Matrix::Random(n, n), 10.0 * Vector::Random(n));
+  HQPData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0, cost));
+
+  auto eq_constraint = std::make_shared<ConstraintEquality>(
+      "eq1", Matrix::Random(neq, n), Vector::Random(neq));
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          1.0, eq_constraint));
+
+  // one side of most rows is infinite, like in the friction cones
+  const Matrix A_in = Matrix::Random(nin, n);
+  Vector lb = -Vector::Ones(nin);
+  Vector ub = Vector::Ones(nin);
+  for (unsigned int i = 0; i < nin; i++) {
+    if (i % 3 == 0) lb(i) = -1e10;
+    if (i % 3 == 1) ub(i) = 1e10;
+  }
+  auto in_constraint =
+      std::make_shared<ConstraintInequality>("in1", A_in, lb, ub);
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          1.0, in_constraint));
+
+  HQPStackedData stackedData;
+  stackHQPData(HQPData, stackedData);
+  BOOST_CHECK_EQUAL(countFiniteInequalities(stackedData[0]), 2 * nin - 8);
+
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+  SolverHQPBase* solver =
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_EIQUADPROG, "eiquadprog");
+  const HQPOutput& output = solver->solve(HQPData);
+  const HQPOutput& output_fast = solver_fast->solve(HQPData);
+  BOOST_REQUIRE(output.status == HQP_STATUS_OPTIMAL);
+  BOOST_REQUIRE(output_fast.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_MESSAGE(
+      output.x.isApprox(output_fast.x, EPS),
+      "Diff FAST: " + toString((output.x - output_fast.x).norm()));
+
+  // the active set refers to the rows [lb; -ub] of each inequality
+  const Vector Ax = A_in * output_fast.x;
+  BOOST_CHECK(output_fast.activeSet.size() > 0);
+  for (Eigen::Index k = 0; k < output_fast.activeSet.size(); k++) {
+    const int row = output_fast.activeSet(k);
+    BOOST_REQUIRE(row >= 0 && row < static_cast<int>(2 * nin));
+    if (row < static_cast<int>(nin))
+      BOOST_CHECK_SMALL(Ax(row) - lb(row), EPS);
+    else
+      BOOST_CHECK_SMALL(ub(row - nin) - Ax(row - nin), EPS);
+  }
+
+  delete solver;
+  delete solver_fast;
+}
+
+BOOST_AUTO_TEST_CASE(test_eiquadprog_fast_equality_only) {
+  std::cout << "test_eiquadprog_fast_equality_only\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-8;
+  const unsigned int n = 12;
+  const unsigned int neq = 4;
+  const unsigned int m = 14;
+
+  auto equality = std::make_shared<ConstraintEquality>(
+      "eq", Matrix::Random(neq, n), Vector::Random(neq));
+  auto task = std::make_shared<ConstraintEquality>(
+      "task", Matrix::Random(m, n), Vector::Random(m));
+  HQPData hqpData(2);
+  hqpData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0,
+                                                                  equality));
+  hqpData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(0.5, task));
+
+  SolverHQuadProgFast solver("eiquadprog_fast");
+  for (unsigned int i = 0; i < 3; i++) {
+    task->vector() = Vector::Random(m);
+    equality->vector() = Vector::Random(neq);
+    // the factorization of the equalities must be updated
+    if (i == 2) equality->setMatrix(Matrix::Random(neq, n));
+
+    const HQPOutput& output = solver.solve(hqpData);
+    BOOST_REQUIRE(output.status == HQP_STATUS_OPTIMAL);
+    BOOST_CHECK(output.iterations == 0);
+
+    // solution of the KKT system [H CE^T; CE 0] [x; -lambda] = [-g; ce]
+    const Matrix& A = task->matrix();
+    const Matrix& CE = equality->matrix();
+    Matrix kkt = Matrix::Zero(n + neq, n + neq);
+    kkt.topLeftCorner(n, n) = 0.5 * A.transpose() * A;
+    kkt.topLeftCorner(n, n).diagonal().array() +=
+        DEFAULT_HESSIAN_REGULARIZATION;
+    kkt.topRightCorner(n, neq) = CE.transpose();
+    kkt.bottomLeftCorner(neq, n) = CE;
+    Vector rhs(n + neq);
+    rhs << 0.5 * A.transpose() * task->vector(), equality->vector();
+    const Vector sol = kkt.partialPivLu().solve(rhs);
+
+    BOOST_CHECK(output.x.isApprox(sol.head(n), EPS));
+    BOOST_CHECK(output.lambda.head(neq).isApprox(-sol.tail(neq), EPS));
+  }
+}
+
+#if defined(TSID_WITH_PROXSUITE) || defined(TSID_WITH_OSQP)
+BOOST_AUTO_TEST_CASE(test_persistent_workspace) {
+  std::cout << "test_persistent_workspace\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-4;
+  const unsigned int nTest = 30;
+  const unsigned int n = 20;
+  const unsigned int neq = 4;
+  const unsigned int nin = 10;
+
+  HQPData HQPData(2);
+  Vector b1 = Vector::Random(n);
+  auto cost =
+      std::make_shared<ConstraintEquality>("c1", Matrix::Random(n, n), b1);
+  HQPData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0, cost));
+
+  auto eq_constraint = std::make_shared<ConstraintEquality>(
+      "eq1", Matrix::Random(neq, n), Vector::Random(neq));
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          1.0, eq_constraint));
+
+  // sparse inequalities, so that the sparsity pattern has to be extended when
+  // a zero entry becomes nonzero
+  Matrix A_in = Matrix::Zero(nin, n);
+  for (unsigned int i = 0; i < nin; i++) A_in.row(i).segment(i, 3).setRandom();
+  auto in_constraint = std::make_shared<ConstraintInequality>(
+      "in1", A_in, -0.5 * Vector::Ones(nin), 0.5 * Vector::Ones(nin));
+  HQPData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          1.0, in_constraint));
+
+  SolverHQPBase* solver_ref = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+  std::vector<SolverHQPBase*> solvers;
+#ifdef TSID_WITH_PROXSUITE
+  solvers.push_back(
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_PROXQP, "proxqp"));
+#endif
+#ifdef TSID_WITH_OSQP
+  solvers.push_back(SolverHQPFactory::createNewSolver(SOLVER_HQP_OSQP, "osqp"));
+#endif
+
+  for (unsigned int i = 0; i < nTest; i++) {
+    if (i % 3 == 1) {
+      b1 += 1e-2 * Vector::Random(n);
+      cost->setVector(b1);
+    } else if (i % 3 == 2) {
+      // new values in the current sparsity pattern, or outside of it
+      A_in.row(i % nin).segment(i % nin, 3).setRandom();
+      if (i % 9 == 8) A_in(i % nin, n - 1 - i % nin) = 1.0;
+      in_constraint->setMatrix(A_in);
+    }
+
+    const HQPOutput& output_ref = solver_ref->solve(HQPData);
+    BOOST_REQUIRE(output_ref.status == HQP_STATUS_OPTIMAL);
+    for (SolverHQPBase* solver : solvers) {
+      const HQPOutput& output = solver->solve(HQPData);
+      BOOST_REQUIRE_MESSAGE(
+          output.status == HQP_STATUS_OPTIMAL,
+          solver->name() + " status " +
+              SolverHQPBase::HQP_status_string[output.status]);
+      BOOST_CHECK_MESSAGE(
+          output_ref.x.isApprox(output.x, EPS),
+          solver->name() + " diff: " + toString((output_ref.x - output.x).norm()));
+    }
+  }
+
+  delete solver_ref;
+  for (SolverHQPBase* solver : solvers) delete solver;
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(test_bounds_to_box) {
+  std::cout << "test_bounds_to_box\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-4;
+  const unsigned int n = 24;
+  const unsigned int neq = 6;
+  const unsigned int nin = 10;
+
+  // the bounds only restrict the variables spanned by their columns
+  RandomHQP problem = makeRandomHQP(n, neq, nin);
+  HQPData& hqpData = problem.hqpData;
+  auto bound1 = std::make_shared<ConstraintBound>(
+      "bound1", -0.5 * Vector::Ones(4), 0.5 * Vector::Ones(4));
+  bound1->setColOffset(n - 4);
+  addConstraint(hqpData, 0, 1.0, bound1);
+  auto bound2 = std::make_shared<ConstraintBound>(
+      "bound2", -0.2 * Vector::Ones(2), Vector::Ones(2));
+  bound2->setColOffset(n - 6);
+  addConstraint(hqpData, 0, 1.0, bound2);
+
+  HQPStackedData stackedData;
+  stackHQPData(hqpData, stackedData);
+  Vector lb(n), ub(n);
+  BOOST_REQUIRE(boundsToBox(stackedData[0], lb, ub));
+  BOOST_CHECK(lb.tail(4).isApprox(-0.5 * Vector::Ones(4)));
+  BOOST_CHECK(ub.tail(4).isApprox(0.5 * Vector::Ones(4)));
+  BOOST_CHECK(lb.segment(n - 6, 2).isApprox(-0.2 * Vector::Ones(2)));
+  BOOST_CHECK(ub.segment(n - 6, 2).isApprox(Vector::Ones(2)));
+  BOOST_CHECK(std::isinf(lb.head(n - 6).maxCoeff()));
+  BOOST_CHECK(std::isinf(ub.head(n - 6).minCoeff()));
+
+  // the solvers handling the bounds as a box agree with SolverHQuadProgFast
+  std::vector<SolverHQPBase*> solvers;
+#ifdef TSID_WITH_PROXSUITE
+  solvers.push_back(
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_PROXQP, "proxqp"));
+#endif
+#ifdef TSID_QPMAD_FOUND
+  solvers.push_back(
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_QPMAD, "qpmad"));
+#endif
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+  for (unsigned int i = 0; i < 5; i++) {
+    problem.task->vector() = 10.0 * Vector::Random(n);
+    const HQPOutput& output_fast = solver_fast->solve(hqpData);
+    for (SolverHQPBase* solver : solvers)
+      compareWithFast(solver->solve(hqpData), output_fast, EPS, false);
+  }
+
+  delete solver_fast;
+  for (SolverHQPBase* solver : solvers) delete solver;
+}
+
+BOOST_AUTO_TEST_CASE(test_least_squares_cost_cache) {
+  std::cout << "test_least_squares_cost_cache\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-10;
+  const unsigned int n = 10;
+  const unsigned int nTasks = 3;
+
+  HQPData HQPData(2);
+  std::vector<std::shared_ptr<ConstraintEquality>> tasks;
+  for (unsigned int i = 0; i < nTasks; i++) {
+    tasks.push_back(std::make_shared<ConstraintEquality>(
+        "task" + toString(i), Matrix::Random(i + 2, n), Vector::Random(i + 2)));
+    HQPData[1].push_back(
+        solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+            1.0 + i, tasks.back()));
+  }
+
+  HQPStackedData stackedData;
+  LeastSquaresCostCache cache;
+  Matrix H(n, n), H_ref(n, n);
+  Vector g(n), g_ref(n);
+  for (unsigned int k = 0; k < 5; k++) {
+    if (k == 1) HQPData[1][0].first = 0.1;  // new weight only
+    if (k == 2) tasks[1]->setMatrix(Matrix::Random(3, n));
+    if (k == 3) tasks[2]->vector().setRandom();  // new vector only
+    if (k == 4) HQPData[1].pop_back();
+
+    stackHQPData(HQPData, stackedData);
+    H.setZero();
+    g.setZero();
+    addLeastSquaresCost(stackedData[1], cache, H, g);
+    H_ref.setZero();
+    g_ref.setZero();
+    addLeastSquaresCost(stackedData[1], H_ref, g_ref);
+    BOOST_CHECK_MESSAGE(H.isApprox(H_ref, EPS),
+                        "H diff: " + toString((H - H_ref).norm()));
+    BOOST_CHECK_MESSAGE(g.isApprox(g_ref, EPS),
+                        "g diff: " + toString((g - g_ref).norm()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_least_squares_cost_column_support) {
+  std::cout << "test_least_squares_cost_column_support\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-10;
+  const unsigned int n = 10;
+
+  // the columns 3, 4 and 8 of the task matrix are zero
+  ColumnSupport support;
+  addColumnRange(support, 0, 3);
+  addColumnRange(support, 5, 3);
+  addColumnRange(support, 9, 1);
+  Matrix A = Matrix::Zero(4, n);
+  for (const ColumnRange &r : support)
+    A.middleCols(r.col, r.cols).setRandom();
+  const Vector b = Vector::Random(4);
+
+  auto sparseTask = std::make_shared<ConstraintEquality>("sparse", A, b);
+  sparseTask->setColumnSupport(support);
+  auto denseTask = std::make_shared<ConstraintEquality>("dense", A, b);
+
+  HQPData sparseData(2), denseData(2);
+  sparseData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(2.0,
+                                                                  sparseTask));
+  denseData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(2.0,
+                                                                  denseTask));
+  HQPStackedData sparseStacked, denseStacked;
+  stackHQPData(sparseData, sparseStacked);
+  stackHQPData(denseData, denseStacked);
+
+  Matrix H(n, n), H_ref(n, n);
+  Vector g(n), g_ref(n);
+  H.setZero();
+  g.setZero();
+  addLeastSquaresCost(sparseStacked[1], H, g);
+  H_ref.setZero();
+  g_ref.setZero();
+  addLeastSquaresCost(denseStacked[1], H_ref, g_ref);
+  BOOST_CHECK(H.isApprox(H_ref, EPS));
+  BOOST_CHECK(g.isApprox(g_ref, EPS));
+
+  LeastSquaresCostCache cache;
+  H.setZero();
+  g.setZero();
+  addLeastSquaresCost(sparseStacked[1], cache, H, g);
+  BOOST_CHECK(H.isApprox(H_ref, EPS));
+  BOOST_CHECK(g.isApprox(g_ref, EPS));
+}
+
+BOOST_AUTO_TEST_CASE(test_least_squares_cost_selection) {
+  std::cout << "test_least_squares_cost_selection\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-10;
+  const unsigned int n = 10;
+
+  // rows selecting the variables 7, 2 and 7 again, with different weights
+  VectorXi cols(3);
+  cols << 7, 2, 7;
+  const Vector weights = Vector::Random(3);
+  const Vector b = Vector::Random(3);
+  auto selectionTask =
+      std::make_shared<ConstraintEquality>("selection", 3, n);
+  selectionTask->setSelectionMatrix(cols, weights);
+  selectionTask->setVector(b);
+  const ConstraintBase &selection = *selectionTask;
+  BOOST_CHECK(selection.matrixStructure() == CONSTRAINT_MATRIX_SELECTION);
+  auto denseTask =
+      std::make_shared<ConstraintEquality>("dense", selection.matrix(), b);
+
+  HQPData selectionData(2), denseData(2);
+  selectionData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+          2.0, selectionTask));
+  denseData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(2.0,
+                                                                  denseTask));
+  HQPStackedData selectionStacked, denseStacked;
+  stackHQPData(selectionData, selectionStacked);
+  stackHQPData(denseData, denseStacked);
+
+  Matrix H(n, n), H_ref(n, n);
+  Vector g(n), g_ref(n);
+  H.setZero();
+  g.setZero();
+  addLeastSquaresCost(selectionStacked[1], H, g);
+  H_ref.setZero();
+  g_ref.setZero();
+  addLeastSquaresCost(denseStacked[1], H_ref, g_ref);
+  BOOST_CHECK(H.isApprox(H_ref, EPS));
+  BOOST_CHECK(g.isApprox(g_ref, EPS));
+
+  LeastSquaresCostCache cache;
+  H.setZero();
+  g.setZero();
+  addLeastSquaresCost(selectionStacked[1], cache, H, g);
+  BOOST_CHECK(H.isApprox(H_ref, EPS));
+  BOOST_CHECK(g.isApprox(g_ref, EPS));
+}
+
+BOOST_AUTO_TEST_CASE(test_least_squares_cost_no_malloc) {
+  std::cout << "test_least_squares_cost_no_malloc\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  // a humanoid with two 6d contacts: 38 accelerations and 12 forces
+  const unsigned int nv = 38;
+  const unsigned int n = nv + 12;
+
+  // dense tasks on the accelerations, a force regularization on the forces
+  // of each contact, and a task whose columns are split in two ranges
+  HQPData hqpData(2);
+  std::vector<std::shared_ptr<ConstraintEquality>> tasks;
+  tasks.push_back(std::make_shared<ConstraintEquality>(
+      "com", Matrix::Random(3, nv), Vector::Random(3)));
+  tasks.push_back(std::make_shared<ConstraintEquality>(
+      "posture", Matrix::Random(nv - 6, nv), Vector::Random(nv - 6)));
+  for (unsigned int i = 0; i < 2; i++) {
+    tasks.push_back(std::make_shared<ConstraintEquality>(
+        "force", Matrix::Random(6, 6), Vector::Random(6)));
+    tasks.back()->setColOffset(nv + 6 * i);
+  }
+  ColumnSupport support;
+  addColumnRange(support, 0, 6);
+  addColumnRange(support, 20, nv - 20);
+  Matrix A = Matrix::Zero(6, nv);
+  for (const ColumnRange& r : support) A.middleCols(r.col, r.cols).setRandom();
+  tasks.push_back(std::make_shared<ConstraintEquality>("foot", A,
+                                                       Vector::Random(6)));
+  tasks.back()->setColumnSupport(support);
+  for (const auto& task : tasks) addConstraint(hqpData, 1, 1.0, task);
+
+  HQPStackedData stackedData;
+  stackHQPData(hqpData, stackedData);
+  LeastSquaresCostCache cache;
+  Matrix H = Matrix::Zero(n, n);
+  Vector g = Vector::Zero(n);
+  // the first call allocates the cache
+  addLeastSquaresCost(stackedData[1], cache, H, g);
+
+  // the Gram matrices are recomputed without allocating memory
+  for (const auto& task : tasks) task->markMatrixChanged();
+  stackHQPData(hqpData, stackedData);
+  Matrix H_cache = Matrix::Zero(n, n);
+  Vector g_cache = Vector::Zero(n);
+  EIGEN_MALLOC_NOT_ALLOWED
+  H.setZero();
+  g.setZero();
+  addLeastSquaresCost(stackedData[1], H, g);
+  BOOST_CHECK(addLeastSquaresCost(stackedData[1], cache, H_cache, g_cache));
+  EIGEN_MALLOC_ALLOWED
+  BOOST_CHECK(H_cache.isApprox(H, 1e-10));
+  BOOST_CHECK(g_cache.isApprox(g, 1e-10));
+}
+
+BOOST_AUTO_TEST_CASE(test_eiquadprog_cascade_vs_weighted) {
+  std::cout << "test_eiquadprog_cascade_vs_weighted\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int nTest = 100;
+  const unsigned int n = 30;
+  const unsigned int neq = 6;
+  const unsigned int nin = 10;
+  const unsigned int m1 = 10;
+  const unsigned int m2 = 10;
+  const unsigned int m3 = 20;
+  // weight ratio between two consecutive levels of the weighted problem
+  const double WEIGHT_RATIO = 1e4;
+
+  Matrix A_eq = Matrix::Random(neq, n);
+  Vector b_eq = Vector::Random(neq);
+  auto eq_constraint = std::make_shared<ConstraintEquality>("eq1", A_eq, b_eq);
+  Matrix A_in = Matrix::Random(nin, n);
+  Vector A_lb = -Vector::Ones(nin);
+  Vector A_ub = Vector::Ones(nin);
+  auto in_constraint =
+      std::make_shared<ConstraintInequality>("in1", A_in, A_lb, A_ub);
+  auto task1 = std::make_shared<ConstraintEquality>(
+      "task1", Matrix::Random(m1, n), Vector::Random(m1));
+  auto task2 = std::make_shared<ConstraintEquality>(
+      "task2", Matrix::Random(m2, n), Vector::Random(m2));
+  auto task3 = std::make_shared<ConstraintEquality>(
+      "task3", Matrix::Random(m3, n), Vector::Random(m3));
+
+  HQPData hqpData(4);
+  addConstraint(hqpData, 0, 1.0, eq_constraint);
+  addConstraint(hqpData, 0, 1.0, in_constraint);
+  addConstraint(hqpData, 1, 1.0, task1);
+  addConstraint(hqpData, 2, 1.0, task2);
+  addConstraint(hqpData, 3, 1.0, task3);
+
+  // same problem with the priorities approximated by weights
+  HQPData weightedData(2);
+  weightedData[0] = hqpData[0];
+  addConstraint(weightedData, 1, WEIGHT_RATIO * WEIGHT_RATIO, task1);
+  addConstraint(weightedData, 1, WEIGHT_RATIO, task2);
+  addConstraint(weightedData, 1, 1.0, task3);
+
+  // only the first task, to check that its priority is respected
+  HQPData firstLevelData(2);
+  firstLevelData[0] = hqpData[0];
+  firstLevelData[1] = hqpData[1];
+
+  SolverHQPBase* solver_cascade = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_CASCADE, "eiquadprog_cascade");
+  SolverHQPBase* solver_weighted = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_weighted");
+  SolverHQPBase* solver_first = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_first");
+
+  const ConstraintBase& cTask1 = *task1;
+  for (unsigned int i = 0; i < nTest; i++) {
+    task1->vector() = Vector::Random(m1);
+    task2->vector() = Vector::Random(m2);
+    task3->vector() = Vector::Random(m3);
+
+    const HQPOutput& output = solver_cascade->solve(hqpData);
+    const HQPOutput& output_weighted = solver_weighted->solve(weightedData);
+    const HQPOutput& output_first = solver_first->solve(firstLevelData);
+
+    BOOST_REQUIRE_MESSAGE(
+        output.status == output_first.status,
+        "Status " + SolverHQPBase::HQP_status_string[output.status] +
+            " Status first level " +
+            SolverHQPBase::HQP_status_string[output_first.status]);
+    if (output.status != HQP_STATUS_OPTIMAL) continue;
+
+    CHECK_LESS_THAN((A_eq * output.x - b_eq).norm(), EPS);
+    BOOST_CHECK_MESSAGE(((A_in * output.x).array() <= A_ub.array() + EPS).all(),
+                        "Upper bounds violated: " +
+                            toString((A_ub - A_in * output.x).transpose()));
+    BOOST_CHECK_MESSAGE(((A_in * output.x).array() >= A_lb.array() - EPS).all(),
+                        "Lower bounds violated: " +
+                            toString((A_in * output.x - A_lb).transpose()));
+
+    // the first task is optimal as if the other levels did not exist
+    const double err1 = (cTask1.matrix() * output.x - cTask1.vector()).norm();
+    const double err1_first =
+        (cTask1.matrix() * output_first.x - cTask1.vector()).norm();
+    BOOST_CHECK_SMALL(err1 - err1_first, EPS);
+
+    // the weights can only degrade the first task
+    if (output_weighted.status == HQP_STATUS_OPTIMAL) {
+      const double err1_weighted =
+          (cTask1.matrix() * output_weighted.x - cTask1.vector()).norm();
+      CHECK_LESS_THAN(err1, err1_weighted + EPS);
+    }
+  }
+
+  delete solver_cascade;
+  delete solver_weighted;
+  delete solver_first;
+}
+
+BOOST_AUTO_TEST_CASE(test_eiquadprog_structured_vs_fast) {
+  std::cout << "test_eiquadprog_structured_vs_fast\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int nTest = 100;
+  const unsigned int nv = 12;  // accelerations
+  const unsigned int nc = 4;   // contacts with 3 forces each
+  const unsigned int n = nv + 3 * nc;
+
+  // layout of the acc-force formulation: the base dynamics spans all the
+  // variables, the friction cones and the force regularizations only span the
+  // forces of their contact
+  HQPData hqpData(2);
+  auto dynamics = std::make_shared<ConstraintEquality>(
+      "dynamics", Matrix::Random(6, n), Vector::Random(6));
+  hqpData[0].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0,
+                                                                  dynamics));
+  auto task = std::make_shared<ConstraintEquality>(
+      "task", Matrix::Random(nv, nv), Vector::Random(nv));
+  hqpData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0, task));
+  std::vector<std::shared_ptr<ConstraintEquality>> forceTasks;
+  for (unsigned int i = 0; i < nc; i++) {
+    auto cone = std::make_shared<ConstraintInequality>(
+        "cone", Matrix::Random(5, 3), -Vector::Ones(5), Vector::Ones(5));
+    cone->setColOffset(nv + 3 * i);
+    hqpData[0].push_back(
+        solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1.0,
+                                                                    cone));
+    auto forceTask = std::make_shared<ConstraintEquality>(
+        "force", Matrix::Random(3, 3), Vector::Random(3));
+    forceTask->setColOffset(nv + 3 * i);
+    forceTasks.push_back(forceTask);
+    hqpData[1].push_back(
+        solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(
+            1e-2, forceTask));
+  }
+
+  SolverHQuadProgStructured solver_structured("eiquadprog_structured");
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+  SolverHQPBase* solver_factory = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_STRUCTURED, "eiquadprog_structured_factory");
+  BOOST_CHECK(dynamic_cast<SolverHQuadProgStructured*>(solver_factory) !=
+              NULL);
+
+  for (unsigned int i = 0; i < nTest; i++) {
+    dynamics->vector() = Vector::Random(6);
+    task->vector() = Vector::Random(nv);
+    for (auto& forceTask : forceTasks) forceTask->vector() = Vector::Random(3);
+
+    const HQPOutput& output = solver_structured.solve(hqpData);
+    const HQPOutput& output_fast = solver_fast->solve(hqpData);
+    BOOST_CHECK(solver_structured.getBorderSize() == nv);
+    BOOST_CHECK(solver_structured.getNumberOfBlocks() == nc);
+
+    BOOST_REQUIRE(output.status == output_fast.status);
+    if (output.status != HQP_STATUS_OPTIMAL) continue;
+    BOOST_CHECK_MESSAGE(output.x.isApprox(output_fast.x, EPS),
+                        "Structured: " + toString(output.x.transpose()) +
+                            "\nFast: " + toString(output_fast.x.transpose()));
+    BOOST_CHECK_SMALL(solver_structured.getObjectiveValue() -
+                          solver_fast->getObjectiveValue(),
+                      EPS);
+  }
+
+  // a task coupling the accelerations and all the forces makes the Hessian
+  // dense
+  auto torqueTask = std::make_shared<ConstraintEquality>(
+      "torque", Matrix::Random(nv - 6, n), Vector::Random(nv - 6));
+  hqpData[1].push_back(
+      solvers::make_pair<double, std::shared_ptr<ConstraintBase>>(1e-3,
+                                                                  torqueTask));
+  const HQPOutput& output = solver_structured.solve(hqpData);
+  const HQPOutput& output_fast = solver_fast->solve(hqpData);
+  BOOST_CHECK(solver_structured.getBorderSize() == n);
+  BOOST_CHECK(solver_structured.getNumberOfBlocks() == 0);
+  BOOST_REQUIRE(output.status == output_fast.status);
+  if (output.status == HQP_STATUS_OPTIMAL)
+    BOOST_CHECK(output.x.isApprox(output_fast.x, EPS));
+
+  delete solver_fast;
+  delete solver_factory;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_presolve_vs_fast) {
+  std::cout << "test_presolve_vs_fast\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int nTest = 20;
+  const unsigned int n = 24;
+  const unsigned int neq = 6;
+  const unsigned int nin = 10;
+
+  RandomHQP problem = makeRandomHQP(n, neq, nin);
+  HQPData& hqpData = problem.hqpData;
+  auto& equality = problem.equality;
+  auto& task = problem.task;
+  problem.inequality->lowerBound()(0) = -1e10;
+  problem.inequality->upperBound()(1) = 1e10;
+  auto bound = std::make_shared<ConstraintBound>(
+      "bound", -0.5 * Vector::Ones(4), 0.5 * Vector::Ones(4));
+  bound->setColOffset(n - 4);
+  addConstraint(hqpData, 0, 1.0, bound);
+
+  SolverHQPPresolve solver_presolve(
+      "presolve", SolverHQPFactory::createNewSolver(SOLVER_HQP_EIQUADPROG_FAST,
+                                                    "eiquadprog_fast_reduced"));
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+
+  std::uint64_t reducedVersion = 0;
+  for (unsigned int i = 0; i < nTest; i++) {
+    task->vector() = 10.0 * Vector::Random(n);
+    equality->vector() = Vector::Random(neq);
+    // the null space must be updated
+    if (i == nTest / 2) equality->setMatrix(Matrix::Random(neq, n));
+
+    const HQPOutput& output = solver_presolve.solve(hqpData);
+    const HQPOutput& output_fast = solver_fast->solve(hqpData);
+    BOOST_CHECK_EQUAL(solver_presolve.getReducedSize(), n - neq);
+    BOOST_CHECK(solver_presolve.getReducedData()[0].CE.rows() == 0);
+
+    // the reduced matrices are only projected again if CE changed
+    const std::uint64_t version =
+        solver_presolve.getReducedData()[1].blocks[0].matrixVersion;
+    BOOST_CHECK((version != reducedVersion) == (i == 0 || i == nTest / 2));
+    reducedVersion = version;
+
+    if (!compareWithFast(output, output_fast, EPS)) continue;
+    BOOST_CHECK_SMALL(
+        solver_presolve.getObjectiveValue() - solver_fast->getObjectiveValue(),
+        EPS);
+    BOOST_CHECK(output.lambda.head(neq).isApprox(output_fast.lambda.head(neq),
+                                                 EPS));
+  }
+
+  // redundant equalities are removed by the presolve
+  Matrix CE(neq + 1, n);
+  CE << equality->matrix(), equality->matrix().colwise().sum();
+  Vector ce(neq + 1);
+  ce << equality->vector(), equality->vector().sum();
+  hqpData[0][0].second = std::make_shared<ConstraintEquality>("eq", CE, ce);
+  const HQPOutput& output = solver_presolve.solve(hqpData);
+  BOOST_CHECK_EQUAL(solver_presolve.getReducedSize(), n - neq);
+  if (output.status == HQP_STATUS_OPTIMAL)
+    BOOST_CHECK_SMALL((CE * output.x - ce).norm(), EPS);
+
+  delete solver_fast;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_presolve_redundant_rows) {
+  std::cout << "test_presolve_redundant_rows\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int n = 16;
+  const unsigned int neq = 6;
+
+  // the last equality is implied by the other ones, like with overlapping
+  // contacts, and the second bound duplicates rows of the first one
+  const Matrix A = Matrix::Random(neq, n);
+  const Vector a = Vector::Random(neq);
+  Matrix CE(neq + 1, n);
+  CE << A, A.row(0) + 2.0 * A.row(1);
+  Vector ce(neq + 1);
+  ce << a, a(0) + 2.0 * a(1);
+  auto equality = std::make_shared<ConstraintEquality>("eq", CE, ce);
+  auto bound1 = std::make_shared<ConstraintBound>(
+      "bound1", -0.5 * Vector::Ones(3), 0.5 * Vector::Ones(3));
+  bound1->setColOffset(n - 3);
+  auto bound2 = std::make_shared<ConstraintBound>(
+      "bound2", -0.2 * Vector::Ones(2), Vector::Ones(2));
+  bound2->setColOffset(n - 2);
+  auto task = std::make_shared<ConstraintEquality>(
+      "task", Matrix::Random(n, n), Vector::Random(n));
+
+  HQPData hqpData(2);
+  addConstraint(hqpData, 0, 1.0, equality);
+  addConstraint(hqpData, 0, 1.0, bound1);
+  addConstraint(hqpData, 0, 1.0, bound2);
+  addConstraint(hqpData, 1, 1.0, task);
+
+  // same problem without the redundant rows
+  Vector lb = -0.5 * Vector::Ones(3);
+  lb.tail(2).setConstant(-0.2);
+  auto bound = std::make_shared<ConstraintBound>("bound", lb,
+                                                 0.5 * Vector::Ones(3));
+  bound->setColOffset(n - 3);
+  HQPData hqpDataRef(2);
+  addConstraint(hqpDataRef, 0, 1.0,
+                std::make_shared<ConstraintEquality>("eq", A, a));
+  addConstraint(hqpDataRef, 0, 1.0, bound);
+  hqpDataRef[1] = hqpData[1];
+
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+  for (bool eliminateEqualities : {false, true}) {
+    SolverHQPPresolve solver_presolve(
+        "presolve", SolverHQPFactory::createNewSolver(
+                        SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_reduced"));
+    solver_presolve.setEliminateEqualities(eliminateEqualities);
+
+    for (unsigned int i = 0; i < 3; i++) {
+      task->vector() = 10.0 * Vector::Random(n);
+      const HQPOutput& output = solver_presolve.solve(hqpData);
+      const HQPOutput& output_ref = solver_fast->solve(hqpDataRef);
+      BOOST_CHECK_EQUAL(solver_presolve.getNumberOfEqualities(), neq);
+      BOOST_CHECK_EQUAL(solver_presolve.getNumberOfInequalities(), 3);
+
+      if (!compareWithFast(output, output_ref, EPS)) continue;
+      BOOST_CHECK_SMALL((CE * output.x - ce).norm(), EPS);
+      // the multipliers of the equalities may differ, but not their force
+      BOOST_CHECK_SMALL((CE.transpose() * output.lambda.head(neq + 1) -
+                         A.transpose() * output_ref.lambda.head(neq))
+                            .norm(),
+                        1e-4);
+    }
+
+    // the removed equality is no longer implied by the other ones, so the
+    // cached selection of the rows is updated
+    const Matrix CEfull = Matrix::Random(neq + 1, n);
+    equality->setMatrix(CEfull);
+    const HQPOutput& output = solver_presolve.solve(hqpData);
+    BOOST_CHECK_EQUAL(solver_presolve.getNumberOfEqualities(), neq + 1);
+    if (output.status == HQP_STATUS_OPTIMAL)
+      BOOST_CHECK_SMALL((CEfull * output.x - ce).norm(), EPS);
+    equality->setMatrix(CE);
+  }
+
+  delete solver_fast;
+}
+
+BOOST_AUTO_TEST_CASE(test_scaling_vs_fast) {
+  std::cout << "test_scaling_vs_fast\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  // the unscaled problem is ill-conditioned, so the solutions of the two
+  // solvers only agree up to the accuracy of the unscaled one
+  const double EPS_UNSCALED = 1e-3;
+  const unsigned int nTest = 20;
+  const unsigned int n = 24;
+  const unsigned int neq = 6;
+  const unsigned int nin = 10;
+
+  // the columns and the rows of level 0 have very different magnitudes, like
+  // the accelerations and the contact forces
+  Vector colScale(n);
+  for (unsigned int j = 0; j < n; j++)
+    colScale(j) = std::pow(10.0, -2.0 + 4.0 * j / (n - 1));
+  Vector rowScale = Vector::Ones(neq);
+  rowScale.head(2).setConstant(1e3);
+
+  RandomHQP problem = makeRandomHQP(n, neq, nin);
+  HQPData& hqpData = problem.hqpData;
+  auto& equality = problem.equality;
+  auto& inequality = problem.inequality;
+  auto& task = problem.task;
+  equality->setMatrix(rowScale.asDiagonal() * equality->matrix() *
+                      colScale.asDiagonal());
+  inequality->setMatrix(inequality->matrix() * colScale.asDiagonal());
+  task->setMatrix(task->matrix() * colScale.asDiagonal());
+  auto bound = std::make_shared<ConstraintBound>(
+      "bound", -0.5 * Vector::Ones(4), 0.5 * Vector::Ones(4));
+  bound->setColOffset(n - 4);
+  addConstraint(hqpData, 0, 1.0, bound);
+  // selection matrix, like the posture task
+  auto posture = std::make_shared<ConstraintEquality>("posture", n / 2, n);
+  VectorXi cols(n / 2);
+  for (unsigned int i = 0; i < n / 2; i++) cols(i) = 2 * i;
+  posture->setSelectionMatrix(cols, Vector::Constant(n / 2, 2.0));
+  posture->vector() = Vector::Random(n / 2);
+  addConstraint(hqpData, 1, 1e-2, posture);
+
+  SolverHQPScaling solver_scaling(
+      "scaling", SolverHQPFactory::createNewSolver(SOLVER_HQP_EIQUADPROG_FAST,
+                                                   "eiquadprog_fast_scaled"));
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+
+  // the non-const accessors would change the versions of the matrices
+  const ConstraintBase& cEquality = *equality;
+  const ConstraintBase& cInequality = *inequality;
+  const ConstraintBase& cTask = *task;
+  const ConstraintBase& cPosture = *posture;
+
+  std::uint64_t scaledVersion = 0;
+  for (unsigned int i = 0; i < nTest; i++) {
+    task->vector() = 10.0 * Vector::Random(n);
+    equality->vector() = Vector::Random(neq);
+    // only the changed matrix is scaled again
+    if (i == nTest / 2)
+      task->setMatrix(Matrix::Random(n, n) * colScale.asDiagonal());
+
+    const HQPOutput& output = solver_scaling.solve(hqpData);
+    const HQPOutput& output_fast = solver_fast->solve(hqpData);
+
+    const HQPStackedData& scaled = solver_scaling.getScaledData();
+    const std::uint64_t version = scaled[1].blocks[0].matrixVersion;
+    BOOST_CHECK((version != scaledVersion) == (i == 0 || i == nTest / 2));
+    scaledVersion = version;
+    BOOST_CHECK(scaled[0].blocks[2].constraint->isBound());
+    BOOST_CHECK(scaled[0].CI.bottomRightCorner(4, 4).isIdentity());
+    BOOST_CHECK(scaled[1].blocks[1].constraint->matrixStructure() ==
+                CONSTRAINT_MATRIX_SELECTION);
+    // the rows and the columns of level 0 are equilibrated
+    BOOST_CHECK(scaled[0].CE.cwiseAbs().maxCoeff() < 2.0);
+    BOOST_CHECK(scaled[0].CE.cwiseAbs().rowwise().maxCoeff().minCoeff() >
+                0.5);
+
+    if (!compareWithFast(output, output_fast, EPS_UNSCALED)) continue;
+    BOOST_CHECK_SMALL(
+        (cEquality.matrix() * output.x - cEquality.vector()).norm(), EPS);
+    BOOST_CHECK_CLOSE(solver_scaling.getObjectiveValue(),
+                      solver_fast->getObjectiveValue(), 100 * EPS_UNSCALED);
+    BOOST_CHECK(output.lambda.head(neq).isApprox(output_fast.lambda.head(neq),
+                                                 EPS_UNSCALED));
+
+    // stationarity of the cost, with the multipliers of both sides of every
+    // inequality
+    const Vector grad =
+        cTask.matrix().transpose() * (cTask.matrix() * output.x -
+                                      cTask.vector()) +
+        1e-2 * cPosture.matrix().transpose() *
+            (cPosture.matrix() * output.x - cPosture.vector());
+    Vector force = cEquality.matrix().transpose() * output.lambda.head(neq);
+    force += cInequality.matrix().transpose() *
+             (output.lambda.segment(neq, nin) -
+              output.lambda.segment(neq + nin, nin));
+    force.tail(4) += output.lambda.segment(neq + 2 * nin, 4) -
+                     output.lambda.segment(neq + 2 * nin + 4, 4);
+    BOOST_CHECK_SMALL((grad - force).norm(), EPS_UNSCALED * grad.norm());
+  }
+
+  delete solver_fast;
+}
+
+BOOST_AUTO_TEST_CASE(test_screening_vs_fast) {
+  std::cout << "test_screening_vs_fast\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int nTest = 20;
+  const unsigned int n = 24;
+  const unsigned int neq = 6;
+  // many inequalities, most of them inactive, like the friction cones
+  const unsigned int nin = 40;
+
+  RandomHQP problem = makeRandomHQP(n, neq, nin);
+  HQPData& hqpData = problem.hqpData;
+  auto& inequality = problem.inequality;
+  auto& task = problem.task;
+  inequality->lowerBound()(0) = -1e10;
+  inequality->upperBound()(1) = 1e10;
+  auto bound = std::make_shared<ConstraintBound>(
+      "bound", -0.5 * Vector::Ones(4), 0.5 * Vector::Ones(4));
+  bound->setColOffset(n - 4);
+  addConstraint(hqpData, 0, 1.0, bound);
+
+  SolverHQPScreening solver_screening(
+      "screening",
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_EIQUADPROG_FAST,
+                                        "eiquadprog_fast_screened"));
+  solver_screening.setMargin(0.1);
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+
+  const ConstraintBase& cInequality = *inequality;
+  const Vector target = task->vector();
+  for (unsigned int i = 0; i < nTest; i++) {
+    // slow motion, except at nTest / 2 where some dropped sides are violated
+    task->vector() = target + 0.01 * i * Vector::Ones(n);
+    if (i == nTest / 2) task->vector() = 100.0 * Vector::Random(n);
+
+    const unsigned int fullSolves = solver_screening.getNumberOfFullSolves();
+    const HQPOutput& output = solver_screening.solve(hqpData);
+    const HQPOutput& output_fast = solver_fast->solve(hqpData);
+
+    if (!compareWithFast(output, output_fast, EPS)) continue;
+    if (i == 0) {
+      BOOST_CHECK_EQUAL(solver_screening.getNumberOfDroppedSides(), 0);
+    } else if (i == nTest / 2) {
+      BOOST_CHECK_EQUAL(solver_screening.getNumberOfFullSolves(),
+                        fullSolves + 1);
+      BOOST_CHECK_EQUAL(solver_screening.getNumberOfDroppedSides(), 0);
+    } else if (i != nTest / 2 + 1) {
+      BOOST_CHECK(solver_screening.getNumberOfDroppedSides() > 0);
+    }
+
+    BOOST_CHECK_SMALL(solver_screening.getObjectiveValue() -
+                          solver_fast->getObjectiveValue(),
+                      EPS);
+    const Vector CIx = cInequality.matrix() * output.x;
+    BOOST_CHECK((CIx - inequality->lowerBound()).minCoeff() > -EPS);
+    BOOST_CHECK((inequality->upperBound() - CIx).minCoeff() > -EPS);
+  }
+
+  // without screening the problem is passed unchanged
+  solver_screening.setUseScreening(false);
+  const HQPOutput& output = solver_screening.solve(hqpData);
+  BOOST_CHECK_EQUAL(solver_screening.getNumberOfDroppedSides(), 0);
+  BOOST_CHECK(output.x.isApprox(solver_fast->solve(hqpData).x, EPS));
+
+  delete solver_fast;
+}
+
+
+// SolverHQuadProgFast sleeping before each solve, to reach the deadline of a
+// portfolio, or throwing an exception
+class SolverHQuadProgSlow : public tsid::solvers::SolverHQuadProgFast {
+ public:
+  SolverHQuadProgSlow(const std::string& name)
+      : SolverHQuadProgFast(name), delay(0.0), fail(false) {}
+
+  using SolverHQuadProgFast::solve;
+
+  const tsid::solvers::HQPOutput& solve(
+      const tsid::solvers::HQPStackedData& problemData) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(delay));
+    if (fail) throw std::runtime_error("solver failure");
+    return SolverHQuadProgFast::solve(problemData);
+  }
+
+  double delay;  /// sleeping time before each solve [s]
+  bool fail;     /// throw an exception in solve if true
+};
+
+BOOST_AUTO_TEST_CASE(test_portfolio) {
+  std::cout << "test_portfolio\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int n = 24;
+  const unsigned int neq = 6;
+  const unsigned int nin = 10;
+
+  RandomHQP problem = makeRandomHQP(n, neq, nin);
+  HQPData& hqpData = problem.hqpData;
+  auto& task = problem.task;
+
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+  // a large target activates many inequalities
+  task->vector() = 100.0 * Vector::Random(n);
+  const Vector x_fast = solver_fast->solve(hqpData).x;
+
+  // the second solver is used when the first one fails
+  SolverHQPPortfolio fallback("fallback", PORTFOLIO_MODE_FALLBACK);
+  SolverHQPBase* solver_limited = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_limited");
+  solver_limited->setMaximumIterations(1);
+  fallback.addSolver(solver_limited);
+  fallback.addSolver(SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_fallback"));
+  const HQPOutput& output_fallback = fallback.solve(hqpData);
+  BOOST_REQUIRE(output_fallback.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_EQUAL(fallback.getSolverIndex(), 1);
+  BOOST_CHECK(!fallback.getDeadlineReached());
+  BOOST_CHECK(output_fallback.x.isApprox(x_fast, EPS));
+
+  // a solver throwing an exception fails
+  SolverHQPPortfolio failing("failing", PORTFOLIO_MODE_FALLBACK);
+  SolverHQuadProgSlow* solver_failing = new SolverHQuadProgSlow("failing");
+  solver_failing->fail = true;
+  failing.addSolver(solver_failing);
+  failing.addSolver(SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_failing"));
+  const HQPOutput& output_failing = failing.solve(hqpData);
+  BOOST_REQUIRE(output_failing.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_EQUAL(failing.getSolverIndex(), 1);
+  BOOST_CHECK(output_failing.x.isApprox(x_fast, EPS));
+
+  // the fast solver wins the race against the slow one
+  SolverHQPPortfolio race("race", PORTFOLIO_MODE_RACE);
+  SolverHQuadProgSlow* solver_slow = new SolverHQuadProgSlow("slow");
+  solver_slow->delay = 0.2;
+  race.addSolver(solver_slow);
+  race.addSolver(SolverHQPFactory::createNewSolver(SOLVER_HQP_EIQUADPROG_FAST,
+                                                   "eiquadprog_fast_race"));
+  race.setMaximumTime(1.0);
+  const HQPOutput& output_race = race.solve(hqpData);
+  BOOST_REQUIRE(output_race.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_EQUAL(race.getSolverIndex(), 1);
+  BOOST_CHECK(!race.getDeadlineReached());
+  BOOST_CHECK(race.isSolverRunning(0));
+  BOOST_CHECK(output_race.x.isApprox(x_fast, EPS));
+
+  // at the deadline the solution is extrapolated from the previous ones
+  SolverHQPPortfolio deadline("deadline");
+  solver_slow = new SolverHQuadProgSlow("slow");
+  deadline.addSolver(solver_slow);
+  deadline.setMaximumTime(0.05);
+  Vector x[2];
+  for (unsigned int i = 0; i < 2; i++) {
+    task->vector() = 10.0 * Vector::Random(n);
+    const HQPOutput& output = deadline.solve(hqpData);
+    BOOST_REQUIRE(output.status == HQP_STATUS_OPTIMAL);
+    BOOST_CHECK_EQUAL(deadline.getSolverIndex(), 0);
+    x[i] = output.x;
+  }
+  solver_slow->delay = 0.2;
+  const HQPOutput& output = deadline.solve(hqpData);
+  BOOST_CHECK(output.status == HQP_STATUS_MAX_ITER_REACHED);
+  BOOST_CHECK_EQUAL(deadline.getSolverIndex(), -1);
+  BOOST_CHECK(deadline.getDeadlineReached());
+  BOOST_CHECK(output.x.isApprox(2.0 * x[1] - x[0], EPS));
+
+  // the solver still running is skipped
+  deadline.solve(hqpData);
+  BOOST_CHECK_EQUAL(deadline.getSolverIndex(), -1);
+  BOOST_CHECK(deadline.isSolverRunning(0));
+  // the running solver does not read the constraints of the problem
+  task->setMatrix(Matrix::Random(n, n));
+  while (deadline.isSolverRunning(0))
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  solver_slow->delay = 0.0;
+  BOOST_CHECK(deadline.solve(hqpData).status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_EQUAL(deadline.getSolverIndex(), 0);
+
+  delete solver_fast;
+}
+
+
+BOOST_AUTO_TEST_CASE(test_autotuner) {
+  std::cout << "test_autotuner\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-6;
+  const unsigned int warmupLength = 10;
+  const unsigned int n = 24;
+  const unsigned int neq = 6;
+  const unsigned int nin = 10;
+
+  RandomHQP problem = makeRandomHQP(n, neq, nin);
+  HQPData& hqpData = problem.hqpData;
+  auto& task = problem.task;
+
+  std::unique_ptr<SolverHQPBase> solver(
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_AUTOTUNER, "autotuner"));
+  SolverHQPAutotuner* autotuner =
+      dynamic_cast<SolverHQPAutotuner*>(solver.get());
+  BOOST_REQUIRE(autotuner != NULL);
+  BOOST_CHECK(autotuner->getNumberOfSolvers() >= 3);
+  BOOST_CHECK(autotuner->setWarmupLength(warmupLength));
+  // a solver stopping too early disagrees with the reference
+  SolverHQPBase* solver_limited = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast_limited");
+  solver_limited->setMaximumIterations(1);
+  autotuner->addSolver(solver_limited);
+  const unsigned int limited = autotuner->getNumberOfSolvers() - 1;
+
+  SolverHQPBase* solver_fast = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast");
+  for (unsigned int i = 0; i < 2 * warmupLength; i++) {
+    // a large target activates many inequalities
+    task->vector() = 100.0 * Vector::Random(n);
+    const HQPOutput& output = solver->solve(hqpData);
+    const HQPOutput& output_fast = solver_fast->solve(hqpData);
+    BOOST_CHECK_EQUAL(autotuner->getSelectedSolver() >= 0,
+                      i + 1 >= warmupLength);
+
+    if (!compareWithFast(output, output_fast, autotuner->getTolerance(),
+                         false))
+      continue;
+    if (autotuner->getSelectedSolver() < 0 || i + 1 == warmupLength)
+      BOOST_CHECK(output.x.isApprox(output_fast.x, EPS));
+  }
+
+  const int selected = autotuner->getSelectedSolver();
+  BOOST_CHECK(!autotuner->isQualified(limited));
+  BOOST_CHECK(autotuner->isQualified(0));
+  BOOST_CHECK(autotuner->isQualified(static_cast<unsigned int>(selected)));
+  BOOST_CHECK(selected != static_cast<int>(limited));
+  // the first problem of the window is not timed
+  BOOST_CHECK(autotuner->getSolveTime(0, 1.0) > 0.0);
+  for (unsigned int i = 0; i < autotuner->getNumberOfSolvers(); i++)
+    BOOST_CHECK(autotuner->getSolveTime(i, autotuner->getPercentile()) >=
+                autotuner->getSolveTime(selected, autotuner->getPercentile()) ||
+                !autotuner->isQualified(i));
+
+  // a change of size starts a new warm-up window
+  auto bound = std::make_shared<ConstraintBound>(
+      "bound", -10.0 * Vector::Ones(4), 10.0 * Vector::Ones(4));
+  addConstraint(hqpData, 0, 1.0, bound);
+  solver->solve(hqpData);
+  BOOST_CHECK_EQUAL(autotuner->getSelectedSolver(), -1);
+  BOOST_CHECK_EQUAL(autotuner->getSolveTime(0, 1.0), 0.0);
+
+  delete solver_fast;
+}
+
+BOOST_AUTO_TEST_CASE(test_slack_inequalities) {
+  std::cout << "test_slack_inequalities\n";
+  using namespace tsid;
+  using namespace math;
+  using namespace solvers;
+
+  const double EPS = 1e-4;
+  const unsigned int n = 4;
+
+  // hard constraint x0 <= 1
+  HQPData hqpData(2);
+  auto hard = std::make_shared<ConstraintInequality>(
+      "hard", Matrix::Identity(1, n), -1e10 * Vector::Ones(1), Vector::Ones(1));
+  addConstraint(hqpData, 0, 1.0, hard);
+  Vector target(n);
+  target << 0.0, 0.0, 3.0, -3.0;
+  auto task = std::make_shared<ConstraintEquality>(
+      "task", Matrix::Identity(n, n), target);
+  addConstraint(hqpData, 1, 1.0, task);
+
+  // soft constraints x0 >= 2, 0.5 <= x1 <= 1 and -1 <= x2, x3 <= 2
+  auto soft = std::make_shared<ConstraintInequality>(
+      "soft", Matrix::Identity(1, n), 2.0 * Vector::Ones(1),
+      1e10 * Vector::Ones(1));
+  addConstraint(hqpData, 1, 10.0, soft);
+  Matrix A1 = Matrix::Zero(1, n);
+  A1(0, 1) = 1.0;
+  auto soft_x1 = std::make_shared<ConstraintInequality>(
+      "soft_x1", A1, 0.5 * Vector::Ones(1), Vector::Ones(1));
+  addConstraint(hqpData, 1, 1.0, soft_x1);
+  auto soft_bound = std::make_shared<ConstraintBound>(
+      "soft_bound", -Vector::Ones(2), 2.0 * Vector::Ones(2));
+  soft_bound->setColOffset(2);
+  addConstraint(hqpData, 1, 1.0, soft_bound);
+
+  Vector x(n), slacks(n);
+  x << 1.0, 0.25, 2.5, -2.0;
+  slacks << -1.0, -0.25, 0.5, -1.0;
+
+  const SolverHQP solverTypes[2] = {SOLVER_HQP_EIQUADPROG_FAST,
+                                    SOLVER_HQP_EIQUADPROG_CASCADE};
+  for (unsigned int s = 0; s < 2; s++) {
+    SolverHQPSlack solver(
+        "slack", SolverHQPFactory::createNewSolver(solverTypes[s], "wrapped"));
+    soft->lowerBound()(0) = 2.0;
+
+    const HQPOutput& output = solver.solve(hqpData);
+    BOOST_REQUIRE(output.status == HQP_STATUS_OPTIMAL);
+    BOOST_CHECK_EQUAL(solver.getNumberOfSlacks(), 4);
+    const HQPStackedData& slackData = solver.getSlackData();
+    BOOST_REQUIRE_EQUAL(slackData.size(), 2);
+    BOOST_CHECK_EQUAL(slackData[0].CE.cols(), n + 4);
+    BOOST_CHECK_EQUAL(slackData[0].CI.rows(), 5);
+    BOOST_CHECK_EQUAL(slackData[1].CI.rows(), 0);
+    BOOST_CHECK_MESSAGE(output.x.isApprox(x, EPS),
+                        "Slack diff: " + toString((output.x - x).norm()));
+    BOOST_CHECK_MESSAGE(
+        solver.getSlacks().isApprox(slacks, EPS),
+        "Slack diff: " + toString((solver.getSlacks() - slacks).norm()));
+    // only the upper side of the hard constraint is active
+    BOOST_REQUIRE_EQUAL(output.activeSet.size(), 1);
+    BOOST_CHECK_EQUAL(output.activeSet(0), 1);
+
+    // the new bound is read without rebuilding the problem
+    soft->lowerBound()(0) = 0.5;
+    solver.solve(hqpData);
+    BOOST_REQUIRE(output.status == HQP_STATUS_OPTIMAL);
+    BOOST_CHECK_SMALL(output.x(0) - 5.0 / 11.0, EPS);
+    BOOST_CHECK_SMALL(output.x(1) - 0.25, EPS);
+    BOOST_CHECK_EQUAL(output.activeSet.size(), 0);
+  }
+  soft->lowerBound()(0) = 2.0;
+
+  // without inequalities in the cost the problem is passed unchanged
+  hqpData[1].erase(hqpData[1].begin() + 1, hqpData[1].end());
+  SolverHQPSlack solver("slack",
+                        SolverHQPFactory::createNewSolver(
+                            SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog_fast"));
+  const HQPOutput& output = solver.solve(hqpData);
+  BOOST_REQUIRE(output.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_EQUAL(solver.getNumberOfSlacks(), 0);
+  BOOST_CHECK(solver.getSlackData().empty());
+  x << 0.0, 0.0, 3.0, -3.0;
+  BOOST_CHECK(output.x.isApprox(x, EPS));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
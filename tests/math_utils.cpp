@@ -37,4 +37,27 @@ BOOST_AUTO_TEST_CASE(test_pseudoinverse) {
   BOOST_CHECK(Matrix::Identity(m, m).isApprox(A * Apinv));
 }
 
+BOOST_AUTO_TEST_CASE(test_add_column_range) {
+  std::cout << "test_add_column_range\n";
+  using namespace tsid::math;
+
+  ColumnSupport support;
+  addColumnRange(support, 10, 2);
+  addColumnRange(support, 0, 6);
+  addColumnRange(support, 20, 0);  // empty range
+  BOOST_CHECK(support.size() == 2);
+  BOOST_CHECK(support[0] == ColumnRange(0, 6));
+  BOOST_CHECK(support[1] == ColumnRange(10, 2));
+
+  // touching ranges are merged
+  addColumnRange(support, 6, 3);
+  BOOST_CHECK(support.size() == 2);
+  BOOST_CHECK(support[0] == ColumnRange(0, 9));
+
+  // a range overlapping several ones merges them
+  addColumnRange(support, 4, 7);
+  BOOST_CHECK(support.size() == 1);
+  BOOST_CHECK(support[0] == ColumnRange(0, 12));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
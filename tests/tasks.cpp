@@ -28,6 +28,8 @@
 #include <tsid/tasks/task-joint-posture.hpp>
 #include <tsid/tasks/task-joint-bounds.hpp>
 #include <tsid/tasks/task-joint-posVelAcc-bounds.hpp>
+#include <tsid/tasks/task-actuation-bounds.hpp>
+#include <tsid/tasks/task-actuation-equality.hpp>
 
 #include <tsid/trajectories/trajectory-se3.hpp>
 #include <tsid/trajectories/trajectory-euclidian.hpp>
@@ -67,6 +69,13 @@ BOOST_AUTO_TEST_CASE(test_task_se3_equality) {
 
   TaskSE3Equality task("task-se3", robot, "RWristPitch");
 
+  // the wrist does not depend on the joints of the legs
+  unsigned int supportSize = 0;
+  for (const ColumnRange &r : task.getConstraint().columnSupport())
+    supportSize += r.cols;
+  BOOST_CHECK(supportSize > 6);
+  BOOST_CHECK(supportSize < static_cast<unsigned int>(robot.nv()));
+
   VectorXd Kp = VectorXd::Ones(6);
   VectorXd Kd = 2 * VectorXd::Ones(6);
   task.Kp(Kp);
@@ -96,6 +105,11 @@ BOOST_AUTO_TEST_CASE(test_task_se3_equality) {
     REQUIRE_FINITE(constraint.matrix());
     BOOST_REQUIRE(isFinite(constraint.vector()));
 
+    MatrixXd A = constraint.matrix();
+    for (const ColumnRange &r : constraint.columnSupport())
+      A.middleCols(r.col, r.cols).setZero();
+    BOOST_CHECK(A.isZero(0.0));
+
     pseudoInverse(constraint.matrix(), Jpinv, 1e-4);
     ConstRefVector dv = Jpinv * constraint.vector();
     BOOST_REQUIRE(isFinite(Jpinv));
@@ -212,6 +226,12 @@ BOOST_AUTO_TEST_CASE(test_task_joint_posture) {
   cout << "Gonna create task\n";
   TaskJointPosture task("task-posture", robot);
 
+  // the task selects the velocities of the actuated joints
+  const ConstraintBase &selection = task.getConstraint();
+  BOOST_CHECK(selection.matrixStructure() == CONSTRAINT_MATRIX_SELECTION);
+  BOOST_CHECK(selection.matrix().rightCols(na).isIdentity());
+  BOOST_CHECK(selection.matrix().leftCols(6).isZero());
+
   cout << "Gonna set gains\n" << na << endl;
   VectorXd Kp = VectorXd::Ones(na);
   VectorXd Kd = 2.0 * Kp;
@@ -357,4 +377,46 @@ BOOST_AUTO_TEST_CASE(test_task_joint_posVelAcc_bounds) {
   }
 }
 
+BOOST_AUTO_TEST_CASE(test_task_actuation_selection) {
+  cout << "\n\n*********** TEST TASK ACTUATION SELECTION ***********\n";
+  vector<string> package_dirs;
+  package_dirs.push_back(romeo_model_path);
+  string urdfFileName = package_dirs[0] + "/urdf/romeo.urdf";
+  RobotWrapper robot(urdfFileName, package_dirs,
+                     pinocchio::JointModelFreeFlyer(), false);
+  const unsigned int na = robot.na();
+
+  // without mask the torque limits are an identity
+  TaskActuationBounds bounds("task-actuation-bounds", robot);
+  BOOST_CHECK(bounds.getConstraint().matrixStructure() ==
+              CONSTRAINT_MATRIX_SCALED_IDENTITY);
+  BOOST_CHECK(
+      bounds.getConstraint().matrix().isApprox(MatrixXd::Identity(na, na)));
+
+  VectorXd mask = VectorXd::Ones(na);
+  mask(1) = 0.0;
+  bounds.mask(mask);
+  const ConstraintBase &bc = bounds.getConstraint();
+  BOOST_CHECK(bc.matrixStructure() == CONSTRAINT_MATRIX_SELECTION);
+  BOOST_CHECK(bc.rows() == na - 1);
+  BOOST_CHECK(bc.selectedColumns()(1) == 2);
+  BOOST_CHECK(bc.matrix()(1, 2) == 1.0);
+
+  // the weights of the torque regularization are a diagonal
+  TaskActuationEquality equality("task-actuation-equality", robot);
+  VectorXd weights = VectorXd::LinSpaced(na, 1.0, 2.0);
+  VectorXd ref = VectorXd::Random(na);
+  equality.setReference(ref);
+  equality.setWeightVector(weights);
+  const ConstraintBase &ec = equality.getConstraint();
+  BOOST_CHECK(ec.matrixStructure() == CONSTRAINT_MATRIX_DIAGONAL);
+  BOOST_CHECK(ec.matrix().isApprox(MatrixXd(weights.asDiagonal())));
+  BOOST_CHECK(ec.vector().isApprox(weights.cwiseProduct(ref)));
+
+  equality.mask(mask);
+  BOOST_CHECK(ec.matrixStructure() == CONSTRAINT_MATRIX_SELECTION);
+  BOOST_CHECK(ec.matrix()(1, 2) == weights(2));
+  BOOST_CHECK(ec.vector()(1) == weights(2) * ref(2));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -37,6 +37,11 @@
 #include <pinocchio/algorithm/joint-configuration.hpp>  // integrate
 #include <pinocchio/parsers/srdf.hpp>
 
+#ifdef TSID_WITH_RT_SOLVER_GENERATOR
+// generated from romeo-rt-solver.txt
+#include "RomeoRTSolver.hpp"
+#endif
+
 using namespace tsid;
 using namespace tsid::trajectories;
 using namespace tsid::math;
@@ -665,6 +670,251 @@ BOOST_AUTO_TEST_CASE(test_contact_point_invdyn_formulation_acc_force) {
   cout << "Desired CoM position: " << com_ref.transpose() << endl;
 }
 
+void checkStackedProblemData(const HQPData &hqpData,
+                             const HQPStackedData &stackedData) {
+  BOOST_REQUIRE_EQUAL(stackedData.size(), hqpData.size());
+  for (unsigned int i = 0; i < hqpData.size(); i++) {
+    const HQPStackedLevel &level = stackedData[i];
+    BOOST_REQUIRE_EQUAL(level.blocks.size(), hqpData[i].size());
+    for (unsigned int j = 0; j < hqpData[i].size(); j++) {
+      const HQPStackedBlock &b = level.blocks[j];
+      std::shared_ptr<const ConstraintBase> c = hqpData[i][j].second;
+      BOOST_CHECK(b.constraint == c);
+      BOOST_CHECK_EQUAL(b.weight, hqpData[i][j].first);
+      BOOST_REQUIRE_EQUAL(b.rows, c->rows());
+      if (c->isEquality()) {
+        BOOST_CHECK(b.isEquality);
+        BOOST_CHECK(level.CE.middleRows(b.row, b.rows).isApprox(c->matrix()));
+        BOOST_CHECK(level.ce.segment(b.row, b.rows).isApprox(c->vector()));
+      } else {
+        BOOST_CHECK(!b.isEquality);
+        BOOST_CHECK(level.CI.middleRows(b.row, b.rows).isApprox(c->matrix()));
+        BOOST_CHECK(
+            level.ci_lb.segment(b.row, b.rows).isApprox(c->lowerBound()));
+        BOOST_CHECK(
+            level.ci_ub.segment(b.row, b.rows).isApprox(c->upperBound()));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_invdyn_formulation_acc_force_stacked_problem_data) {
+  cout << "\n*** test_invdyn_formulation_acc_force_stacked_problem_data ***\n";
+
+  const double dt = 0.001;
+  double t = 0.0;
+
+  StandardRomeoInvDynCtrl romeo_inv_dyn(dt);
+  auto tsid = romeo_inv_dyn.tsid;
+  Contact6d &contactRF = *(romeo_inv_dyn.contactRF);
+  Vector q = romeo_inv_dyn.q;
+  Vector v = romeo_inv_dyn.v;
+
+  const HQPData &hqpData = tsid->computeProblemData(t, q, v);
+  const HQPStackedData &stackedData =
+      tsid->computeStackedProblemData(t, q, v);
+  BOOST_CHECK_EQUAL(stackedData[0].CE.rows(), tsid->nEq());
+  BOOST_CHECK_EQUAL(stackedData[0].CI.rows(), tsid->nIn());
+  BOOST_CHECK_EQUAL(stackedData[0].CE.cols(), tsid->nVar());
+  checkStackedProblemData(hqpData, stackedData);
+
+  // changing a weight must not require a new layout
+  tsid->updateTaskWeight(romeo_inv_dyn.postureTask->name(), 1e-1);
+  tsid->computeProblemData(t, q, v);
+  tsid->computeStackedProblemData(t, q, v);
+  checkStackedProblemData(hqpData, stackedData);
+
+  // removing a contact changes the layout of all the levels
+  tsid->removeRigidContact(contactRF.name());
+  tsid->computeProblemData(t, q, v);
+  tsid->computeStackedProblemData(t, q, v);
+  BOOST_CHECK_EQUAL(stackedData[0].CE.rows(), tsid->nEq());
+  BOOST_CHECK_EQUAL(stackedData[0].CI.rows(), tsid->nIn());
+  BOOST_CHECK_EQUAL(stackedData[0].CE.cols(), tsid->nVar());
+  checkStackedProblemData(hqpData, stackedData);
+}
+
+BOOST_AUTO_TEST_CASE(test_invdyn_formulation_acc_force_bound_constraints) {
+  cout << "\n*** test_invdyn_formulation_acc_force_bound_constraints ***\n";
+
+  const double dt = 0.001;
+  double t = 0.0;
+
+  // the same controller with the joint bounds passed as an inequality and as
+  // a bound on all the variables
+  StandardRomeoInvDynCtrl romeo_ineq(dt);
+  StandardRomeoInvDynCtrl romeo_bound(dt);
+  auto tsid_ineq = romeo_ineq.tsid;
+  auto tsid_bound = romeo_bound.tsid;
+  TaskJointBounds &boundsTask = *(romeo_bound.jointBoundsTask);
+  BOOST_CHECK(!tsid_bound->getUseBoundConstraints());
+  BOOST_REQUIRE(tsid_bound->removeTask(boundsTask.name()));
+  tsid_bound->setUseBoundConstraints(true);
+  tsid_bound->addMotionTask(boundsTask, 1.0, 0);
+  BOOST_CHECK_EQUAL(tsid_bound->nIn(),
+                    tsid_ineq->nIn() + tsid_bound->nVar() -
+                        romeo_bound.robot->nv());
+
+  // tight acceleration bounds, so that some of them are active
+  const Vector ddq_max = Vector::Ones(romeo_bound.robot->na());
+  romeo_ineq.jointBoundsTask->setAccelerationBounds(-ddq_max, ddq_max);
+  boundsTask.setAccelerationBounds(-ddq_max, ddq_max);
+  Vector3 com_ref = romeo_bound.robot->com(tsid_bound->data());
+  com_ref(1) += 0.1;
+  TrajectorySample sampleCom(3);
+  sampleCom.setValue(com_ref);
+  romeo_ineq.comTask->setReference(sampleCom);
+  romeo_bound.comTask->setReference(sampleCom);
+
+  const Vector q = romeo_bound.q;
+  const Vector v = romeo_bound.v;
+  const HQPData &hqpData = tsid_bound->computeProblemData(t, q, v);
+  const HQPStackedData &stackedData =
+      tsid_bound->computeStackedProblemData(t, q, v);
+  BOOST_CHECK_EQUAL(stackedData[0].CI.rows(), tsid_bound->nIn());
+  checkStackedProblemData(hqpData, stackedData);
+
+  SolverHQPBase *solver_ineq = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog-fast-ineq");
+  SolverHQPBase *solver_bound = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog-fast-bound");
+  const HQPOutput &sol_ineq =
+      solver_ineq->solve(tsid_ineq->computeProblemData(t, q, v));
+  const HQPOutput &sol_bound =
+      solver_bound->solve(tsid_bound->computeStackedProblemData(t, q, v));
+  BOOST_REQUIRE(sol_ineq.status == HQP_STATUS_OPTIMAL);
+  BOOST_REQUIRE(sol_bound.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_MESSAGE(
+      sol_ineq.x.isApprox(sol_bound.x, 1e-6),
+      "Diff bound: " + toString((sol_ineq.x - sol_bound.x).norm()));
+  const Vector &dv = tsid_bound->getAccelerations(sol_bound);
+  BOOST_CHECK((dv.tail(romeo_bound.robot->na()).cwiseAbs().array() <=
+               ddq_max.array() + 1e-6)
+                  .all());
+
+#ifdef TSID_QPMAD_FOUND
+  SolverHQPBase *solver_qpmad =
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_QPMAD, "qpmad");
+  const HQPOutput &sol_qpmad =
+      solver_qpmad->solve(tsid_bound->computeStackedProblemData(t, q, v));
+  BOOST_REQUIRE(sol_qpmad.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_MESSAGE(
+      sol_ineq.x.isApprox(sol_qpmad.x, 1e-6),
+      "Diff QPMAD: " + toString((sol_ineq.x - sol_qpmad.x).norm()));
+  delete solver_qpmad;
+#endif
+#ifdef TSID_WITH_PROXSUITE
+  SolverHQPBase *solver_proxqp =
+      SolverHQPFactory::createNewSolver(SOLVER_HQP_PROXQP, "proxqp");
+  const HQPOutput &sol_proxqp =
+      solver_proxqp->solve(tsid_bound->computeStackedProblemData(t, q, v));
+  BOOST_REQUIRE(sol_proxqp.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK_MESSAGE(
+      sol_ineq.x.isApprox(sol_proxqp.x, 1e-4),
+      "Diff PROXQP: " + toString((sol_ineq.x - sol_proxqp.x).norm()));
+  delete solver_proxqp;
+#endif
+
+  // removing a contact resizes the bounds to the new number of variables
+  BOOST_REQUIRE(
+      tsid_bound->removeRigidContact(romeo_bound.contactRF->name()));
+  BOOST_CHECK_EQUAL(tsid_bound->nIn(),
+                    tsid_bound->nVar() +
+                        romeo_bound.contactLF->getForceConstraint().rows());
+  tsid_bound->computeProblemData(t, q, v);
+  tsid_bound->computeStackedProblemData(t, q, v);
+  BOOST_CHECK_EQUAL(stackedData[0].CI.rows(), tsid_bound->nIn());
+  checkStackedProblemData(hqpData, stackedData);
+
+  // removing the bound task removes its rows from the inequalities
+  const unsigned int nInWithBound = tsid_bound->nIn();
+  BOOST_REQUIRE(tsid_bound->removeTask(boundsTask.name()));
+  BOOST_CHECK_EQUAL(tsid_bound->nIn(), nInWithBound - tsid_bound->nVar());
+  tsid_bound->computeStackedProblemData(t, q, v);
+  BOOST_CHECK_EQUAL(stackedData[0].CI.rows(), tsid_bound->nIn());
+
+  delete solver_ineq;
+  delete solver_bound;
+}
+
+double hqpDataWeight(const HQPData &hqpData, const std::string &name) {
+  for (unsigned int i = 0; i < hqpData.size(); i++)
+    for (unsigned int j = 0; j < hqpData[i].size(); j++)
+      if (hqpData[i][j].second->name() == name) return hqpData[i][j].first;
+  return -1.0;
+}
+
+BOOST_AUTO_TEST_CASE(test_invdyn_formulation_acc_force_handles) {
+  cout << "\n*** test_invdyn_formulation_acc_force_handles ***\n";
+
+  const double dt = 0.001;
+  double t = 0.0;
+
+  StandardRomeoInvDynCtrl romeo_inv_dyn(dt);
+  auto tsid = romeo_inv_dyn.tsid;
+  Contact6d &contactRF = *(romeo_inv_dyn.contactRF);
+  Contact6d &contactLF = *(romeo_inv_dyn.contactLF);
+  Vector q = romeo_inv_dyn.q;
+  Vector v = romeo_inv_dyn.v;
+
+  const int postureHandle =
+      tsid->getTaskHandle(romeo_inv_dyn.postureTask->name());
+  const int boundsHandle =
+      tsid->getTaskHandle(romeo_inv_dyn.jointBoundsTask->name());
+  const int rfHandle = tsid->getContactHandle(contactRF.name());
+  const int lfHandle = tsid->getContactHandle(contactLF.name());
+  BOOST_REQUIRE(postureHandle >= 0);
+  BOOST_REQUIRE(boundsHandle >= 0);
+  BOOST_REQUIRE(rfHandle >= 0);
+  BOOST_REQUIRE(lfHandle >= 0);
+  BOOST_CHECK_EQUAL(tsid->getTaskHandle("unknown-task"), -1);
+  BOOST_CHECK_EQUAL(tsid->getContactHandle("unknown-contact"), -1);
+
+  const HQPData &hqpData = tsid->computeProblemData(t, q, v);
+  BOOST_CHECK(tsid->updateTaskWeight(postureHandle, 0.5));
+  BOOST_CHECK_EQUAL(
+      hqpDataWeight(hqpData, romeo_inv_dyn.postureTask->name()), 0.5);
+  // weights do not matter in the first priority level
+  BOOST_CHECK(!tsid->updateTaskWeight(boundsHandle, 0.5));
+
+  BOOST_CHECK(tsid->updateRigidContactWeights(lfHandle, 1e-3));
+  BOOST_CHECK_EQUAL(
+      hqpDataWeight(hqpData, contactLF.name() + "_force_reg_task"), 1e-3);
+
+  SolverHQPBase *solver = SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog-fast");
+  solver->resize(tsid->nVar(), tsid->nEq(), tsid->nIn());
+  const HQPOutput &sol = solver->solve(tsid->computeProblemData(t, q, v));
+  BOOST_REQUIRE(sol.status == HQP_STATUS_OPTIMAL);
+
+  Eigen::Matrix<double, 12, 1> f, f_name;
+  BOOST_CHECK(tsid->getContactForces(lfHandle, sol, f));
+  BOOST_CHECK(tsid->getContactForces(contactLF.name(), sol, f_name));
+  BOOST_CHECK(f.isApprox(f_name));
+
+  // removing a contact invalidates its handle and shifts the other
+  // constraints of the HQP data
+  BOOST_CHECK(tsid->removeRigidContact(rfHandle));
+  BOOST_CHECK_EQUAL(tsid->getContactHandle(contactRF.name()), -1);
+  BOOST_CHECK(!tsid->getContactForces(rfHandle, sol, f));
+  BOOST_CHECK(!tsid->removeRigidContact(rfHandle));
+  BOOST_CHECK_EQUAL(tsid->getContactHandle(contactLF.name()), lfHandle);
+
+  BOOST_CHECK(tsid->updateTaskWeight(postureHandle, 0.25));
+  BOOST_CHECK_EQUAL(
+      hqpDataWeight(hqpData, romeo_inv_dyn.postureTask->name()), 0.25);
+  BOOST_CHECK(tsid->updateRigidContactWeights(lfHandle, 1e-4));
+  BOOST_CHECK_EQUAL(
+      hqpDataWeight(hqpData, contactLF.name() + "_force_reg_task"), 1e-4);
+
+  BOOST_CHECK(tsid->removeTask(postureHandle));
+  BOOST_CHECK(!tsid->updateTaskWeight(postureHandle, 0.5));
+  BOOST_CHECK_EQUAL(tsid->getTaskHandle(romeo_inv_dyn.postureTask->name()),
+                    -1);
+
+  delete solver;
+}
+
 #define PROFILE_CONTROL_CYCLE "Control cycle"
 #define PROFILE_PROBLEM_FORMULATION "Problem formulation"
 #define PROFILE_HQP "HQP"
@@ -756,4 +1006,30 @@ BOOST_AUTO_TEST_CASE(test_invdyn_formulation_acc_force_computation_time) {
   getStatistics().report_all(1, cout);
 }
 
+#ifdef TSID_WITH_RT_SOLVER_GENERATOR
+BOOST_AUTO_TEST_CASE(test_invdyn_formulation_generated_rt_solver) {
+  cout << "\n*** test_invdyn_formulation_generated_rt_solver ***\n";
+
+  StandardRomeoInvDynCtrl romeo_inv_dyn(0.001);
+  auto tsid = romeo_inv_dyn.tsid;
+  const HQPStackedData &stackedData = tsid->computeStackedProblemData(
+      0.0, romeo_inv_dyn.q, romeo_inv_dyn.v);
+
+  // the generated sizes are those of the formulation
+  BOOST_CHECK_EQUAL(RomeoRTSolver::nVars, stackedData[0].CE.cols());
+  BOOST_CHECK_EQUAL(RomeoRTSolver::nEqCon, stackedData[0].CE.rows());
+  BOOST_CHECK_EQUAL(RomeoRTSolver::nIneqCon, stackedData[0].CI.rows());
+
+  std::unique_ptr<SolverHQPBase> solver_rt(
+      RomeoRTSolver::createSolver("eiquadprog-rt"));
+  std::unique_ptr<SolverHQPBase> solver_fast(SolverHQPFactory::createNewSolver(
+      SOLVER_HQP_EIQUADPROG_FAST, "eiquadprog-fast"));
+  const HQPOutput &sol_rt = solver_rt->solve(stackedData);
+  const HQPOutput &sol_fast = solver_fast->solve(stackedData);
+  BOOST_REQUIRE(sol_rt.status == HQP_STATUS_OPTIMAL);
+  BOOST_REQUIRE(sol_fast.status == HQP_STATUS_OPTIMAL);
+  BOOST_CHECK(sol_rt.x.isApprox(sol_fast.x, 1e-4));
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
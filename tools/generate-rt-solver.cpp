@@ -0,0 +1,280 @@
+//
+// Copyright (c) 2024 CNRS INRIA
+//
+// This file is part of tsid
+// tsid is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+// tsid is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// General Lesser Public License for more details. You should have
+// received a copy of the GNU Lesser General Public License along with
+// tsid If not, see
+// <http://www.gnu.org/licenses/>.
+//
+
+// Generator of the explicit instantiation of SolverHQuadProgRT for a robot
+// configuration, used by tsid_generate_rt_solver (see tsid-rt-solver.cmake).
+// The formulation of the configuration is built and its problem is stacked
+// once, giving the sizes of level 0 checked by SolverHQuadProgRT::resize.
+//
+// Usage: tsid-generate-rt-solver URDF CONFIGURATION OUTPUT_DIRECTORY NAME
+//
+// The configuration file contains one keyword per line, '#' starting a
+// comment:
+//   floating_base              the robot has a free-flyer root joint
+//   package_dir PATH           directory containing the meshes (the
+//                              directory of the URDF by default)
+//   contact_6d FRAME           Contact6d on the frame
+//   contact_point FRAME        ContactPoint on the frame
+//   joint_bounds               TaskJointBounds in level 0
+//   joint_pos_vel_acc_bounds   TaskJointPosVelAccBounds in level 0
+// The files OUTPUT_DIRECTORY/NAME.hpp and OUTPUT_DIRECTORY/NAME.cpp define
+// the struct NAME, with the sizes of the problem and a function creating the
+// solver.
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <tsid/contacts/contact-6d.hpp>
+#include <tsid/contacts/contact-point.hpp>
+#include <tsid/formulations/inverse-dynamics-formulation-acc-force.hpp>
+#include <tsid/robots/robot-wrapper.hpp>
+#include <tsid/tasks/task-joint-bounds.hpp>
+#include <tsid/tasks/task-joint-posVelAcc-bounds.hpp>
+
+#include <pinocchio/algorithm/joint-configuration.hpp>
+
+using namespace tsid;
+using namespace tsid::contacts;
+using namespace tsid::math;
+using namespace tsid::robots;
+using namespace tsid::tasks;
+
+namespace {
+
+/// Contacts and constraints of level 0 of a robot configuration.
+struct Configuration {
+  bool floatingBase = false;
+  std::vector<std::string> packageDirs;
+  std::vector<std::string> contacts6d;
+  std::vector<std::string> contactPoints;
+  bool jointBounds = false;
+  bool jointPosVelAccBounds = false;
+};
+
+/// Read the configuration file, return false and set error if it is invalid.
+bool readConfiguration(const std::string& filename, Configuration& config,
+                       std::string& error) {
+  std::ifstream file(filename.c_str());
+  if (!file) {
+    error = "cannot open " + filename;
+    return false;
+  }
+  std::string line;
+  for (unsigned int lineNumber = 1; std::getline(file, line); lineNumber++) {
+    const std::size_t comment = line.find('#');
+    if (comment != std::string::npos) line.erase(comment);
+    std::istringstream words(line);
+    std::string keyword, argument, extra;
+    if (!(words >> keyword)) continue;
+    const bool hasArgument = static_cast<bool>(words >> argument);
+    const bool hasExtra = static_cast<bool>(words >> extra);
+
+    const bool needsArgument = keyword == "package_dir" ||
+                               keyword == "contact_6d" ||
+                               keyword == "contact_point";
+    if (hasExtra || hasArgument != needsArgument) {
+      std::ostringstream s;
+      s << filename << ":" << lineNumber << ": wrong number of arguments for "
+        << keyword;
+      error = s.str();
+      return false;
+    }
+
+    if (keyword == "floating_base")
+      config.floatingBase = true;
+    else if (keyword == "package_dir")
+      config.packageDirs.push_back(argument);
+    else if (keyword == "contact_6d")
+      config.contacts6d.push_back(argument);
+    else if (keyword == "contact_point")
+      config.contactPoints.push_back(argument);
+    else if (keyword == "joint_bounds")
+      config.jointBounds = true;
+    else if (keyword == "joint_pos_vel_acc_bounds")
+      config.jointPosVelAccBounds = true;
+    else {
+      std::ostringstream s;
+      s << filename << ":" << lineNumber << ": unknown keyword " << keyword;
+      error = s.str();
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Sizes of level 0 of the problem of the configuration.
+void computeSizes(const std::string& urdf, Configuration config, int& nVars,
+                  int& nEqCon, int& nIneqCon) {
+  if (config.packageDirs.empty()) {
+    const std::size_t slash = urdf.find_last_of('/');
+    config.packageDirs.push_back(
+        slash == std::string::npos ? "." : urdf.substr(0, slash));
+  }
+  std::unique_ptr<RobotWrapper> robot;
+  if (config.floatingBase)
+    robot.reset(new RobotWrapper(urdf, config.packageDirs,
+                                 pinocchio::JointModelFreeFlyer()));
+  else
+    robot.reset(new RobotWrapper(urdf, config.packageDirs));
+
+  const Vector q = pinocchio::neutral(robot->model());
+  const Vector v = Vector::Zero(robot->nv());
+  InverseDynamicsFormulationAccForce formulation("tsid", *robot);
+
+  // the sizes do not depend on the parameters of the contacts and the tasks
+  std::vector<std::shared_ptr<ContactBase> > contacts;
+  Matrix3x contactPoints = Matrix3x::Zero(3, 4);
+  for (const std::string& frame : config.contacts6d) {
+    contacts.push_back(std::make_shared<Contact6d>(
+        "contact_" + frame, *robot, frame, contactPoints, Vector3::UnitZ(),
+        0.3, 0.0, 1000.0));
+    formulation.addRigidContact(*contacts.back(), 1e-5);
+  }
+  for (const std::string& frame : config.contactPoints) {
+    contacts.push_back(std::make_shared<ContactPoint>(
+        "contact_" + frame, *robot, frame, Vector3::UnitZ(), 0.3, 0.0,
+        1000.0));
+    formulation.addRigidContact(*contacts.back(), 1e-5);
+  }
+
+  const double dt = 1e-3;
+  std::vector<std::shared_ptr<TaskMotion> > tasks;
+  if (config.jointBounds) {
+    tasks.push_back(
+        std::make_shared<TaskJointBounds>("task-joint-bounds", *robot, dt));
+    formulation.addMotionTask(*tasks.back(), 1.0, 0);
+  }
+  if (config.jointPosVelAccBounds) {
+    tasks.push_back(std::make_shared<TaskJointPosVelAccBounds>(
+        "task-joint-pos-vel-acc-bounds", *robot, dt, false));
+    formulation.addMotionTask(*tasks.back(), 1.0, 0);
+  }
+
+  const solvers::HQPStackedLevel& level0 =
+      formulation.computeStackedProblemData(0.0, q, v)[0];
+  nVars = static_cast<int>(level0.CE.cols());
+  nEqCon = static_cast<int>(level0.CE.rows());
+  nIneqCon = static_cast<int>(level0.CI.rows());
+}
+
+bool isIdentifier(const std::string& name) {
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+    return false;
+  for (char c : name)
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+  return true;
+}
+
+/// Write content to filename, unless the file already contains it so that
+/// the files depending on it are not rebuilt.
+bool writeFile(const std::string& filename, const std::string& content) {
+  std::ifstream in(filename.c_str());
+  if (in) {
+    std::stringstream current;
+    current << in.rdbuf();
+    if (current.str() == content) return true;
+  }
+  std::ofstream out(filename.c_str());
+  out << content;
+  return static_cast<bool>(out);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " URDF CONFIGURATION OUTPUT_DIRECTORY NAME" << std::endl;
+    return 1;
+  }
+  const std::string urdf = argv[1];
+  const std::string configFile = argv[2];
+  const std::string outputDir = argv[3];
+  const std::string name = argv[4];
+  if (!isIdentifier(name)) {
+    std::cerr << name << " is not a valid C++ identifier" << std::endl;
+    return 1;
+  }
+
+  Configuration config;
+  std::string error;
+  if (!readConfiguration(configFile, config, error)) {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  int nVars, nEqCon, nIneqCon;
+  try {
+    computeSizes(urdf, config, nVars, nEqCon, nIneqCon);
+  } catch (const std::exception& e) {
+    std::cerr << "Cannot build the formulation of " << configFile << ": "
+              << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ostringstream sizes;
+  sizes << nVars << ", " << nEqCon << ", " << nIneqCon;
+  const std::string solver =
+      "tsid::solvers::SolverHQuadProgRT<" + sizes.str() + ">";
+
+  std::ostringstream hpp;
+  hpp << "// Generated by tsid-generate-rt-solver from " << urdf << " and "
+      << configFile << ", do not edit.\n\n"
+      << "#ifndef __tsid_rt_solver_" << name << "_hpp__\n"
+      << "#define __tsid_rt_solver_" << name << "_hpp__\n\n"
+      << "#include <string>\n\n"
+      << "#include <tsid/solvers/solver-HQP-eiquadprog-rt.hpp>\n\n"
+      << "/// Sizes of level 0 of the problem of " << configFile
+      << ", and its eiquadprog-rt solver.\n"
+      << "struct " << name << " {\n"
+      << "  static constexpr int nVars = " << nVars << ";\n"
+      << "  static constexpr int nEqCon = " << nEqCon << ";\n"
+      << "  static constexpr int nIneqCon = " << nIneqCon << ";\n"
+      << "  typedef " << solver << " Solver;\n\n"
+      << "  /** Create a new solver, deleted by the caller. */\n"
+      << "  static tsid::solvers::SolverHQPBase* createSolver(\n"
+      << "      const std::string& name);\n"
+      << "};\n\n"
+      << "extern template class " << solver << ";\n\n"
+      << "#endif  // ifndef __tsid_rt_solver_" << name << "_hpp__\n";
+
+  std::ostringstream cpp;
+  cpp << "// Generated by tsid-generate-rt-solver from " << urdf << " and "
+      << configFile << ", do not edit.\n\n"
+      << "#include \"" << name << ".hpp\"\n\n"
+      << "#include <tsid/solvers/solver-HQP-eiquadprog-rt.hxx>\n\n"
+      << "template class " << solver << ";\n\n"
+      << "tsid::solvers::SolverHQPBase* " << name
+      << "::createSolver(const std::string& name) {\n"
+      << "  return new Solver(name);\n"
+      << "}\n";
+
+  if (!writeFile(outputDir + "/" + name + ".hpp", hpp.str()) ||
+      !writeFile(outputDir + "/" + name + ".cpp", cpp.str())) {
+    std::cerr << "Cannot write the files of " << name << " in " << outputDir
+              << std::endl;
+    return 1;
+  }
+  std::cout << name << ": SolverHQuadProgRT<" << sizes.str() << ">"
+            << std::endl;
+  return 0;
+}
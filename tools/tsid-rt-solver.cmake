@@ -0,0 +1,52 @@
+#
+# Copyright (c) 2024 CNRS INRIA
+#
+# This file is part of tsid tsid is free software: you can redistribute it
+# and/or modify it under the terms of the GNU Lesser General Public License as
+# published by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version. tsid is distributed in the hope that it
+# will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+# Lesser Public License for more details. You should have received a copy of the
+# GNU Lesser General Public License along with tsid. If not, see
+# <http://www.gnu.org/licenses/>.
+
+# .rst: .. command:: TSID_GENERATE_RT_SOLVER(TARGET NAME URDF CONFIGURATION)
+#
+# Generate NAME.hpp and NAME.cpp in the binary directory, defining the struct
+# NAME with the sizes of level 0 of the problem of the robot configuration and
+# the explicit instantiation of SolverHQuadProgRT with these sizes, and add
+# them to TARGET. The files are generated again when the URDF or the
+# configuration change. See tools/generate-rt-solver.cpp for the format of the
+# configuration.
+#
+# Example:
+#
+#   tsid_generate_rt_solver(controller RomeoSolver ${ROMEO_URDF} romeo.txt)
+#
+# and in the sources of controller:
+#
+#   #include "RomeoSolver.hpp"
+#   SolverHQPBase* solver = RomeoSolver::createSolver("eiquadprog-rt");
+#
+function(TSID_GENERATE_RT_SOLVER TARGET NAME URDF CONFIGURATION)
+  if(TARGET tsid-generate-rt-solver)
+    set(GENERATOR tsid-generate-rt-solver)
+  else()
+    set(GENERATOR tsid::tsid-generate-rt-solver)
+  endif()
+  get_filename_component(URDF ${URDF} ABSOLUTE)
+  get_filename_component(CONFIGURATION ${CONFIGURATION} ABSOLUTE)
+  set(OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/tsid-rt-solvers)
+  file(MAKE_DIRECTORY ${OUTPUT_DIR})
+
+  add_custom_command(
+    OUTPUT ${OUTPUT_DIR}/${NAME}.hpp ${OUTPUT_DIR}/${NAME}.cpp
+    COMMAND ${GENERATOR} ${URDF} ${CONFIGURATION} ${OUTPUT_DIR} ${NAME}
+    DEPENDS ${GENERATOR} ${URDF} ${CONFIGURATION}
+    COMMENT "Generating the eiquadprog-rt solver ${NAME}"
+    VERBATIM)
+  target_sources(${TARGET} PRIVATE ${OUTPUT_DIR}/${NAME}.hpp
+                                   ${OUTPUT_DIR}/${NAME}.cpp)
+  target_include_directories(${TARGET} PRIVATE ${OUTPUT_DIR})
+endfunction(TSID_GENERATE_RT_SOLVER)